@@ -25,8 +25,15 @@ case $BUILD_TYPE in
         echo "📦 Executable: $BUILD_DIR/cardity_wasm"
         ;;
         
-    "wasm")
-        echo "🌐 Building WASM version..."
+    "wasm"|"wasm-size"|"wasm-speed")
+        # 构建档位：wasm（-O3）、wasm-size（-Oz，冷启动优先）、wasm-speed（SIMD + LTO，吞吐优先）
+        WASM_PROFILE=${BUILD_TYPE#wasm-}
+        if [ "$WASM_PROFILE" = "wasm" ]; then
+            WASM_PROFILE="default"
+        else
+            BUILD_DIR="build-$BUILD_TYPE"
+        fi
+        echo "🌐 Building WASM version (profile: $WASM_PROFILE)..."
         
         # 检查 Emscripten
         if ! command -v emcc &> /dev/null; then
@@ -40,7 +47,7 @@ case $BUILD_TYPE in
         cd $BUILD_DIR
         
         # 配置和编译
-        emcmake cmake ..
+        emcmake cmake .. -DCARDITY_WASM_PROFILE=$WASM_PROFILE
         emmake make -j$(sysctl -n hw.ncpu)
         
         echo "✅ WASM build completed!"
@@ -74,6 +81,17 @@ case $BUILD_TYPE in
         echo "✅ Tests completed!"
         ;;
         
+    "bench")
+        echo "⏱️  Running benchmarks..."
+        
+        if [ ! -f "$BUILD_DIR/cardity_bench" ]; then
+            echo "❌ Benchmark not found. Please build first: ./build.sh native"
+            exit 1
+        fi
+        
+        $BUILD_DIR/cardity_bench
+        ;;
+        
     "all")
         echo "🚀 Building all versions..."
         ./build.sh clean
@@ -84,13 +102,16 @@ case $BUILD_TYPE in
         ;;
         
     *)
-        echo "Usage: $0 {native|wasm|clean|test|all}"
+        echo "Usage: $0 {native|wasm|wasm-size|wasm-speed|clean|test|bench|all}"
         echo ""
         echo "Build types:"
         echo "  native  - Build native executable (default)"
         echo "  wasm    - Build WebAssembly version"
+        echo "  wasm-size  - Build size-optimized WebAssembly (-Oz, into build-wasm-size/)"
+        echo "  wasm-speed - Build throughput WebAssembly (SIMD + LTO, into build-wasm-speed/)"
         echo "  clean   - Clean build directory"
         echo "  test    - Run tests"
+        echo "  bench   - Run benchmarks (cardity_bench)"
         echo "  all     - Build all versions and run tests"
         exit 1
         ;;
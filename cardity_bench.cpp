@@ -0,0 +1,330 @@
+#include "runtime/runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cardity;
+
+// 可重复的微基准：合成协议的内容固定，事件使用固定的区块上下文，
+// 每个基准先预热一轮，再运行若干轮取中位数和最好成绩
+namespace {
+
+struct BenchOptions {
+    std::string filter;         // 只运行名称包含该子串的基准
+    size_t scale = 1;           // 每轮操作数的倍数
+    size_t repetitions = 5;
+    bool json_output = false;
+    std::string car_file = "test_data/hello_cardinals.car";
+    std::string temp_dir = ".";
+};
+
+struct BenchResult {
+    std::string name;
+    size_t ops = 0;             // 每轮操作数
+    double median_ns = 0;       // 每个操作的耗时（中位数）
+    double best_ns = 0;         // 每个操作的耗时（最好的一轮）
+};
+
+// 防止被测代码被优化掉
+volatile size_t sink = 0;
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 生成合成协议：key_count 个 int 状态变量，以及覆盖计数器、条件分支、事件和多键写入的方法
+std::string make_protocol(size_t key_count) {
+    json state = json::object();
+    state["count"] = {{"type", "int"}, {"default", "0"}};
+    state["even"] = {{"type", "int"}, {"default", "0"}};
+    state["odd"] = {{"type", "int"}, {"default", "0"}};
+    state["label"] = {{"type", "string"}, {"default", "bench"}};
+    for (size_t i = 0; i < key_count; ++i) {
+        state["k" + std::to_string(i)] = {{"type", "int"}, {"default", std::to_string(i)}};
+    }
+
+    json methods = json::object();
+    methods["counter"]["logic"] = "state.count = state.count + 1";
+    methods["conditional"]["params"] = {"n"};
+    methods["conditional"]["logic"] =
+        "if (params.n % 2 == 0) { state.even = state.even + 1 }; "
+        "if (params.n % 2 != 0 && state.count >= 0) { state.odd = state.odd + params.n * 3 - 1 }";
+    methods["emit"]["logic"] = "state.count = state.count + 1; emit Ticked(state.count, state.label)";
+    methods["read"]["returns"] = {{"type", "int"}, {"expr", "state.count * 2 + state.even - state.odd"}};
+
+    // 写入分散在键空间中的 16 个键
+    std::string spread;
+    for (size_t i = 0; i < 16 && key_count > 0; ++i) {
+        std::string key = "state.k" + std::to_string(i * 7919 % key_count);
+        spread += key + " = " + key + " + 1; ";
+    }
+    methods["spread"]["logic"] = spread;
+
+    json events = json::object();
+    events["Ticked"]["params"] = json::array({{{"name", "count"}, {"type", "int"}},
+                                               {{"name", "label"}, {"type", "string"}}});
+
+    json protocol;
+    protocol["p"] = "cardinals";
+    protocol["op"] = "deploy";
+    protocol["protocol"] = "bench_" + std::to_string(key_count);
+    protocol["version"] = "1.0";
+    protocol["cpl"]["owner"] = "bench";
+    protocol["cpl"]["state"] = state;
+    protocol["cpl"]["methods"] = methods;
+    protocol["cpl"]["events"] = events;
+    return protocol.dump(2);
+}
+
+bool write_file(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    return static_cast<bool>(file);
+}
+
+RuntimeConfig bench_config() {
+    RuntimeConfig config;
+    config.clock = std::make_shared<ManualClock>(BlockContext(840000, 1713571767));
+    config.event_log_capacity = 4096;
+    config.log_level = LogLevel::ERROR;
+    return config;
+}
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& opts) : options(opts) {}
+
+    // body(ops) 执行 ops 次操作；setup 在每轮计时前调用（不计时）
+    template <typename Body, typename Setup>
+    void run(const std::string& name, size_t base_ops, Body&& body, Setup&& setup) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+
+        size_t ops = std::max<size_t>(1, base_ops * options.scale);
+        setup();
+        body(std::max<size_t>(1, ops / 10));    // 预热
+
+        std::vector<double> samples;
+        for (size_t rep = 0; rep < options.repetitions; ++rep) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            body(ops);
+            samples.push_back(elapsed_ns(start) / static_cast<double>(ops));
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult result;
+        result.name = name;
+        result.ops = ops;
+        result.median_ns = samples[samples.size() / 2];
+        result.best_ns = samples.front();
+        results.push_back(result);
+
+        if (!options.json_output) {
+            std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << ops
+                      << std::setw(14) << std::fixed << std::setprecision(1) << result.median_ns
+                      << std::setw(14) << result.best_ns << std::setw(14) << std::setprecision(0)
+                      << (result.median_ns > 0 ? 1e9 / result.median_ns : 0) << std::endl;
+        }
+    }
+
+    template <typename Body>
+    void run(const std::string& name, size_t base_ops, Body&& body) {
+        run(name, base_ops, std::forward<Body>(body), [] {});
+    }
+
+    void print_json() const {
+        json output = json::array();
+        for (const auto& result : results) {
+            output.push_back({{"name", result.name}, {"ops", result.ops}, {"median_ns", result.median_ns},
+                              {"best_ns", result.best_ns}});
+        }
+        std::cout << output.dump(2) << std::endl;
+    }
+
+private:
+    const BenchOptions& options;
+    std::vector<BenchResult> results;
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [--filter <name>] [--scale <n>] [--repetitions <n>] [--json]"
+              << " [--car <file>] [--temp <dir>]" << std::endl;
+}
+
+bool parse_options(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json") {
+            options.json_output = true;
+        } else if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--scale" && has_value) {
+            options.scale = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--repetitions" && has_value) {
+            options.repetitions = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--car" && has_value) {
+            options.car_file = argv[++i];
+        } else if (arg == "--temp" && has_value) {
+            options.temp_dir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    set_log_level(LogLevel::ERROR);     // 基准循环中不输出警告
+
+    const std::string small_car = options.temp_dir + "/cardity_bench_small.car";
+    const std::string large_car = options.temp_dir + "/cardity_bench_large.car";
+    const std::string state_path = options.temp_dir + "/cardity_bench.state";
+    if (!write_file(small_car, make_protocol(16)) || !write_file(large_car, make_protocol(2000))) {
+        std::cerr << "❌ Failed to write synthetic protocols to " << options.temp_dir << std::endl;
+        return 1;
+    }
+
+    if (!options.json_output) {
+        std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(10) << "ops"
+                  << std::setw(14) << "median ns/op" << std::setw(14) << "best ns/op" << std::setw(14) << "ops/s"
+                  << std::endl;
+    }
+    BenchRunner runner(options);
+
+    // 协议加载：读取、解析并预编译
+    std::ifstream car_probe(options.car_file);
+    if (car_probe) {
+        runner.run("load/" + options.car_file.substr(options.car_file.find_last_of('/') + 1), 200, [&](size_t ops) {
+            for (size_t i = 0; i < ops; ++i) {
+                sink = sink + (CarLoader::load_from_file(options.car_file) != nullptr);
+            }
+        });
+    }
+    runner.run("load/synthetic_16_keys", 200, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + (CarLoader::load_from_file(small_car) != nullptr);
+        }
+    });
+    runner.run("load/synthetic_2000_keys", 10, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + (CarLoader::load_from_file(large_car) != nullptr);
+        }
+    });
+
+    // 方法调用吞吐
+    CardityRuntime runtime(bench_config());
+    if (!runtime.load_protocol(small_car)) {
+        std::cerr << "❌ Failed to load synthetic protocol" << std::endl;
+        return 1;
+    }
+    const std::vector<std::string> no_args;
+    runner.run("call/counter", 200000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.call_method("counter", no_args).success;
+        }
+    });
+
+    std::vector<std::vector<std::string>> numbers;
+    for (size_t i = 0; i < 64; ++i) {
+        numbers.push_back({std::to_string(i)});
+    }
+    runner.run("call/conditional", 200000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.call_method("conditional", numbers[i % numbers.size()]).success;
+        }
+    });
+    runner.run("call/returns", 200000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.call_method("read", no_args).return_value.size();
+        }
+    });
+    runner.run("call/emit", 100000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.call_method("emit", no_args).events.size();
+        }
+    });
+    runner.run("call/simulate", 200000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.simulate_method("counter", no_args).success;
+        }
+    });
+
+    CardityRuntime large(bench_config());
+    if (!large.load_protocol(large_car)) {
+        std::cerr << "❌ Failed to load synthetic protocol" << std::endl;
+        return 1;
+    }
+    runner.run("call/spread_2000_keys", 50000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + large.call_method("spread", no_args).success;
+        }
+    });
+
+    std::vector<MethodCall> batch(256, MethodCall("counter", no_args));
+    runner.run("call/batch_256", 500, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + runtime.call_methods_batch(batch).size();
+        }
+    });
+
+    // 快照：2000 个键的完整快照、JSON 往返和恢复
+    Snapshot snapshot = large.create_snapshot("bench");
+    json snapshot_json = CardityRuntime::snapshot_to_json(snapshot);
+    runner.run("snapshot/create_2000_keys", 500, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + large.create_snapshot("bench").state.size();
+        }
+    });
+    runner.run("snapshot/to_json_2000_keys", 500, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + CardityRuntime::snapshot_to_json(snapshot).dump().size();
+        }
+    });
+    runner.run("snapshot/restore_2000_keys", 500, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + large.restore_from_snapshot(CardityRuntime::snapshot_from_json(snapshot_json));
+        }
+    });
+    runner.run("snapshot/delta_16_writes", 5000, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            large.call_method("spread", no_args);
+            sink = sink + large.create_delta_snapshot(std::to_string(i)).state.size();
+        }
+    }, [&] { large.create_delta_snapshot("base"); });
+
+    // 状态文件保存和加载
+    runner.run("state/save_2000_keys", 200, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + large.save_state_to_file(state_path);
+        }
+    });
+    runner.run("state/load_2000_keys", 200, [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            sink = sink + large.load_state_from_file(state_path);
+        }
+    }, [&] { large.save_state_to_file(state_path); });
+
+    if (options.json_output) {
+        runner.print_json();
+    }
+
+    std::remove(small_car.c_str());
+    std::remove(large_car.c_str());
+    std::remove(state_path.c_str());
+    return 0;
+}
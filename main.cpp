@@ -2,16 +2,24 @@
 #include <string>
 #include <vector>
 #include "runtime/runtime.h"
+#include "runtime/wal_state_store.h"
+#include "runtime/mmap_state_store.h"
+#include "runtime/command_server.h"
 
 using namespace cardity;
 
 void print_usage(const std::string& program_name) {
     std::cout << "Cardity WASM Runtime" << std::endl;
     std::cout << "===================" << std::endl;
-    std::cout << "Usage: " << program_name << " <car_file> [--state <state_file>] [command] [args...]" << std::endl;
+    std::cout << "Usage: " << program_name << " <car_file> [--state <state_file>] [--wal <log_file>] [--image <image_file>] [--block <height>[:<time>]] [--gas-limit <n>] [--flush-interval <ms>] [command] [args...]" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  --state <file>           - Use persistent state file" << std::endl;
+    std::cout << "  --state <file>           - Use persistent state file (not with --wal / --image)" << std::endl;
+    std::cout << "  --wal <file>             - Use append-only state log (replayed at startup)" << std::endl;
+    std::cout << "  --image <file>           - Map a read-only state image; writes go to the --wal log or memory" << std::endl;
+    std::cout << "  --block <h>[:<time>]     - Stamp events and snapshots with a fixed block height and Unix time" << std::endl;
+    std::cout << "  --gas-limit <n>          - Abort and roll back any call that charges more than n gas" << std::endl;
+    std::cout << "  --flush-interval <ms>    - serve: write state at most this often (default 1000, 0 = after every write)" << std::endl;
     std::cout << std::endl;
     std::cout << "Commands:" << std::endl;
     std::cout << "  call <method> [args...]  - Call a method" << std::endl;
@@ -21,12 +29,18 @@ void print_usage(const std::string& program_name) {
     std::cout << "  state                    - Show all state" << std::endl;
     std::cout << "  abi                      - Show ABI" << std::endl;
     std::cout << "  snapshot                 - Create snapshot" << std::endl;
+    std::cout << "  stats [<method> [args...]] - Call a method with metrics enabled and print runtime metrics" << std::endl;
+    std::cout << "  image <file>             - Write current state as a mappable image" << std::endl;
+    std::cout << "  serve                    - Keep the runtime loaded and answer newline-delimited JSON commands on stdin" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << program_name << " hello.car --state hello.state call set_msg \"Hello World\"" << std::endl;
     std::cout << "  " << program_name << " hello.car --state hello.state call get_msg" << std::endl;
     std::cout << "  " << program_name << " hello.car --state hello.state call increment" << std::endl;
     std::cout << "  " << program_name << " hello.car --state hello.state state" << std::endl;
+    std::cout << "  " << program_name << " hello.car --wal hello.wal call increment" << std::endl;
+    std::cout << "  " << program_name << " hello.car --image hello.img --wal hello.wal call increment" << std::endl;
+    std::cout << "  echo '{\"cmd\":\"call\",\"method\":\"increment\"}' | " << program_name << " hello.car --state hello.state serve" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -37,42 +51,110 @@ int main(int argc, char* argv[]) {
 
     std::string car_file = argv[1];
     std::string state_file = "";
-    int arg_offset = 1;
+    std::string wal_file = "";
+    std::string image_file = "";
+    std::string block_spec = "";
+    std::string flush_interval = "";
+    std::string gas_limit = "";
+    int arg_offset = 2;
     
-    // 解析选项
-    for (int i = 2; i < argc; ++i) {
-        if (std::string(argv[i]) == "--state" && i + 1 < argc) {
-            state_file = argv[i + 1];
-            arg_offset = i + 2;
+    // 解析选项（位于命令之前）
+    while (arg_offset + 1 < argc) {
+        std::string option = argv[arg_offset];
+        if (option == "--state") {
+            state_file = argv[arg_offset + 1];
+        } else if (option == "--wal") {
+            wal_file = argv[arg_offset + 1];
+        } else if (option == "--image") {
+            image_file = argv[arg_offset + 1];
+        } else if (option == "--block") {
+            block_spec = argv[arg_offset + 1];
+        } else if (option == "--gas-limit") {
+            gas_limit = argv[arg_offset + 1];
+        } else if (option == "--flush-interval") {
+            flush_interval = argv[arg_offset + 1];
+        } else {
             break;
         }
+        arg_offset += 2;
+    }
+    
+    // --state 把整个状态读入内存并在退出时写回；日志或镜像自己负责持久化，
+    // 两者同时使用时其中一方的内容会被另一方静默覆盖
+    if (!state_file.empty() && (!wal_file.empty() || !image_file.empty())) {
+        std::cerr << "❌ --state cannot be combined with --wal or --image" << std::endl;
+        return 1;
     }
     
+    // serve 的标准输出只写 JSON 响应，启动信息改写到标准错误
+    bool serve_mode = arg_offset < argc && std::string(argv[arg_offset]) == "serve";
+    std::ostream& info = serve_mode ? std::cerr : std::cout;
+    
     try {
         // 创建运行时
-        std::cout << "🚀 Initializing Cardity WASM Runtime..." << std::endl;
-        CardityRuntime runtime;
+        info << "🚀 Initializing Cardity WASM Runtime..." << std::endl;
+        RuntimeConfig config;
+        config.enable_metrics = arg_offset < argc && std::string(argv[arg_offset]) == "stats";
+        if (!block_spec.empty()) {
+            // 固定的区块上下文：重复运行得到相同的事件和快照时间戳
+            size_t separator = block_spec.find(':');
+            BlockContext block;
+            block.height = std::stoull(block_spec.substr(0, separator));
+            if (separator != std::string::npos) {
+                block.time = std::stoll(block_spec.substr(separator + 1));
+            }
+            config.clock = std::make_shared<ManualClock>(block);
+        }
+        if (!gas_limit.empty()) {
+            config.gas_limit = std::stoull(gas_limit);
+        }
+        CardityRuntime runtime(config);
         
         // 加载协议
-        std::cout << "📖 Loading protocol: " << car_file << std::endl;
+        info << "📖 Loading protocol: " << car_file << std::endl;
         if (!runtime.load_protocol(car_file)) {
             std::cerr << "❌ Failed to load protocol" << std::endl;
             return 1;
         }
         
-        std::cout << "✅ Protocol loaded: " << runtime.get_protocol_name() 
+        info << "✅ Protocol loaded: " << runtime.get_protocol_name() 
                   << " v" << runtime.get_protocol_version() << std::endl;
         
         // 加载状态文件（如果指定）
         if (!state_file.empty()) {
-            std::cout << "📁 Loading state from: " << state_file << std::endl;
+            info << "📁 Loading state from: " << state_file << std::endl;
             if (runtime.load_state_from_file(state_file)) {
-                std::cout << "✅ State loaded from file" << std::endl;
+                info << "✅ State loaded from file" << std::endl;
             } else {
-                std::cout << "ℹ️  No existing state file, starting fresh" << std::endl;
+                info << "ℹ️  No existing state file, starting fresh" << std::endl;
             }
         }
         
+        // 打开状态日志和镜像（如果指定）：日志重放已有记录，镜像按需分页读取；
+        // 同时指定时日志作为镜像的写入覆盖层
+        if (!wal_file.empty() || !image_file.empty()) {
+            std::unique_ptr<StateStore> store;
+            if (!wal_file.empty()) {
+                auto wal = std::make_unique<WalStateStore>();
+                if (!wal->open(wal_file)) {
+                    std::cerr << "❌ Failed to open state log: " << wal_file << std::endl;
+                    return 1;
+                }
+                store = std::move(wal);
+                info << "📁 Using state log: " << wal_file << std::endl;
+            }
+            if (!image_file.empty()) {
+                auto mapped = std::make_unique<MmapStateStore>(std::move(store));
+                if (!mapped->open(image_file)) {
+                    std::cerr << "❌ Failed to map state image: " << image_file << std::endl;
+                    return 1;
+                }
+                store = std::move(mapped);
+                info << "📁 Using state image: " << image_file << std::endl;
+            }
+            runtime.set_state_store(std::move(store));
+        }
+        
         // 如果没有命令，显示帮助
         if (argc < arg_offset + 1) {
             std::cout << "\nAvailable methods:" << std::endl;
@@ -80,7 +162,7 @@ int main(int argc, char* argv[]) {
             for (const auto& method : methods) {
                 std::cout << "  - " << method << std::endl;
             }
-            std::cout << "\nUse: " << argv[0] << " " << car_file << " [--state <file>] call <method> [args...]" << std::endl;
+            std::cout << "\nUse: " << argv[0] << " " << car_file << " [--state <file>] [--wal <file>] call <method> [args...]" << std::endl;
             return 0;
         }
         
@@ -110,7 +192,7 @@ int main(int argc, char* argv[]) {
             MethodResult result = runtime.call_method(method_name, args);
             
             if (result.success) {
-                std::cout << "✅ Method executed successfully" << std::endl;
+                std::cout << "✅ Method executed successfully (gas used: " << result.gas_used << ")" << std::endl;
                 if (!result.return_value.empty()) {
                     std::cout << "📥 Return value: " << result.return_value << std::endl;
                 }
@@ -119,7 +201,7 @@ int main(int argc, char* argv[]) {
                 if (!result.events.empty()) {
                     std::cout << "📢 Events emitted:" << std::endl;
                     for (const auto& event : result.events) {
-                        std::cout << "  - " << event.name << "(";
+                        std::cout << "  - " << event.name() << "(";
                         for (size_t i = 0; i < event.values.size(); ++i) {
                             if (i > 0) std::cout << ", ";
                             std::cout << event.values[i];
@@ -157,19 +239,22 @@ int main(int argc, char* argv[]) {
             }
             
         } else if (command == "events") {
-            auto events = runtime.get_event_log();
-            if (events.empty()) {
+            if (runtime.get_event_stream().empty()) {
                 std::cout << "📢 No events in log" << std::endl;
             } else {
                 std::cout << "📢 Event log:" << std::endl;
-                for (const auto& event : events) {
-                    std::cout << "  - " << event.name << "(";
+                runtime.for_each_event_since(0, [](uint64_t sequence, const EventInstance& event) {
+                    std::cout << "  #" << sequence << " " << event.name() << "(";
                     for (size_t i = 0; i < event.values.size(); ++i) {
                         if (i > 0) std::cout << ", ";
                         std::cout << event.values[i];
                     }
-                    std::cout << ") at " << event.timestamp << std::endl;
-                }
+                    std::cout << ") at " << format_timestamp(event.block.time);
+                    if (event.block.height > 0) {
+                        std::cout << " (block " << event.block.height << ")";
+                    }
+                    std::cout << std::endl;
+                });
             }
             
         } else if (command == "state") {
@@ -188,16 +273,54 @@ int main(int argc, char* argv[]) {
             auto snapshot = runtime.create_snapshot();
             std::cout << "📸 Snapshot created:" << std::endl;
             std::cout << "  Protocol: " << snapshot.protocol_name << " v" << snapshot.version << std::endl;
-            std::cout << "  Timestamp: " << snapshot.timestamp << std::endl;
+            std::cout << "  Timestamp: " << format_timestamp(snapshot.block.time) << std::endl;
             std::cout << "  State variables: " << snapshot.state.size() << std::endl;
             std::cout << "  Events: " << snapshot.event_log.size() << std::endl;
             
+        } else if (command == "stats") {
+            if (argc >= arg_offset + 2) {
+                std::vector<std::string> args(argv + arg_offset + 2, argv + argc);
+                MethodResult result = runtime.call_method(argv[arg_offset + 1], args);
+                if (!result.success) {
+                    std::cout << "❌ Method execution failed: " << result.error_message << std::endl;
+                }
+                if (!state_file.empty() && result.success) {
+                    runtime.save_state_to_file(state_file);
+                }
+            }
+            std::cout << "📊 Runtime metrics:" << std::endl;
+            std::cout << runtime.get_metrics().dump(2) << std::endl;
+            
+        } else if (command == "serve") {
+            ServerOptions options;
+            options.state_file = state_file;
+            if (!flush_interval.empty()) {
+                options.flush_interval = std::chrono::milliseconds(std::stoll(flush_interval));
+            }
+            CommandServer server(runtime, options);
+            info << "📡 Serving commands on stdin" << std::endl;
+            return server.serve(0, std::cout);
+            
+        } else if (command == "image" && argc >= arg_offset + 2) {
+            std::string image_path = argv[arg_offset + 1];
+            if (!MmapStateStore::write_image(image_path, *runtime.get_state_manager()->get_store())) {
+                std::cout << "❌ Failed to write state image: " << image_path << std::endl;
+                return 1;
+            }
+            std::cout << "💾 State image written: " << image_path << std::endl;
+            
         } else {
             std::cout << "❌ Unknown command: " << command << std::endl;
             print_usage(argv[0]);
             return 1;
         }
         
+        // 状态日志落盘
+        if (!runtime.get_state_manager()->flush()) {
+            std::cerr << "❌ Failed to flush state log" << std::endl;
+            return 1;
+        }
+        
         return 0;
         
     } catch (const std::exception& e) {
@@ -0,0 +1,160 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace cardity {
+
+namespace {
+
+// 单个新块的上限（超过上限的请求按请求大小单独分配）
+constexpr size_t MAX_BLOCK_SIZE = 64 * 1024;
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+Arena::Arena(size_t initial_block_size) : next_block_size(std::max<size_t>(initial_block_size, 64)) {}
+
+Arena::~Arena() {
+    release();
+}
+
+Arena::Arena(Arena&& other) noexcept
+    : blocks(std::move(other.blocks)), current(other.current), offset(other.offset),
+      next_block_size(other.next_block_size), finalizers(other.finalizers) {
+    other.blocks.clear();
+    other.current = 0;
+    other.offset = 0;
+    other.finalizers = nullptr;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this != &other) {
+        release();
+        blocks = std::move(other.blocks);
+        current = other.current;
+        offset = other.offset;
+        next_block_size = other.next_block_size;
+        finalizers = other.finalizers;
+        other.blocks.clear();
+        other.current = 0;
+        other.offset = 0;
+        other.finalizers = nullptr;
+    }
+    return *this;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    // 依次尝试当前块及其后（rewind 后留下的）块
+    while (current < blocks.size()) {
+        size_t start = align_up(offset, alignment);
+        if (start + size <= blocks[current].size) {
+            offset = start + size;
+            return blocks[current].data + start;
+        }
+        if (current + 1 == blocks.size()) {
+            break;
+        }
+        ++current;
+        offset = 0;
+    }
+
+    add_block(size + alignment);
+    size_t start = align_up(offset, alignment);
+    offset = start + size;
+    return blocks[current].data + start;
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+Arena::Marker Arena::mark() const {
+    Marker marker;
+    marker.block = current;
+    marker.offset = offset;
+    marker.finalizers = finalizers;
+    return marker;
+}
+
+void Arena::rewind(const Marker& marker) {
+    run_finalizers(static_cast<Finalizer*>(marker.finalizers));
+    current = marker.block;
+    offset = marker.offset;
+}
+
+void Arena::reset() {
+    run_finalizers(nullptr);
+
+    // 多个块合并为一个，下一轮同样规模的分配只用一个块
+    if (blocks.size() > 1) {
+        size_t total = bytes_reserved();
+        release();
+        add_block(total);
+    }
+    current = 0;
+    offset = 0;
+}
+
+size_t Arena::bytes_used() const {
+    size_t used = offset;
+    for (size_t i = 0; i < current && i < blocks.size(); ++i) {
+        used += blocks[i].size;
+    }
+    return used;
+}
+
+size_t Arena::bytes_reserved() const {
+    size_t reserved = 0;
+    for (const auto& block : blocks) {
+        reserved += block.size;
+    }
+    return reserved;
+}
+
+void Arena::register_finalizer(void* object, void (*destroy)(void*)) {
+    Finalizer* entry = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+    entry->destroy = destroy;
+    entry->object = object;
+    entry->next = finalizers;
+    finalizers = entry;
+}
+
+void Arena::run_finalizers(Finalizer* until) {
+    // 逆构造顺序析构
+    while (finalizers && finalizers != until) {
+        Finalizer* entry = finalizers;
+        finalizers = entry->next;
+        entry->destroy(entry->object);
+    }
+}
+
+void Arena::add_block(size_t min_size) {
+    size_t size = std::max(next_block_size, min_size);
+    Block block;
+    block.data = static_cast<char*>(::operator new(size));
+    block.size = size;
+    blocks.push_back(block);
+    current = blocks.size() - 1;
+    offset = 0;
+    next_block_size = std::min(next_block_size * 2, MAX_BLOCK_SIZE);
+}
+
+void Arena::release() {
+    run_finalizers(nullptr);
+    for (const auto& block : blocks) {
+        ::operator delete(block.data);
+    }
+    blocks.clear();
+    current = 0;
+    offset = 0;
+}
+
+} // namespace cardity
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cardity {
+
+// 单调（bump）分配器：从成块的内存中顺序切分对象，按整体回收
+// 用于表达式树和临时字符串：预编译程序各自持有一个，LogicEngine 另有一个用于单次调用的临时表达式。
+// 非平凡析构的对象登记在 Arena 内部的析构链上，回收时逆序析构；登记本身也从 Arena 分配。
+// reset 把多个内存块合并为一个并保留，稳态下重复的分配/回收不再访问堆。
+// 非线程安全，每个 Arena 只能由一个线程使用
+class Arena {
+public:
+    // 回收位置（见 mark/rewind）
+    struct Marker {
+        size_t block = 0;
+        size_t offset = 0;
+        void* finalizers = nullptr;
+    };
+
+    // 作用域结束时回收作用域内分配的全部对象
+    class Scope {
+    public:
+        explicit Scope(Arena& target) : arena(target), marker(target.mark()) {}
+        ~Scope() { arena.rewind(marker); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena& arena;
+        Marker marker;
+    };
+
+    explicit Arena(size_t initial_block_size = 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    // 分配未初始化的内存
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // 构造对象；对象随 Arena 回收，调用方不得 delete
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            register_finalizer(object, [](void* p) { static_cast<T*>(p)->~T(); });
+        }
+        return object;
+    }
+
+    // 将文本复制到 Arena 中
+    std::string_view copy(std::string_view text);
+
+    // 当前分配位置，rewind 回收其后分配的全部对象
+    Marker mark() const;
+    void rewind(const Marker& marker);
+
+    // 回收全部对象，保留（合并后的）内存供后续复用
+    void reset();
+
+    // 已分配的字节数 / 持有的内存总量
+    size_t bytes_used() const;
+    size_t bytes_reserved() const;
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;         // 正在使用的块
+    size_t offset = 0;          // 块内已使用的字节
+    size_t next_block_size;
+    Finalizer* finalizers = nullptr;
+
+    void register_finalizer(void* object, void (*destroy)(void*));
+    void run_finalizers(Finalizer* until);
+    void add_block(size_t min_size);
+    void release();
+};
+
+} // namespace cardity
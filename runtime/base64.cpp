@@ -0,0 +1,133 @@
+#include "base64.h"
+#include <cstdint>
+
+namespace cardity {
+
+namespace {
+
+constexpr char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 非法字符标记（位于 24 位结果之外）
+constexpr uint32_t INVALID = 0x01000000;
+
+// 按字符在四元组中的位置预先移位的解码表：四次查表按位或即得 24 位结果，
+// 任一字符非法（包括空白和 '='）时结果带有 INVALID 位
+struct DecodeTables {
+    uint32_t shifted[4][256];
+};
+
+constexpr int char_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+constexpr DecodeTables make_decode_tables() {
+    DecodeTables tables{};
+    for (int c = 0; c < 256; ++c) {
+        int value = char_value(static_cast<unsigned char>(c));
+        for (int position = 0; position < 4; ++position) {
+            tables.shifted[position][c] =
+                value < 0 ? INVALID : static_cast<uint32_t>(value) << (18 - position * 6);
+        }
+    }
+    return tables;
+}
+
+constexpr DecodeTables DECODE = make_decode_tables();
+
+bool is_space(unsigned char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+} // namespace
+
+std::string base64_encode(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::string output(base64_encoded_size(length), '=');
+    char* out = &output[0];
+
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3, out += 4) {
+        uint32_t word = (static_cast<uint32_t>(bytes[i]) << 16) | (static_cast<uint32_t>(bytes[i + 1]) << 8) |
+                        bytes[i + 2];
+        out[0] = ENCODE_TABLE[(word >> 18) & 0x3F];
+        out[1] = ENCODE_TABLE[(word >> 12) & 0x3F];
+        out[2] = ENCODE_TABLE[(word >> 6) & 0x3F];
+        out[3] = ENCODE_TABLE[word & 0x3F];
+    }
+
+    size_t remaining = length - i;
+    if (remaining > 0) {
+        uint32_t word = static_cast<uint32_t>(bytes[i]) << 16;
+        if (remaining == 2) {
+            word |= static_cast<uint32_t>(bytes[i + 1]) << 8;
+        }
+        out[0] = ENCODE_TABLE[(word >> 18) & 0x3F];
+        out[1] = ENCODE_TABLE[(word >> 12) & 0x3F];
+        if (remaining == 2) {
+            out[2] = ENCODE_TABLE[(word >> 6) & 0x3F];
+        }
+    }
+    return output;
+}
+
+bool base64_decode(std::string_view input, std::string& output) {
+    output.resize(base64_decoded_max_size(input.size()));
+    char* out = &output[0];
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(input.data());
+    size_t length = input.size();
+
+    // 快速路径：连续的完整四元组，不含空白和填充
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4, out += 3) {
+        uint32_t word = DECODE.shifted[0][in[i]] | DECODE.shifted[1][in[i + 1]] |
+                        DECODE.shifted[2][in[i + 2]] | DECODE.shifted[3][in[i + 3]];
+        if (word & INVALID) {
+            break;
+        }
+        out[0] = static_cast<char>(word >> 16);
+        out[1] = static_cast<char>(word >> 8);
+        out[2] = static_cast<char>(word);
+    }
+
+    // 逐字符处理剩余部分（空白、填充、不完整的末尾四元组）
+    uint32_t accumulator = 0;
+    int bits = 0;
+    bool padding = false;
+    for (; i < length; ++i) {
+        unsigned char c = in[i];
+        if (is_space(c)) {
+            continue;
+        }
+        if (c == '=') {
+            padding = true;
+            continue;
+        }
+        uint32_t value = DECODE.shifted[3][c];
+        if ((value & INVALID) || padding) {
+            output.clear();
+            return false;
+        }
+        accumulator = (accumulator << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            *out++ = static_cast<char>(accumulator >> bits);
+        }
+    }
+
+    // 末尾只剩一个字符（6 位）不构成完整字节
+    if (bits >= 6) {
+        output.clear();
+        return false;
+    }
+
+    output.resize(static_cast<size_t>(out - output.data()));
+    return true;
+}
+
+} // namespace cardity
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cardity {
+
+// Base64（RFC 4648）编解码
+// 解码同时接受标准字母表（+/）和 URL 安全字母表（-_），忽略空白字符，末尾填充可省略
+
+// 编码结果的长度（含填充）
+inline size_t base64_encoded_size(size_t length) { return (length + 2) / 3 * 4; }
+
+// 解码结果长度的上限
+inline size_t base64_decoded_max_size(size_t length) { return length / 4 * 3 + 3; }
+
+std::string base64_encode(const void* data, size_t length);
+inline std::string base64_encode(std::string_view data) { return base64_encode(data.data(), data.size()); }
+
+// 解码到 output（先按上限分配一次，再截断到实际长度）；输入非法时返回 false
+bool base64_decode(std::string_view input, std::string& output);
+
+} // namespace cardity
@@ -0,0 +1,125 @@
+#include "block_clock.h"
+#include <ctime>
+
+namespace cardity {
+
+namespace {
+
+constexpr int64_t SECONDS_PER_DAY = 86400;
+
+// 公历日期与 1970-01-01 起的天数互相转换（proleptic Gregorian，按 400 年周期计算）
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    const unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+void civil_from_days(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned day_of_era = static_cast<unsigned>(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned mp = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2);
+}
+
+char* write_digits(char* out, unsigned value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+bool read_digits(std::string_view text, size_t pos, int width, unsigned& value) {
+    value = 0;
+    for (int i = 0; i < width; ++i) {
+        char c = text[pos + static_cast<size_t>(i)];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<unsigned>(c - '0');
+    }
+    return true;
+}
+
+} // namespace
+
+BlockContext SystemClock::now() const {
+    // 墙钟回拨时保持上一次的时间，时间戳单调不减
+    int64_t time = static_cast<int64_t>(std::time(nullptr));
+    int64_t previous = last.load(std::memory_order_relaxed);
+    while (time > previous && !last.compare_exchange_weak(previous, time, std::memory_order_relaxed)) {
+    }
+    return BlockContext(0, time > previous ? time : previous);
+}
+
+const SystemClock& SystemClock::instance() {
+    static SystemClock clock;
+    return clock;
+}
+
+BlockContext ManualClock::now() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+void ManualClock::set(const BlockContext& context) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = context;
+}
+
+std::string format_timestamp(int64_t time) {
+    int64_t days = time / SECONDS_PER_DAY;
+    int64_t seconds = time % SECONDS_PER_DAY;
+    if (seconds < 0) {
+        seconds += SECONDS_PER_DAY;
+        --days;
+    }
+
+    int64_t year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    civil_from_days(days, year, month, day);
+    if (year < 0 || year > 9999) {
+        return std::to_string(time);
+    }
+
+    // "YYYY-MM-DD HH:MM:SS"
+    std::string text(19, '-');
+    char* out = &text[0];
+    out = write_digits(out, static_cast<unsigned>(year), 4) + 1;
+    out = write_digits(out, month, 2) + 1;
+    out = write_digits(out, day, 2);
+    *out++ = ' ';
+    out = write_digits(out, static_cast<unsigned>(seconds / 3600), 2);
+    *out++ = ':';
+    out = write_digits(out, static_cast<unsigned>(seconds / 60 % 60), 2);
+    *out++ = ':';
+    write_digits(out, static_cast<unsigned>(seconds % 60), 2);
+    return text;
+}
+
+bool parse_timestamp(std::string_view text, int64_t& time) {
+    unsigned year, month, day, hour, minute, second;
+    if (text.size() != 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' ||
+        text[16] != ':' || !read_digits(text, 0, 4, year) || !read_digits(text, 5, 2, month) ||
+        !read_digits(text, 8, 2, day) || !read_digits(text, 11, 2, hour) || !read_digits(text, 14, 2, minute) ||
+        !read_digits(text, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    time = days_from_civil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+} // namespace cardity
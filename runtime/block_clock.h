@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace cardity {
+
+// 区块上下文：事件和快照以整数记录时间，只在导出 JSON 或显示时格式化
+struct BlockContext {
+    uint64_t height = 0;    // 区块高度（系统时钟为 0）
+    int64_t time = 0;       // 区块时间（Unix 秒，UTC）
+
+    BlockContext() = default;
+    BlockContext(uint64_t h, int64_t t) : height(h), time(t) {}
+};
+
+// 时钟：为运行时提供当前区块上下文
+// 同一个时钟可能由多个运行时（例如 ParallelReplay 的工作实例）在不同线程上同时读取，实现必须线程安全
+class BlockClock {
+public:
+    virtual ~BlockClock() = default;
+    virtual BlockContext now() const = 0;
+};
+
+// 系统时钟：区块时间取墙钟时间（单调不减），高度为 0
+class SystemClock : public BlockClock {
+public:
+    BlockContext now() const override;
+
+    // 进程范围的默认实例（RuntimeConfig 未设置时钟时使用）
+    static const SystemClock& instance();
+
+private:
+    mutable std::atomic<int64_t> last{0};
+};
+
+// 由调用方推进的时钟：索引器在处理每个区块前设置区块上下文，重放结果与墙钟无关
+class ManualClock : public BlockClock {
+public:
+    ManualClock() = default;
+    explicit ManualClock(const BlockContext& context) : current(context) {}
+
+    BlockContext now() const override;
+    void set(const BlockContext& context);
+    void set(uint64_t height, int64_t time) { set(BlockContext(height, time)); }
+
+private:
+    mutable std::mutex mutex;
+    BlockContext current;
+};
+
+// 将 Unix 秒格式化为 "YYYY-MM-DD HH:MM:SS"（UTC，不依赖时区和 localtime）
+std::string format_timestamp(int64_t time);
+
+// format_timestamp 的逆操作；格式不符时返回 false
+bool parse_timestamp(std::string_view text, int64_t& time);
+
+} // namespace cardity
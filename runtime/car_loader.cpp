@@ -1,33 +1,511 @@
 #include "car_loader.h"
+#include "logic_engine.h"
+#include "log.h"
+#include "sha256.h"
+#include "base64.h"
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <cctype>
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CARDITY_SOURCE_MMAP 1
+#endif
+
 namespace cardity {
 
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// SAX 方式直接构建 CarProtocol
+// 与 load_from_parsed 的结果一致：对象成员最终按键名排序（与 JSON 文档对象的遍历顺序相同），
+// 重复键以最后一次为准。遇到 DOM 路径有特殊处理的结构（类型不符、重复的段落等）时
+// 标记 fallback 并中止，由调用方改用 DOM 路径处理
+class CarSaxBuilder : public nlohmann::json_sax<json> {
+public:
+    explicit CarSaxBuilder(CarProtocol& target) : protocol(target) {}
+
+    bool needs_fallback() const { return fallback; }
+    bool has_cpl() const { return seen_cpl; }
+    const std::string& error_message() const { return error; }
+
+    // 按键名排序后写入 CPL
+    void finish() {
+        insert_sorted(state_entries, protocol.cpl.state);
+        insert_sorted(method_entries, protocol.cpl.methods);
+        insert_sorted(event_entries, protocol.cpl.events);
+    }
+
+    bool null() override { return scalar(nullptr); }
+    bool boolean(bool) override { return scalar(nullptr); }
+    bool number_integer(number_integer_t) override { return scalar(nullptr); }
+    bool number_unsigned(number_unsigned_t) override { return scalar(nullptr); }
+    bool number_float(number_float_t, const string_t&) override { return scalar(nullptr); }
+    bool binary(binary_t&) override { return scalar(nullptr); }
+    bool string(string_t& value) override { return scalar(&value); }
+
+    bool key(string_t& value) override {
+        current_key = std::move(value);
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        if (stack.empty()) {
+            return enter(Context::TOP);
+        }
+        switch (stack.back()) {
+            case Context::TOP:
+                if (current_key == "cpl") {
+                    if (seen_cpl) {
+                        return unsupported();
+                    }
+                    seen_cpl = true;
+                    return enter(Context::CPL);
+                }
+                return is_header_field(current_key) ? unsupported() : enter(Context::SKIP);
+            case Context::CPL:
+                if (current_key == "state") {
+                    return enter_section(seen_state, Context::STATE);
+                }
+                if (current_key == "methods") {
+                    return enter_section(seen_methods, Context::METHODS);
+                }
+                if (current_key == "events") {
+                    return enter_section(seen_events, Context::EVENTS);
+                }
+                return current_key == "owner" ? unsupported() : enter(Context::SKIP);
+            case Context::STATE:
+                state_entries.emplace_back(current_key, StateVariable("string", ""));
+                return enter(Context::VAR);
+            case Context::VAR:
+                return (current_key == "type" || current_key == "default") ? unsupported() : enter(Context::SKIP);
+            case Context::METHODS:
+                method_entries.emplace_back(current_key, Method());
+                return enter(Context::METHOD);
+            case Context::METHOD:
+                if (current_key == "returns") {
+                    method_entries.back().second.returns.clear();
+                    return enter(Context::RETURNS);
+                }
+                return (current_key == "params" || current_key == "logic") ? unsupported() : enter(Context::SKIP);
+            case Context::RETURNS:
+                return current_key == "expr" ? unsupported() : enter(Context::SKIP);
+            case Context::EVENTS:
+                event_entries.emplace_back(current_key, Event());
+                return enter(Context::EVENT);
+            case Context::EVENT:
+                return current_key == "params" ? unsupported() : enter(Context::SKIP);
+            case Context::EVENT_PARAMS:
+                param_name.clear();
+                has_param_name = false;
+                return enter(Context::EVENT_PARAM);
+            case Context::EVENT_PARAM:
+                return current_key == "name" ? unsupported() : enter(Context::SKIP);
+            case Context::PARAMS:
+            case Context::LOGIC:
+                return unsupported();
+            case Context::SKIP:
+                return enter(Context::SKIP);
+        }
+        return unsupported();
+    }
+
+    bool end_object() override {
+        Context closed = stack.back();
+        stack.pop_back();
+        if (closed == Context::EVENT_PARAM && has_param_name) {
+            event_entries.back().second.params.push_back(std::move(param_name));
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (stack.empty()) {
+            return unsupported();
+        }
+        switch (stack.back()) {
+            case Context::TOP:
+                return (current_key == "cpl" || is_header_field(current_key)) ? unsupported() : enter(Context::SKIP);
+            case Context::CPL:
+                return (current_key == "state" || current_key == "methods" || current_key == "events" ||
+                        current_key == "owner") ? unsupported() : enter(Context::SKIP);
+            case Context::STATE:
+                return unsupported();
+            case Context::VAR:
+                return (current_key == "type" || current_key == "default") ? unsupported() : enter(Context::SKIP);
+            case Context::METHODS:
+                // 非对象的方法定义没有任何字段
+                method_entries.emplace_back(current_key, Method());
+                return enter(Context::SKIP);
+            case Context::METHOD:
+                if (current_key == "params") {
+                    method_entries.back().second.params.clear();
+                    return enter(Context::PARAMS);
+                }
+                if (current_key == "logic") {
+                    method_entries.back().second.logic.clear();
+                    return enter(Context::LOGIC);
+                }
+                return current_key == "returns" ? unsupported() : enter(Context::SKIP);
+            case Context::RETURNS:
+                return current_key == "expr" ? unsupported() : enter(Context::SKIP);
+            case Context::EVENTS:
+                event_entries.emplace_back(current_key, Event());
+                return enter(Context::SKIP);
+            case Context::EVENT:
+                if (current_key == "params") {
+                    event_entries.back().second.params.clear();
+                    return enter(Context::EVENT_PARAMS);
+                }
+                return enter(Context::SKIP);
+            case Context::EVENT_PARAMS:
+                return enter(Context::SKIP);
+            case Context::EVENT_PARAM:
+                return current_key == "name" ? unsupported() : enter(Context::SKIP);
+            case Context::PARAMS:
+            case Context::LOGIC:
+                return unsupported();
+            case Context::SKIP:
+                return enter(Context::SKIP);
+        }
+        return unsupported();
+    }
+
+    bool end_array() override {
+        stack.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        error = e.what();
+        return false;
+    }
+
+private:
+    enum class Context {
+        TOP, CPL, STATE, VAR, METHODS, METHOD, PARAMS, LOGIC, RETURNS,
+        EVENTS, EVENT, EVENT_PARAMS, EVENT_PARAM, SKIP
+    };
+
+    CarProtocol& protocol;
+    std::vector<Context> stack;
+    std::string current_key;
+    bool fallback = false;
+    bool seen_cpl = false;
+    bool seen_state = false;
+    bool seen_methods = false;
+    bool seen_events = false;
+    std::string param_name;
+    bool has_param_name = false;
+    std::string error;
+
+    std::vector<std::pair<std::string, StateVariable>> state_entries;
+    std::vector<std::pair<std::string, Method>> method_entries;
+    std::vector<std::pair<std::string, Event>> event_entries;
+
+    static bool is_header_field(const std::string& key) {
+        return key == "p" || key == "op" || key == "protocol" || key == "version" ||
+               key == "hash" || key == "signature";
+    }
+
+    template <typename Value>
+    static void insert_sorted(std::vector<std::pair<std::string, Value>>& entries, FlatHashMap<Value>& target) {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        target.reserve(entries.size());
+        for (auto& entry : entries) {
+            target.insert_or_assign(entry.first, std::move(entry.second));
+        }
+    }
+
+    bool enter(Context context) {
+        stack.push_back(context);
+        return true;
+    }
+
+    bool enter_section(bool& seen, Context context) {
+        if (seen) {
+            return unsupported();
+        }
+        seen = true;
+        return enter(context);
+    }
+
+    bool unsupported() {
+        fallback = true;
+        return false;
+    }
+
+    // 标量值；value 为空表示非字符串
+    bool scalar(std::string* value) {
+        if (stack.empty()) {
+            return unsupported();
+        }
+        switch (stack.back()) {
+            case Context::TOP:
+                if (current_key == "cpl") {
+                    return unsupported();
+                }
+                if (is_header_field(current_key)) {
+                    return value ? assign_header(*value) : unsupported();
+                }
+                return true;
+            case Context::CPL:
+                if (current_key == "owner") {
+                    if (!value) {
+                        return unsupported();
+                    }
+                    protocol.cpl.owner = std::move(*value);
+                    return true;
+                }
+                return (current_key == "state" || current_key == "methods" || current_key == "events")
+                           ? unsupported() : true;
+            case Context::STATE:
+                return unsupported();
+            case Context::VAR:
+                if (current_key == "type" || current_key == "default") {
+                    if (!value) {
+                        return unsupported();
+                    }
+                    StateVariable& var = state_entries.back().second;
+                    (current_key == "type" ? var.type : var.default_value) = std::move(*value);
+                }
+                return true;
+            case Context::METHODS:
+                method_entries.emplace_back(current_key, Method());
+                return true;
+            case Context::METHOD:
+                if (current_key == "params") {
+                    return unsupported();
+                }
+                if (current_key == "logic" || current_key == "returns") {
+                    if (!value) {
+                        return unsupported();
+                    }
+                    Method& method = method_entries.back().second;
+                    (current_key == "logic" ? method.logic : method.returns) = std::move(*value);
+                }
+                return true;
+            case Context::PARAMS:
+                if (!value) {
+                    return unsupported();
+                }
+                method_entries.back().second.params.push_back(std::move(*value));
+                return true;
+            case Context::LOGIC: {
+                if (!value) {
+                    return unsupported();
+                }
+                std::string& logic = method_entries.back().second.logic;
+                if (!logic.empty()) logic += "; ";
+                logic += *value;
+                return true;
+            }
+            case Context::RETURNS:
+                if (current_key == "expr") {
+                    if (!value) {
+                        return unsupported();
+                    }
+                    method_entries.back().second.returns = std::move(*value);
+                }
+                return true;
+            case Context::EVENTS:
+                event_entries.emplace_back(current_key, Event());
+                return true;
+            case Context::EVENT:
+                return current_key == "params" ? unsupported() : true;
+            case Context::EVENT_PARAMS:
+                if (value) {
+                    event_entries.back().second.params.push_back(std::move(*value));
+                }
+                return true;
+            case Context::EVENT_PARAM:
+                if (current_key == "name") {
+                    if (!value) {
+                        return unsupported();
+                    }
+                    param_name = std::move(*value);
+                    has_param_name = true;
+                }
+                return true;
+            case Context::SKIP:
+                return true;
+        }
+        return unsupported();
+    }
+
+    bool assign_header(std::string& value) {
+        if (current_key == "p") protocol.p = std::move(value);
+        else if (current_key == "op") protocol.op = std::move(value);
+        else if (current_key == "protocol") protocol.protocol = std::move(value);
+        else if (current_key == "version") protocol.version = std::move(value);
+        else if (current_key == "hash") protocol.hash = std::move(value);
+        else protocol.signature = std::move(value);
+        return true;
+    }
+};
+
+} // namespace
+
+// SourceBuffer 实现
+bool SourceBuffer::open(const std::string& file_path) {
+    close();
+    
+#ifdef CARDITY_SOURCE_MMAP
+    int fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        CARDITY_LOG_ERROR("Failed to open file: " << file_path);
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* address = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapped = static_cast<const char*>(address);
+            mapped_size = static_cast<size_t>(info.st_size);
+            ::close(fd);
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+    
+    // 无法映射（空文件、管道、非 POSIX 平台）：按文件大小一次读入
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        CARDITY_LOG_ERROR("Failed to open file: " << file_path);
+        return false;
+    }
+    std::streamoff size = file.tellg();
+    if (size > 0) {
+        buffer.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        file.read(&buffer[0], size);
+    } else {
+        file.clear();
+        file.seekg(0);
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    if (file.bad()) {
+        CARDITY_LOG_ERROR("Error loading file: " << file_path);
+        buffer.clear();
+        return false;
+    }
+    return true;
+}
+
+void SourceBuffer::close() {
+#ifdef CARDITY_SOURCE_MMAP
+    if (mapped) {
+        ::munmap(const_cast<char*>(mapped), mapped_size);
+    }
+#endif
+    mapped = nullptr;
+    mapped_size = 0;
+    buffer.clear();
+}
+
 // CarLoader 实现
 std::unique_ptr<CarProtocol> CarLoader::load_from_file(const std::string& file_path) {
+    auto start = Clock::now();
+    SourceBuffer source;
+    if (!source.open(file_path)) {
+        return nullptr;
+    }
+    std::string content_hash = Sha256::hex(source.data());
+    double read_ms = elapsed_ms(start);
+    
+    auto protocol = load_from_source(source.data(), content_hash);
+    if (protocol) {
+        protocol->load_timings.read_ms = read_ms;
+        CARDITY_LOG_INFO("Loaded " << file_path << " (" << protocol->load_timings.bytes << " bytes): read "
+                         << read_ms << " ms, parse " << protocol->load_timings.parse_ms << " ms, compile "
+                         << protocol->load_timings.compile_ms << " ms");
+    }
+    return protocol;
+}
+
+std::unique_ptr<CarProtocol> CarLoader::load_from_json(const std::string& json_str) {
+    return load_from_source(json_str, Sha256::hex(json_str));
+}
+
+std::unique_ptr<CarProtocol> CarLoader::load_from_source(std::string_view json_text, const std::string& content_hash) {
+    auto start = Clock::now();
+    auto protocol = std::make_unique<CarProtocol>();
+    CarSaxBuilder builder(*protocol);
+    
+    bool parsed = false;
     try {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file: " << file_path << std::endl;
+        parsed = json::sax_parse(json_text.begin(), json_text.end(), &builder);
+    } catch (const std::exception& e) {
+        CARDITY_LOG_ERROR("Error loading from JSON: " << e.what());
+        return nullptr;
+    }
+    
+    if (builder.needs_fallback()) {
+        // 结构不常规：交给 DOM 路径，保证错误和取值规则完全一致
+        try {
+            auto fallback = load_from_parsed(json::parse(json_text.begin(), json_text.end()), content_hash);
+            if (fallback) {
+                fallback->load_timings.bytes = json_text.size();
+                fallback->load_timings.parse_ms = elapsed_ms(start) - fallback->load_timings.compile_ms;
+            }
+            return fallback;
+        } catch (const json::exception& e) {
+            CARDITY_LOG_ERROR("JSON parsing error: " << e.what());
             return nullptr;
         }
-        
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return load_from_json(buffer.str());
+    }
+    
+    if (!parsed) {
+        CARDITY_LOG_ERROR("JSON parsing error: " << builder.error_message());
+        return nullptr;
+    }
+    
+    builder.finish();
+    protocol->load_timings.bytes = json_text.size();
+    protocol->load_timings.parse_ms = elapsed_ms(start);
+    protocol->load_timings.streamed = true;
+    
+    try {
+        finish_protocol(*protocol, builder.has_cpl(), content_hash.empty() ? Sha256::hex(json_text) : content_hash);
     } catch (const std::exception& e) {
-        std::cerr << "Error loading file: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error loading from JSON: " << e.what());
         return nullptr;
     }
+    return protocol;
 }
 
-std::unique_ptr<CarProtocol> CarLoader::load_from_json(const std::string& json_str) {
+void CarLoader::finish_protocol(CarProtocol& protocol, bool has_cpl, const std::string& content_hash) {
+    auto start = Clock::now();
+    
+    // 预编译方法逻辑
+    if (has_cpl) {
+        compile_methods(protocol.cpl);
+    }
+    
+    // 内容哈希；文件未声明 hash 时作为协议哈希
+    protocol.content_hash = content_hash;
+    if (protocol.hash.empty()) {
+        protocol.hash = protocol.content_hash;
+    }
+    
+    protocol.load_timings.compile_ms = elapsed_ms(start);
+}
+
+std::unique_ptr<CarProtocol> CarLoader::load_from_parsed(const json& j, const std::string& content_hash) {
     try {
-        json j = json::parse(json_str);
+        auto start = Clock::now();
         auto protocol = std::make_unique<CarProtocol>();
         
         // 解析基本字段
@@ -39,7 +517,8 @@ std::unique_ptr<CarProtocol> CarLoader::load_from_json(const std::string& json_s
         protocol->signature = j.value("signature", "");
         
         // 解析 CPL
-        if (j.contains("cpl")) {
+        bool has_cpl = j.contains("cpl");
+        if (has_cpl) {
             const auto& cpl_json = j["cpl"];
             
             // 解析状态
@@ -60,70 +539,60 @@ std::unique_ptr<CarProtocol> CarLoader::load_from_json(const std::string& json_s
             // 解析所有者
             protocol->cpl.owner = cpl_json.value("owner", "");
         }
+        protocol->load_timings.parse_ms = elapsed_ms(start);
         
-        // 生成 ABI
-        protocol->abi = generate_abi(protocol->cpl, protocol->protocol, protocol->version);
-        
-        // 计算哈希（如果没有提供）
-        if (protocol->hash.empty()) {
-            protocol->hash = calculate_hash(j);
-        }
-        
+        finish_protocol(*protocol, has_cpl, content_hash.empty() ? calculate_hash(j) : content_hash);
         return protocol;
     } catch (const json::exception& e) {
-        std::cerr << "JSON parsing error: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("JSON parsing error: " << e.what());
         return nullptr;
     } catch (const std::exception& e) {
-        std::cerr << "Error loading from JSON: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error loading from JSON: " << e.what());
         return nullptr;
     }
 }
 
 std::unique_ptr<CarProtocol> CarLoader::load_from_base64(const std::string& base64_str) {
-    // 简单的 base64 解码实现
+    // 直接解码到 JSON 解析的输入缓冲区
     std::string decoded;
-    try {
-        // 这里应该使用 proper base64 解码库
-        // 为了简化，我们假设输入已经是 JSON 字符串
-        decoded = base64_str;
-        return load_from_json(decoded);
-    } catch (const std::exception& e) {
-        std::cerr << "Base64 decoding error: " << e.what() << std::endl;
+    if (!base64_decode(base64_str, decoded)) {
+        CARDITY_LOG_ERROR("Base64 decoding error: invalid input");
         return nullptr;
     }
+    return load_from_json(decoded);
 }
 
 bool CarLoader::validate_protocol(const CarProtocol& protocol) {
     // 验证基本字段
     if (protocol.p != "cardinals") {
-        std::cerr << "Invalid protocol type: " << protocol.p << std::endl;
+        CARDITY_LOG_ERROR("Invalid protocol type: " << protocol.p);
         return false;
     }
     
     if (protocol.op != "deploy") {
-        std::cerr << "Invalid operation: " << protocol.op << std::endl;
+        CARDITY_LOG_ERROR("Invalid operation: " << protocol.op);
         return false;
     }
     
     if (protocol.protocol.empty()) {
-        std::cerr << "Protocol name is empty" << std::endl;
+        CARDITY_LOG_ERROR("Protocol name is empty");
         return false;
     }
     
     if (protocol.version.empty()) {
-        std::cerr << "Protocol version is empty" << std::endl;
+        CARDITY_LOG_ERROR("Protocol version is empty");
         return false;
     }
     
     if (protocol.cpl.owner.empty()) {
-        std::cerr << "Protocol owner is empty" << std::endl;
+        CARDITY_LOG_ERROR("Protocol owner is empty");
         return false;
     }
     
     // 验证状态变量
     for (const auto& [name, var] : protocol.cpl.state) {
         if (var.type.empty()) {
-            std::cerr << "State variable " << name << " has empty type" << std::endl;
+            CARDITY_LOG_ERROR("State variable " << name << " has empty type");
             return false;
         }
     }
@@ -131,7 +600,7 @@ bool CarLoader::validate_protocol(const CarProtocol& protocol) {
     // 验证方法
     for (const auto& [name, method] : protocol.cpl.methods) {
         if (method.logic.empty() && method.returns.empty()) {
-            std::cerr << "Method " << name << " has no logic or return value" << std::endl;
+            CARDITY_LOG_ERROR("Method " << name << " has no logic or return value");
             return false;
         }
     }
@@ -185,17 +654,13 @@ json CarLoader::export_to_json(const CarProtocol& protocol) {
     j["cpl"] = cpl;
     
     // 导出 ABI
-    j["abi"] = protocol.abi;
+    j["abi"] = protocol.abi();
     
     return j;
 }
 
 std::string CarLoader::export_to_base64(const CarProtocol& protocol) {
-    json j = export_to_json(protocol);
-    std::string json_str = j.dump();
-    // 这里应该使用 proper base64 编码库
-    // 为了简化，直接返回 JSON 字符串
-    return json_str;
+    return base64_encode(export_to_json(protocol).dump());
 }
 
 void CarLoader::parse_state(const json& state_json, CPL& cpl) {
@@ -230,10 +695,7 @@ void CarLoader::parse_methods(const json& methods_json, CPL& cpl) {
                 method.logic = method_json["logic"].get<std::string>();
             }
             
-            // 调试信息
-            if (name == "increment") {
-                std::cerr << "DEBUG: Increment method logic: '" << method.logic << "'" << std::endl;
-            }
+            CARDITY_LOG_DEBUG("Method " << name << " logic: '" << method.logic << "'");
         }
         
         // 解析返回值
@@ -252,6 +714,24 @@ void CarLoader::parse_methods(const json& methods_json, CPL& cpl) {
     }
 }
 
+void CarLoader::compile_methods(CPL& cpl) {
+    // 为已声明的状态变量分配槽位
+    cpl.state_slots.clear();
+    for (const auto& [name, var] : cpl.state) {
+        cpl.state_slots.push_back(name);
+    }
+    
+    SlotLayout layout;
+    layout.state = cpl.state_slots;
+    for (const auto& name : cpl.state_slots) {
+        layout.state_types.push_back(value_type_from_name(cpl.state.at(name).type));
+    }
+    for (auto& [name, method] : cpl.methods) {
+        layout.params = method.params;
+        method.program = LogicEngine::compile_program(method.logic, method.returns, &layout);
+    }
+}
+
 void CarLoader::parse_events(const json& events_json, CPL& cpl) {
     for (const auto& [name, event_json] : events_json.items()) {
         Event event;
@@ -268,6 +748,14 @@ void CarLoader::parse_events(const json& events_json, CPL& cpl) {
     }
 }
 
+const AbiCache::State& AbiCache::ensure(const CarProtocol& protocol) const {
+    std::call_once(state->once, [&]() {
+        state->abi = CarLoader::generate_abi(protocol.cpl, protocol.protocol, protocol.version);
+        state->serialized = state->abi.dump();
+    });
+    return *state;
+}
+
 json CarLoader::generate_abi(const CPL& cpl, const std::string& protocol_name, const std::string& version) {
     json abi;
     abi["protocol"] = protocol_name;
@@ -308,11 +796,8 @@ json CarLoader::generate_abi(const CPL& cpl, const std::string& protocol_name, c
 }
 
 std::string CarLoader::calculate_hash(const json& data) {
-    // 简单的哈希计算实现
-    // 在实际应用中应该使用 SHA256 等加密哈希
-    std::string data_str = data.dump();
-    std::hash<std::string> hasher;
-    return std::to_string(hasher(data_str));
+    // 对象键按字典序序列化，结果在各平台上一致
+    return Sha256::hex(data.dump());
 }
 
 } // namespace cardity 
\ No newline at end of file
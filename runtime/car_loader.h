@@ -4,12 +4,18 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string_view>
 #include <nlohmann/json.hpp>
+#include "flat_hash_map.h"
 
 namespace cardity {
 
 using json = nlohmann::json;
 
+struct CompiledProgram;
+struct CarProtocol;
+
 // 状态变量定义
 struct StateVariable {
     std::string type;
@@ -25,6 +31,7 @@ struct Method {
     std::vector<std::string> params;
     std::string logic;
     std::string returns;
+    std::shared_ptr<const CompiledProgram> program;  // 加载时预编译的逻辑，所有调用共享
     
     Method() = default;
     Method(const std::vector<std::string>& p, const std::string& l, const std::string& r)
@@ -41,14 +48,48 @@ struct Event {
 
 // CPL (Cardity Protocol Logic) 结构
 struct CPL {
-    std::map<std::string, StateVariable> state;
-    std::map<std::string, Method> methods;
-    std::map<std::string, Event> events;
+    FlatHashMap<StateVariable> state;
+    FlatHashMap<Method> methods;
+    FlatHashMap<Event> events;
     std::string owner;
+    std::vector<std::string> state_slots;    // 状态变量槽位表（加载时按声明分配）
     
     CPL() = default;
 };
 
+// 协议加载耗时（毫秒）
+struct LoadTimings {
+    size_t bytes = 0;           // 源文本字节数
+    double read_ms = 0;         // 读取/映射文件及计算内容哈希
+    double parse_ms = 0;        // 解析 JSON 并填充 CPL
+    double compile_ms = 0;      // 预编译方法
+    bool streamed = false;      // 是否走了流式（SAX）解析路径
+};
+
+// 惰性生成的 ABI：首次访问时生成并缓存 JSON 和序列化文本，之后直接返回缓存
+// 协议由多个实例（可能在不同线程）共享，生成只执行一次；复制协议时不复制缓存
+class AbiCache {
+public:
+    AbiCache() : state(std::make_unique<State>()) {}
+    AbiCache(const AbiCache&) : AbiCache() {}
+    AbiCache& operator=(const AbiCache&) { state = std::make_unique<State>(); return *this; }
+    AbiCache(AbiCache&&) noexcept = default;
+    AbiCache& operator=(AbiCache&&) noexcept = default;
+    
+    const json& get(const CarProtocol& protocol) const { return ensure(protocol).abi; }
+    const std::string& get_serialized(const CarProtocol& protocol) const { return ensure(protocol).serialized; }
+    
+private:
+    struct State {
+        std::once_flag once;
+        json abi;
+        std::string serialized;
+    };
+    std::unique_ptr<State> state;
+    
+    const State& ensure(const CarProtocol& protocol) const;
+};
+
 // 完整的 .car 协议结构
 struct CarProtocol {
     std::string p;           // "cardinals"
@@ -56,11 +97,40 @@ struct CarProtocol {
     std::string protocol;    // 协议名称
     std::string version;     // 版本
     CPL cpl;                 // 协议逻辑
-    json abi;                // ABI 接口
-    std::string hash;        // 文件哈希
+    AbiCache abi_cache;      // ABI 接口（首次访问时生成）
+    std::string hash;        // 协议哈希（文件中的 hash 字段，缺省时等于 content_hash）
+    std::string content_hash; // 协议原始字节的 SHA-256（十六进制），与平台和构建无关
     std::string signature;   // 签名（可选）
+    LoadTimings load_timings;
     
     CarProtocol() = default;
+    
+    // ABI 及其序列化文本（加载完成后协议不再修改，缓存不会失效）
+    const json& abi() const { return abi_cache.get(*this); }
+    const std::string& abi_json() const { return abi_cache.get_serialized(*this); }
+};
+
+// 加载完成（方法已预编译）的协议；多个运行时实例通过 shared_ptr<const CompiledProtocol> 共享同一份
+using CompiledProtocol = CarProtocol;
+
+// 只读的源文件内容：POSIX 上直接映射整个文件，其他平台（含 Emscripten）一次读入单个缓冲区
+class SourceBuffer {
+public:
+    SourceBuffer() = default;
+    ~SourceBuffer() { close(); }
+    
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    
+    bool open(const std::string& file_path);
+    void close();
+    
+    std::string_view data() const { return mapped ? std::string_view(mapped, mapped_size) : std::string_view(buffer); }
+    
+private:
+    const char* mapped = nullptr;
+    size_t mapped_size = 0;
+    std::string buffer;
 };
 
 // .car 文件加载器
@@ -72,6 +142,15 @@ public:
     // 从 JSON 字符串加载协议
     static std::unique_ptr<CarProtocol> load_from_json(const std::string& json_str);
     
+    // 从 JSON 文本加载协议，content_hash 为调用方已计算的原始字节 SHA-256
+    // 使用 SAX 解析直接填充 CPL，不构建中间 JSON 文档；结构不常规时退回 load_from_parsed
+    static std::unique_ptr<CarProtocol> load_from_source(std::string_view json_text, const std::string& content_hash);
+    
+    // 从已解析的 JSON 构建协议（解析状态、方法、事件并预编译）
+    // 未提供 content_hash 时按 JSON 的规范序列化计算
+    static std::unique_ptr<CarProtocol> load_from_parsed(const json& j, const std::string& content_hash = "");
+    
+    
     // 从 base64 编码的字符串加载协议
     static std::unique_ptr<CarProtocol> load_from_base64(const std::string& base64_str);
     
@@ -83,6 +162,9 @@ public:
     
     // 导出协议为 base64
     static std::string export_to_base64(const CarProtocol& protocol);
+    
+    // 生成 ABI（由 CarProtocol::abi() 在首次访问时调用）
+    static json generate_abi(const CPL& cpl, const std::string& protocol_name, const std::string& version);
 
 private:
     // 解析状态定义
@@ -91,13 +173,16 @@ private:
     // 解析方法定义
     static void parse_methods(const json& methods_json, CPL& cpl);
     
+    // 预编译方法逻辑
+    static void compile_methods(CPL& cpl);
+    
+    // 预编译和哈希（解析之后的公共步骤）
+    static void finish_protocol(CarProtocol& protocol, bool has_cpl, const std::string& content_hash);
+    
     // 解析事件定义
     static void parse_events(const json& events_json, CPL& cpl);
     
-    // 生成 ABI
-    static json generate_abi(const CPL& cpl, const std::string& protocol_name, const std::string& version);
-    
-    // 计算哈希
+    // 计算哈希（规范 JSON 序列化的 SHA-256）
     static std::string calculate_hash(const json& data);
 };
 
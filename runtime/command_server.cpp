@@ -0,0 +1,281 @@
+#include "command_server.h"
+#include "log.h"
+#include <iostream>
+#include <stdexcept>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#define CARDITY_SERVER_POLL 1
+#endif
+
+namespace cardity {
+
+namespace {
+
+const std::string& required_string(const json& command, const char* field) {
+    auto it = command.find(field);
+    if (it == command.end() || !it->is_string()) {
+        throw std::invalid_argument(std::string("Missing string field \"") + field + "\"");
+    }
+    return it->get_ref<const std::string&>();
+}
+
+// 命令中的 "args"：数组（按位置）或对象（按参数名），缺省为无参数
+const json& call_args(const json& command) {
+    static const json empty = json::array();
+    auto it = command.find("args");
+    return it == command.end() || it->is_null() ? empty : *it;
+}
+
+// 响应中可能带有非 UTF-8 的状态值，替换非法字节而不是中断会话
+void write_response(std::ostream& out, const json& response) {
+    out << response.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+}
+
+} // namespace
+
+CommandServer::CommandServer(CardityRuntime& rt, const ServerOptions& opts)
+    : runtime(rt), options(opts), last_flush(std::chrono::steady_clock::now()) {}
+
+json CommandServer::handle_line(std::string_view line) {
+    json command = json::parse(line.begin(), line.end(), nullptr, false);
+    if (command.is_discarded()) {
+        json response;
+        response["ok"] = false;
+        response["error"] = "Invalid JSON command";
+        return response;
+    }
+    return handle(command);
+}
+
+json CommandServer::handle(const json& command) {
+    json response = json::object();
+    if (command.is_object()) {
+        auto id = command.find("id");
+        if (id != command.end()) {
+            response["id"] = *id;
+        }
+    }
+
+    try {
+        if (!command.is_object()) {
+            throw std::invalid_argument("Command must be a JSON object");
+        }
+        response["result"] = execute(required_string(command, "cmd"), command);
+        response["ok"] = true;
+    } catch (const std::exception& e) {
+        response.erase("result");
+        response["ok"] = false;
+        response["error"] = e.what();
+    }
+
+    maybe_flush();
+    return response;
+}
+
+json CommandServer::execute(const std::string& cmd, const json& command) {
+    // 调用失败不是命令错误：ok 为 true，结果中 success 为 false
+    if (cmd == "call") {
+        MethodResult result = runtime.call_method_with_json(required_string(command, "method"), call_args(command));
+        dirty = dirty || result.success;
+        return CardityRuntime::method_result_to_json(result);
+    }
+    if (cmd == "simulate") {
+        const std::string& method = required_string(command, "method");
+        const json& args = call_args(command);
+        if (!args.is_array()) {
+            throw std::invalid_argument("simulate takes positional \"args\"");
+        }
+        std::vector<std::string> string_args;
+        string_args.reserve(args.size());
+        for (const auto& arg : args) {
+            string_args.push_back(arg.is_string() ? arg.get<std::string>() : arg.dump());
+        }
+        return CardityRuntime::method_result_to_json(runtime.simulate_method(method, string_args));
+    }
+    if (cmd == "batch") {
+        auto calls = command.find("calls");
+        if (calls == command.end()) {
+            throw std::invalid_argument("Missing array field \"calls\"");
+        }
+        json results = json::array();
+        for (const auto& result : runtime.call_methods_batch_with_json(*calls, command.value("stop_on_error", false))) {
+            dirty = dirty || result.success;
+            results.push_back(CardityRuntime::method_result_to_json(result));
+        }
+        return results;
+    }
+    if (cmd == "get") {
+        const std::string& key = required_string(command, "key");
+        json result;
+        result["key"] = key;
+        result["value"] = runtime.get_state(key);
+        return result;
+    }
+    if (cmd == "set") {
+        const std::string& key = required_string(command, "key");
+        if (!runtime.set_state(key, required_string(command, "value"))) {
+            throw std::runtime_error("Failed to set " + key);
+        }
+        dirty = true;
+        return json::object();
+    }
+    if (cmd == "state") {
+        return runtime.get_all_state();
+    }
+    if (cmd == "events") {
+        json events = json::array();
+        uint64_t next = runtime.for_each_event_since(
+            command.value("since", uint64_t(0)),
+            [&events](uint64_t sequence, const EventInstance& event) {
+                json event_json = CardityRuntime::event_to_json(event);
+                event_json["sequence"] = sequence;
+                events.push_back(std::move(event_json));
+            },
+            command.value("limit", size_t(0)));
+        json result;
+        result["events"] = std::move(events);
+        result["next"] = next;
+        result["dropped"] = runtime.get_event_stream().dropped();
+        return result;
+    }
+    if (cmd == "abi") {
+        return runtime.get_abi();
+    }
+    if (cmd == "metrics") {
+        return runtime.get_metrics();
+    }
+    if (cmd == "snapshot") {
+        std::string block_height = command.value("block_height", std::string());
+        Snapshot snapshot = command.value("delta", false) ? runtime.create_delta_snapshot(block_height)
+                                                          : runtime.create_snapshot(block_height);
+        return CardityRuntime::snapshot_to_json(snapshot);
+    }
+    if (cmd == "flush") {
+        if (!flush()) {
+            throw std::runtime_error("Failed to flush state");
+        }
+        return json::object();
+    }
+    if (cmd == "quit") {
+        finished = true;
+        if (!flush()) {
+            throw std::runtime_error("Failed to flush state");
+        }
+        return json::object();
+    }
+    throw std::invalid_argument("Unknown command: " + cmd);
+}
+
+bool CommandServer::flush() {
+    bool ok = true;
+    if (!options.state_file.empty()) {
+        ok = runtime.save_state_to_file(options.state_file);
+    }
+    if (auto* manager = runtime.get_state_manager()) {
+        ok = manager->flush() && ok;
+    }
+    if (ok) {
+        dirty = false;
+    } else {
+        CARDITY_LOG_ERROR("Failed to flush state");
+    }
+    // 失败时同样推迟下一次尝试，避免每个命令都重试
+    last_flush = std::chrono::steady_clock::now();
+    return ok;
+}
+
+void CommandServer::maybe_flush() {
+    if (dirty && flush_timeout_ms() == 0) {
+        flush();
+    }
+}
+
+int CommandServer::flush_timeout_ms() const {
+    if (!dirty) {
+        return -1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_flush);
+    auto remaining = options.flush_interval - elapsed;
+    return remaining.count() > 0 ? static_cast<int>(remaining.count()) : 0;
+}
+
+int CommandServer::serve(int input_fd, std::ostream& out) {
+#ifdef CARDITY_SERVER_POLL
+    // 自行缓冲输入：poll 的超时用于空闲时的定时落盘，缓冲区为空时才刷新输出
+    std::string buffer;
+    char chunk[64 * 1024];
+    bool eof = false;
+    while (!finished) {
+        size_t start = 0;
+        size_t newline;
+        while (!finished && (newline = buffer.find('\n', start)) != std::string::npos) {
+            std::string_view line(buffer.data() + start, newline - start);
+            start = newline + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (line.find_first_not_of(" \t") != std::string_view::npos) {
+                write_response(out, handle_line(line));
+            }
+        }
+        buffer.erase(0, start);
+        out.flush();
+        if (finished || eof) {
+            break;
+        }
+
+        pollfd input{input_fd, POLLIN, 0};
+        int ready = poll(&input, 1, flush_timeout_ms());
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            CARDITY_LOG_ERROR("Failed to poll command input");
+            break;
+        }
+        if (ready == 0) {
+            maybe_flush();
+            continue;
+        }
+        ssize_t count = read(input_fd, chunk, sizeof(chunk));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            CARDITY_LOG_ERROR("Failed to read command input");
+            break;
+        }
+        if (count == 0) {
+            // 最后一行可能没有换行符
+            eof = true;
+            if (!buffer.empty()) {
+                buffer.push_back('\n');
+            }
+            continue;
+        }
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+#else
+    // 没有 poll 的平台：逐行阻塞读取标准输入，只在命令之间检查落盘时间
+    (void)input_fd;
+    std::string line;
+    while (!finished && std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") != std::string::npos) {
+            write_response(out, handle_line(line));
+            out.flush();
+        }
+    }
+#endif
+
+    bool flushed = !dirty || flush();
+    out.flush();
+    return flushed ? 0 : 1;
+}
+
+} // namespace cardity
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include "runtime.h"
+
+namespace cardity {
+
+// 行协议服务的配置
+struct ServerOptions {
+    std::string state_file;                         // 为空时不写状态文件（状态日志仍会 flush）
+    std::chrono::milliseconds flush_interval{1000}; // 状态落盘间隔，0 表示每个写入命令后立即落盘
+
+    ServerOptions() = default;
+};
+
+// 常驻的命令服务：运行时在整个会话中保持加载，逐行读取 JSON 命令，每个命令输出一行 JSON 响应（NDJSON）
+// 命令：{"id": 任意（原样返回）, "cmd": "...", ...}
+//   call / simulate {"method", "args": [...] 或 {...}}   batch {"calls": [...], "stop_on_error"}
+//   get {"key"}   set {"key", "value"}   state   events {"since", "limit"}   abi   metrics
+//   snapshot {"block_height", "delta"}   flush   quit
+// 响应：{"id", "ok": true, "result": ...} 或 {"id", "ok": false, "error": "..."}
+// 写入命令之后状态在 flush_interval 内落盘（空闲时也会按时落盘），quit 或输入结束时总是落盘
+class CommandServer {
+public:
+    CommandServer(CardityRuntime& runtime, const ServerOptions& options);
+
+    // 处理一个命令
+    json handle(const json& command);
+    json handle_line(std::string_view line);
+
+    // 从 input_fd 读取命令直到输入结束或 quit，响应写入 out；返回进程退出码
+    // 输入中已无待处理的命令时才刷新输出，管道中连续的命令不会逐行刷新
+    int serve(int input_fd, std::ostream& out);
+
+    // 将状态写入 state_file 并 flush 状态日志
+    bool flush();
+
+    bool is_finished() const { return finished; }
+    bool has_unflushed_writes() const { return dirty; }
+
+private:
+    CardityRuntime& runtime;
+    ServerOptions options;
+    bool dirty = false;
+    bool finished = false;
+    std::chrono::steady_clock::time_point last_flush;
+
+    json execute(const std::string& cmd, const json& command);
+
+    // 有写入且已到落盘时间时落盘
+    void maybe_flush();
+
+    // 距下一次计划落盘的毫秒数，没有待落盘的写入时为 -1
+    int flush_timeout_ms() const;
+};
+
+} // namespace cardity
@@ -0,0 +1,130 @@
+#include "event_log.h"
+#include <algorithm>
+
+namespace cardity {
+
+const std::string& EventInstance::name() const {
+    static const std::string empty;
+    return interned_name ? *interned_name : empty;
+}
+
+EventName EventNameTable::intern(std::string_view name) {
+    auto result = names.try_emplace(name);
+    if (result.second) {
+        result.first->second = std::make_shared<const std::string>(name);
+    }
+    return result.first->second;
+}
+
+EventLog::EventLog(size_t capacity) : capacity(capacity) {}
+
+uint64_t EventLog::append(EventInstance event) {
+    push(std::move(event));
+    uint64_t sequence = next - 1;
+    const EventInstance& stored = at(count - 1);
+    for (const auto& subscriber : subscribers) {
+        subscriber.second(sequence, stored);
+    }
+    return sequence;
+}
+
+void EventLog::restore(std::vector<EventInstance> events, bool replace, uint64_t first_sequence) {
+    // 追加的事件与已有事件之间有缺口（来源日志超出容量覆盖了中间的事件）时，
+    // 已有事件在来源中也已被覆盖，同样丢弃，保证序号与来源一致
+    if (replace || first_sequence > next) {
+        head = 0;
+        count = 0;
+        next = first_sequence;
+    }
+    for (auto& event : events) {
+        push(std::move(event));
+    }
+}
+
+void EventLog::for_each(const EventVisitor& visitor) const {
+    uint64_t sequence = first_sequence();
+    for (size_t i = 0; i < count; ++i) {
+        visitor(sequence + i, at(i));
+    }
+}
+
+uint64_t EventLog::for_each_since(uint64_t cursor, const EventVisitor& visitor, size_t limit) const {
+    uint64_t start = std::min(std::max(cursor, first_sequence()), next);
+    uint64_t end = (limit == 0 || next - start <= limit) ? next : start + limit;
+    for (uint64_t sequence = start; sequence < end; ++sequence) {
+        visitor(sequence, at(static_cast<size_t>(sequence - first_sequence())));
+    }
+    return end;
+}
+
+std::vector<EventInstance> EventLog::copy_since(uint64_t cursor) const {
+    std::vector<EventInstance> events;
+    uint64_t start = std::min(std::max(cursor, first_sequence()), next);
+    events.reserve(static_cast<size_t>(next - start));
+    for_each_since(start, [&events](uint64_t, const EventInstance& event) { events.push_back(event); });
+    return events;
+}
+
+size_t EventLog::subscribe(EventVisitor subscriber) {
+    size_t id = next_subscriber++;
+    subscribers.emplace_back(id, std::move(subscriber));
+    return id;
+}
+
+bool EventLog::unsubscribe(size_t id) {
+    auto it = std::find_if(subscribers.begin(), subscribers.end(),
+                           [id](const auto& entry) { return entry.first == id; });
+    if (it == subscribers.end()) {
+        return false;
+    }
+    subscribers.erase(it);
+    return true;
+}
+
+void EventLog::clear() {
+    // 保留 ring 的槽位供后续事件复用
+    head = 0;
+    count = 0;
+}
+
+void EventLog::set_capacity(size_t new_capacity) {
+    capacity = new_capacity;
+    if (capacity == 0 || ring.size() <= capacity) {
+        return;
+    }
+    linearize();
+    if (count <= capacity) {
+        return;
+    }
+    size_t excess = count - capacity;
+    ring.erase(ring.begin(), ring.begin() + static_cast<std::ptrdiff_t>(excess));
+    count = capacity;
+    dropped_count += excess;
+}
+
+void EventLog::push(EventInstance&& event) {
+    if (capacity != 0 && count == capacity) {
+        // 已满：覆盖最旧的事件
+        ring[head] = std::move(event);
+        head = (head + 1) % ring.size();
+        ++dropped_count;
+    } else if (count < ring.size()) {
+        ring[(head + count) % ring.size()] = std::move(event);
+        ++count;
+    } else {
+        // 未达到容量上限时按需增长
+        linearize();
+        ring.push_back(std::move(event));
+        ++count;
+    }
+    ++next;
+}
+
+void EventLog::linearize() {
+    // 保留的事件移到 [0, count)，丢弃多余的槽位
+    std::rotate(ring.begin(), ring.begin() + static_cast<std::ptrdiff_t>(head), ring.end());
+    ring.resize(count);
+    head = 0;
+}
+
+} // namespace cardity
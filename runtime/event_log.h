@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "block_clock.h"
+#include "flat_hash_map.h"
+
+namespace cardity {
+
+// 驻留的事件名：同名事件共享一份字符串，复制事件时不复制名称
+using EventName = std::shared_ptr<const std::string>;
+
+// 事件实例
+struct EventInstance {
+    EventName interned_name;
+    std::vector<std::string> values;
+    BlockContext block;         // 提交时的区块上下文
+
+    EventInstance() = default;
+    EventInstance(EventName n, std::vector<std::string> v)
+        : interned_name(std::move(n)), values(std::move(v)) {}
+    EventInstance(const std::string& n, const std::vector<std::string>& v)
+        : interned_name(std::make_shared<const std::string>(n)), values(v) {}
+
+    const std::string& name() const;
+};
+
+// 事件名驻留表（每个运行时一个，非线程安全）
+class EventNameTable {
+public:
+    // 返回 name 的共享副本，首次出现时分配
+    EventName intern(std::string_view name);
+
+    size_t size() const { return names.size(); }
+    void clear() { names.clear(); }
+
+private:
+    FlatHashMap<EventName> names;
+};
+
+// 事件的流式消费者：sequence 是事件在日志中的全局序号（从 0 开始连续递增）
+using EventVisitor = std::function<void(uint64_t sequence, const EventInstance& event)>;
+
+// 有界事件日志（环形缓冲区）
+// 每个事件按追加顺序获得全局序号；超过容量时覆盖最旧的事件（first_sequence 随之前移）。
+// 索引器保存上次读到的序号，用 for_each_since 增量读取，或通过 subscribe 在事件提交时直接接收，
+// 不需要反复读取整个日志。需要完整历史的消费者应在事件被覆盖前取走（见 subscribe）。
+// 非线程安全，由所属的运行时串行访问
+class EventLog {
+public:
+    // capacity 为 0 表示不设上限
+    explicit EventLog(size_t capacity = 0);
+
+    // 追加事件并通知订阅者，返回事件序号
+    uint64_t append(EventInstance event);
+
+    // 恢复事件（快照恢复使用）：不通知订阅者；事件按值传入并逐个移入日志
+    // replace 时先清空日志，第一个事件的序号为 first_sequence；
+    // 追加时 first_sequence 晚于 next_sequence 说明中间的事件已丢失，同样先清空
+    void restore(std::vector<EventInstance> events, bool replace, uint64_t first_sequence = 0);
+
+    // 遍历保留的全部事件（从旧到新）
+    void for_each(const EventVisitor& visitor) const;
+
+    // 从 cursor 开始遍历，最多 limit 个（0 表示不限），返回下一次读取应使用的 cursor
+    // cursor 早于保留的最旧事件时从最旧事件开始（中间的事件已被覆盖）
+    uint64_t for_each_since(uint64_t cursor, const EventVisitor& visitor, size_t limit = 0) const;
+
+    // 复制 cursor 之后保留的事件
+    std::vector<EventInstance> copy_since(uint64_t cursor) const;
+
+    // 订阅新事件，返回订阅编号；回调在 append 中同步调用，不得再向同一日志追加事件
+    size_t subscribe(EventVisitor subscriber);
+    bool unsubscribe(size_t id);
+
+    // 清空事件，序号从 next_sequence 继续；订阅保留
+    void clear();
+
+    // 调整容量，缩小时丢弃最旧的事件
+    void set_capacity(size_t new_capacity);
+    size_t get_capacity() const { return capacity; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint64_t first_sequence() const { return next - count; }   // 保留的最旧事件的序号
+    uint64_t next_sequence() const { return next; }            // 下一个事件的序号
+    uint64_t dropped() const { return dropped_count; }         // 因容量被覆盖的事件数
+
+private:
+    std::vector<EventInstance> ring;
+    size_t head = 0;            // 最旧事件在 ring 中的位置
+    size_t count = 0;
+    size_t capacity;
+    uint64_t next = 0;
+    uint64_t dropped_count = 0;
+
+    std::vector<std::pair<size_t, EventVisitor>> subscribers;
+    size_t next_subscriber = 1;
+
+    const EventInstance& at(size_t index) const { return ring[(head + index) % ring.size()]; }
+    void push(EventInstance&& event);
+    void linearize();
+};
+
+} // namespace cardity
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+namespace cardity {
+
+// 以字符串为键的扁平哈希表（热路径查找表使用）
+// 条目按插入顺序连续存放在一个 vector 中，另有一个开放寻址（线性探测）索引数组，
+// 查找只访问索引和一个条目，没有逐节点分配；find/count/operator[] 支持 string_view 异构查找。
+// 与 std::map 的区别：
+//   - 遍历顺序为插入顺序（erase 会把最后一个条目移到被删除的位置）
+//   - 插入可能使迭代器和引用失效
+//   - 条目类型为 std::pair<std::string, Value>，不得通过迭代器修改键
+// Hash 默认为 std::hash<std::string_view>；测试可以传入可控的哈希函数以构造冲突和回绕
+template <typename Value, typename Hash = std::hash<std::string_view>>
+class FlatHashMap {
+public:
+    using key_type = std::string;
+    using mapped_type = Value;
+    using value_type = std::pair<std::string, Value>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    FlatHashMap() = default;
+
+    // 迭代
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    void clear() {
+        entries.clear();
+        buckets.clear();
+    }
+
+    void reserve(size_t count) {
+        entries.reserve(count);
+        if (count * 2 > buckets.size()) {
+            rehash(count * 2);
+        }
+    }
+
+    // 查找
+    iterator find(std::string_view key) {
+        size_t index = find_index(key);
+        return index == npos ? entries.end() : entries.begin() + index;
+    }
+
+    const_iterator find(std::string_view key) const {
+        size_t index = find_index(key);
+        return index == npos ? entries.end() : entries.begin() + index;
+    }
+
+    size_t count(std::string_view key) const { return find_index(key) == npos ? 0 : 1; }
+    bool contains(std::string_view key) const { return find_index(key) != npos; }
+
+    Value& at(std::string_view key) {
+        size_t index = find_index(key);
+        if (index == npos) {
+            throw std::out_of_range("FlatHashMap::at: key not found");
+        }
+        return entries[index].second;
+    }
+
+    const Value& at(std::string_view key) const {
+        size_t index = find_index(key);
+        if (index == npos) {
+            throw std::out_of_range("FlatHashMap::at: key not found");
+        }
+        return entries[index].second;
+    }
+
+    // 插入
+    Value& operator[](std::string_view key) {
+        return try_emplace(key).first->second;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(std::string_view key, Args&&... args) {
+        uint64_t hash = hash_of(key);
+        size_t index = find_index(key, hash);
+        if (index != npos) {
+            return {entries.begin() + index, false};
+        }
+
+        if ((entries.size() + 1) * 2 > buckets.size()) {
+            rehash(buckets.empty() ? 8 : buckets.size() * 2);
+        }
+
+        entries.emplace_back(std::piecewise_construct,
+                             std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        insert_bucket(entries.size() - 1, hash);
+        return {entries.end() - 1, true};
+    }
+
+    std::pair<iterator, bool> insert(const value_type& entry) {
+        return try_emplace(entry.first, entry.second);
+    }
+
+    template <typename V>
+    std::pair<iterator, bool> insert_or_assign(std::string_view key, V&& value) {
+        auto result = try_emplace(key, std::forward<V>(value));
+        if (!result.second) {
+            result.first->second = std::forward<V>(value);
+        }
+        return result;
+    }
+
+    // 删除：从索引中移除（后移删除，不留墓碑），并用最后一个条目填补空位
+    size_t erase(std::string_view key) {
+        size_t index = find_index(key);
+        if (index == npos) {
+            return 0;
+        }
+        erase_index(index);
+        return 1;
+    }
+
+    iterator erase(iterator pos) {
+        size_t index = static_cast<size_t>(pos - entries.begin());
+        erase_index(index);
+        return entries.begin() + index;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // 索引桶：条目下标 + 1（0 表示空桶），以及折叠后的哈希值用于快速排除
+    struct Bucket {
+        uint32_t index;
+        uint32_t tag;
+    };
+
+    std::vector<value_type> entries;
+    std::vector<Bucket> buckets;        // 容量为 2 的幂，负载因子不超过 0.5
+
+    static uint64_t hash_of(std::string_view key) {
+        return static_cast<uint64_t>(Hash()(key));
+    }
+
+    static uint32_t tag_of(uint64_t hash) {
+        return static_cast<uint32_t>(hash >> 32) ^ static_cast<uint32_t>(hash);
+    }
+
+    size_t mask() const { return buckets.size() - 1; }
+
+    size_t find_index(std::string_view key) const {
+        return buckets.empty() ? npos : find_index(key, hash_of(key));
+    }
+
+    size_t find_index(std::string_view key, uint64_t hash) const {
+        if (buckets.empty()) {
+            return npos;
+        }
+        uint32_t tag = tag_of(hash);
+        for (size_t b = hash & mask();; b = (b + 1) & mask()) {
+            const Bucket& bucket = buckets[b];
+            if (bucket.index == 0) {
+                return npos;
+            }
+            if (bucket.tag == tag && entries[bucket.index - 1].first == key) {
+                return bucket.index - 1;
+            }
+        }
+    }
+
+    // 返回指向 entry_index 的桶位置
+    size_t bucket_of(size_t entry_index) const {
+        uint64_t hash = hash_of(entries[entry_index].first);
+        for (size_t b = hash & mask();; b = (b + 1) & mask()) {
+            if (buckets[b].index == entry_index + 1) {
+                return b;
+            }
+        }
+    }
+
+    void insert_bucket(size_t entry_index, uint64_t hash) {
+        size_t b = hash & mask();
+        while (buckets[b].index != 0) {
+            b = (b + 1) & mask();
+        }
+        buckets[b] = Bucket{static_cast<uint32_t>(entry_index + 1), tag_of(hash)};
+    }
+
+    void rehash(size_t capacity) {
+        size_t size = 8;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        buckets.assign(size, Bucket{0, 0});
+        for (size_t i = 0; i < entries.size(); ++i) {
+            insert_bucket(i, hash_of(entries[i].first));
+        }
+    }
+
+    void erase_index(size_t index) {
+        // 线性探测的后移删除：把后续同簇中可以前移的桶前移
+        size_t hole = bucket_of(index);
+        buckets[hole] = Bucket{0, 0};
+        for (size_t b = (hole + 1) & mask(); buckets[b].index != 0; b = (b + 1) & mask()) {
+            size_t home = hash_of(entries[buckets[b].index - 1].first) & mask();
+            // home 不在 (hole, b] 区间内时，该桶可以移到空位
+            bool movable = hole <= b ? (home <= hole || home > b) : (home <= hole && home > b);
+            if (movable) {
+                buckets[hole] = buckets[b];
+                buckets[b] = Bucket{0, 0};
+                hole = b;
+            }
+        }
+
+        // 最后一个条目移到被删除的位置
+        size_t last = entries.size() - 1;
+        if (index != last) {
+            size_t b = bucket_of(last);
+            entries[index] = std::move(entries[last]);
+            buckets[b].index = static_cast<uint32_t>(index + 1);
+        }
+        entries.pop_back();
+    }
+};
+
+} // namespace cardity
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+
+namespace cardity {
+
+// 日志级别
+enum class LogLevel {
+    NONE = 0,
+    ERROR = 1,
+    WARN = 2,
+    INFO = 3,
+    DEBUG = 4
+};
+
+// 编译期日志上限：高于该级别的日志语句整体被编译掉
+// 发布版（NDEBUG）和 Emscripten 构建默认只保留 ERROR/WARN
+#ifndef CARDITY_LOG_MAX_LEVEL
+#if defined(NDEBUG) || defined(__EMSCRIPTEN__)
+#define CARDITY_LOG_MAX_LEVEL 2
+#else
+#define CARDITY_LOG_MAX_LEVEL 4
+#endif
+#endif
+
+// 运行时日志级别（进程范围）
+inline std::atomic<int>& log_level_storage() {
+    static std::atomic<int> level{static_cast<int>(LogLevel::WARN)};
+    return level;
+}
+
+inline void set_log_level(LogLevel level) {
+    log_level_storage().store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+inline LogLevel get_log_level() {
+    return static_cast<LogLevel>(log_level_storage().load(std::memory_order_relaxed));
+}
+
+inline bool log_enabled(LogLevel level) {
+    return static_cast<int>(level) <= log_level_storage().load(std::memory_order_relaxed);
+}
+
+} // namespace cardity
+
+// 日志宏：message 可以是任意 << 表达式，仅在级别启用时求值
+// 整行先格式化再一次写出，多个线程同时记录日志时行不会交错
+#define CARDITY_LOG(level, message)                                                      \
+    do {                                                                                 \
+        if (static_cast<int>(::cardity::LogLevel::level) <= CARDITY_LOG_MAX_LEVEL &&     \
+            ::cardity::log_enabled(::cardity::LogLevel::level)) {                        \
+            std::ostringstream cardity_log_line;                                         \
+            cardity_log_line << message << '\n';                                         \
+            std::cerr << cardity_log_line.str() << std::flush;                           \
+        }                                                                                \
+    } while (0)
+
+#define CARDITY_LOG_ERROR(message) CARDITY_LOG(ERROR, message)
+#define CARDITY_LOG_WARN(message) CARDITY_LOG(WARN, message)
+#define CARDITY_LOG_INFO(message) CARDITY_LOG(INFO, message)
+#define CARDITY_LOG_DEBUG(message) CARDITY_LOG(DEBUG, message)
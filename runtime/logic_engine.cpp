@@ -1,79 +1,498 @@
 #include "logic_engine.h"
+#include "log.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
-#include <regex>
+#include <cstring>
 
 namespace cardity {
 
+namespace {
+
+// 去除两端的指定字符，返回原文本的子串（不分配）
+std::string_view strip(std::string_view text, std::string_view front, std::string_view back) {
+    size_t begin = text.find_first_not_of(front);
+    if (begin == std::string_view::npos) {
+        return std::string_view();
+    }
+    text.remove_prefix(begin);
+    return text.substr(0, text.find_last_not_of(back) + 1);
+}
+
+std::string_view trim(std::string_view str) {
+    return strip(str, " \t\r\n", " \t\r\n");
+}
+
+bool is_identifier_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_param_reference(std::string_view name) {
+    return name.compare(0, 7, "params.") == 0;
+}
+
+// 按顶层分号拆分语句，忽略花括号、圆括号和引号内部的分号
+// 每条语句（已去除两端空白）以 logic 的子串交给 visit
+template <typename Visitor>
+void for_each_statement(std::string_view logic, Visitor&& visit) {
+    int depth = 0;
+    char quote = 0;
+    size_t start = 0;
+    
+    for (size_t i = 0; i < logic.size(); ++i) {
+        char c = logic[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '{' || c == '(') {
+            ++depth;
+        } else if ((c == '}' || c == ')') && depth > 0) {
+            --depth;
+        } else if (c == ';' && depth == 0) {
+            std::string_view stmt = trim(logic.substr(start, i - start));
+            if (!stmt.empty()) visit(stmt);
+            start = i + 1;
+        }
+    }
+    
+    std::string_view stmt = trim(logic.substr(start));
+    if (!stmt.empty()) visit(stmt);
+}
+
+// 查找赋值用的 =（不属于 == != <= >=，且不在引号内），未找到返回 npos
+size_t find_assignment(std::string_view text) {
+    char quote = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '=') {
+            bool compound = (i > 0 && std::strchr("=!<>", text[i - 1])) ||
+                            (i + 1 < text.size() && text[i + 1] == '=');
+            if (!compound) {
+                return i;
+            }
+            ++i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// 按顶层逗号拆分实参列表，忽略括号和引号内部的逗号；每个实参（已去除两端空白）交给 visit
+// 返回实参个数（空列表为 0）
+template <typename Visitor>
+size_t for_each_argument(std::string_view arguments, Visitor&& visit) {
+    if (trim(arguments).empty()) {
+        return 0;
+    }
+    
+    int depth = 0;
+    char quote = 0;
+    size_t start = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        char c = arguments[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')' && depth > 0) {
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            visit(trim(arguments.substr(start, i - start)));
+            ++count;
+            start = i + 1;
+        }
+    }
+    visit(trim(arguments.substr(start)));
+    return count + 1;
+}
+
+// 语句的组成部分（均为语句文本的子串）
+struct StatementText {
+    StatementType type = StatementType::EXPRESSION;
+    std::string_view target;        // 赋值目标 / 事件名
+    std::string_view expression;    // 表达式 / 赋值右值 / 条件
+    std::string_view body;          // 条件体 / emit 实参列表
+};
+
+// 拆解一条语句；格式不完整的条件语句返回 false（不执行任何操作）
+bool split_statement(std::string_view line, StatementText& parts) {
+    // 检查是否是 emit 语句：emit Name(arg, ...)，没有实参时可省略括号
+    if (line.compare(0, 4, "emit") == 0 && (line.length() == 4 || !is_identifier_char(line[4]))) {
+        std::string_view rest = trim(line.substr(4));
+        size_t open_paren = rest.find('(');
+        parts.type = StatementType::EMIT;
+        if (open_paren == std::string_view::npos) {
+            parts.target = rest;
+        } else {
+            size_t close_paren = rest.find_last_of(')');
+            if (close_paren == std::string_view::npos || close_paren < open_paren) {
+                return false;
+            }
+            parts.target = trim(rest.substr(0, open_paren));
+            parts.body = rest.substr(open_paren + 1, close_paren - open_paren - 1);
+        }
+        return !parts.target.empty();
+    }
+    
+    // 检查是否是条件语句
+    if (line.compare(0, 2, "if") == 0 && (line.length() == 2 || !is_identifier_char(line[2]))) {
+        size_t open_brace = line.find('{');
+        size_t close_brace = line.find_last_of('}');
+        
+        if (open_brace == std::string_view::npos || close_brace == std::string_view::npos ||
+            close_brace < open_brace) {
+            return false;
+        }
+        
+        parts.type = StatementType::CONDITIONAL;
+        parts.expression = trim(line.substr(2, open_brace - 2));
+        parts.body = line.substr(open_brace + 1, close_brace - open_brace - 1);
+        return true;
+    }
+    
+    // 检查是否是赋值
+    size_t assign_pos = find_assignment(line);
+    if (assign_pos != std::string_view::npos) {
+        parts.type = StatementType::ASSIGNMENT;
+        parts.target = trim(line.substr(0, assign_pos));
+        parts.expression = trim(line.substr(assign_pos + 1));
+    } else {
+        parts.type = StatementType::EXPRESSION;
+        parts.expression = line;
+    }
+    return true;
+}
+
+} // namespace
+
+// 表达式解析器（优先级爬升）：逐个词法单元读取，直接在 Arena 中构建节点
+class ExpressionParser {
+public:
+    ExpressionParser(std::string_view text, Arena& target) : source(text), arena(target) {
+        advance();
+    }
+    
+    // 解析完整表达式；语法错误或有多余内容时返回 nullptr
+    ExpressionNode* parse() {
+        ExpressionNode* node = parse_binary(1);
+        return node && current.kind == TokenKind::END ? node : nullptr;
+    }
+    
+private:
+    enum class TokenKind { END, NUMBER, STRING, IDENTIFIER, OPERATOR, LPAREN, RPAREN, INVALID };
+    
+    struct Token {
+        TokenKind kind = TokenKind::END;
+        std::string_view text;
+    };
+    
+    std::string_view source;
+    size_t position = 0;
+    Token current;
+    Arena& arena;
+    
+    // 二元操作符的优先级，非二元操作符返回 0
+    static int binary_precedence(std::string_view op) {
+        if (op == "||") return 1;
+        if (op == "&&") return 2;
+        if (op == "==" || op == "!=") return 3;
+        if (op == "<" || op == ">" || op == "<=" || op == ">=") return 4;
+        if (op == "+" || op == "-") return 5;
+        if (op == "*" || op == "/" || op == "%") return 6;
+        return 0;
+    }
+    
+    void advance() {
+        while (position < source.size() && std::isspace(static_cast<unsigned char>(source[position]))) {
+            ++position;
+        }
+        size_t start = position;
+        if (position >= source.size()) {
+            current = Token{TokenKind::END, std::string_view()};
+            return;
+        }
+        
+        char c = source[position];
+        TokenKind kind = TokenKind::INVALID;
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            kind = TokenKind::NUMBER;
+            while (position < source.size() &&
+                   (std::isdigit(static_cast<unsigned char>(source[position])) || source[position] == '.')) {
+                ++position;
+            }
+            if (position < source.size() && (source[position] == 'e' || source[position] == 'E')) {
+                ++position;
+                if (position < source.size() && (source[position] == '+' || source[position] == '-')) {
+                    ++position;
+                }
+                while (position < source.size() && std::isdigit(static_cast<unsigned char>(source[position]))) {
+                    ++position;
+                }
+            }
+            // 数字后紧跟标识符字符（如 1abc）不是合法的词法单元
+            if (position < source.size() && (is_identifier_char(source[position]) || source[position] == '.')) {
+                kind = TokenKind::INVALID;
+            }
+        } else if (c == '"' || c == '\'') {
+            size_t close = source.find(c, position + 1);
+            if (close != std::string_view::npos) {
+                kind = TokenKind::STRING;
+                position = close + 1;
+            }
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            kind = TokenKind::IDENTIFIER;
+            while (position < source.size() && (is_identifier_char(source[position]) || source[position] == '.')) {
+                ++position;
+            }
+        } else if (c == '(' || c == ')') {
+            kind = c == '(' ? TokenKind::LPAREN : TokenKind::RPAREN;
+            ++position;
+        } else {
+            std::string_view two = source.substr(position, 2);
+            if (two == "==" || two == "!=" || two == "<=" || two == ">=" || two == "&&" || two == "||") {
+                kind = TokenKind::OPERATOR;
+                position += 2;
+            } else if (std::strchr("+-*/%<>!", c)) {
+                kind = TokenKind::OPERATOR;
+                ++position;
+            }
+        }
+        
+        if (kind == TokenKind::INVALID) {
+            position = source.size();
+        }
+        current = Token{kind, source.substr(start, position - start)};
+    }
+    
+    ExpressionNode* parse_binary(int min_precedence) {
+        ExpressionNode* left = parse_unary();
+        while (left && current.kind == TokenKind::OPERATOR) {
+            int precedence = binary_precedence(current.text);
+            if (precedence == 0 || precedence < min_precedence) {
+                break;
+            }
+            OperatorType op = LogicEngine::parse_operator(current.text);
+            advance();
+            ExpressionNode* right = parse_binary(precedence + 1);
+            if (!right) {
+                return nullptr;
+            }
+            left = make_binary(op, left, right);
+        }
+        return left;
+    }
+    
+    ExpressionNode* parse_unary() {
+        if (current.kind == TokenKind::OPERATOR && (current.text == "!" || current.text == "-" || current.text == "+")) {
+            std::string_view op = current.text;
+            advance();
+            ExpressionNode* operand = parse_unary();
+            if (!operand || op == "+") {
+                return operand;
+            }
+            return make_unary(op == "!" ? OperatorType::NOT : OperatorType::SUB, operand);
+        }
+        return parse_primary();
+    }
+    
+    ExpressionNode* parse_primary() {
+        Token token = current;
+        switch (token.kind) {
+            case TokenKind::NUMBER:
+            case TokenKind::STRING:
+                advance();
+                return LogicEngine::make_literal(token.text, arena);
+                
+            case TokenKind::IDENTIFIER:
+                advance();
+                if (token.text == "true" || token.text == "false") {
+                    return LogicEngine::make_literal(token.text, arena);
+                }
+                if (current.kind == TokenKind::LPAREN) {
+                    // 函数调用尚不支持
+                    return nullptr;
+                }
+                return arena.create<ExpressionNode>(ExpressionType::VARIABLE, arena.copy(token.text));
+                
+            case TokenKind::LPAREN: {
+                advance();
+                ExpressionNode* inner = parse_binary(1);
+                if (!inner || current.kind != TokenKind::RPAREN) {
+                    return nullptr;
+                }
+                advance();
+                return inner;
+            }
+                
+            default:
+                return nullptr;
+        }
+    }
+    
+    // 常量折叠：操作数均为字面量时在解析时求值；&& / || 的左操作数为字面量且能决定结果时同样折叠
+    ExpressionNode* make_binary(OperatorType op, ExpressionNode* left, ExpressionNode* right) {
+        if (left->type == ExpressionType::LITERAL) {
+            bool left_true = left->constant.to_bool();
+            if ((op == OperatorType::AND && !left_true) || (op == OperatorType::OR && left_true)) {
+                return make_constant(StateValue::from_bool(left_true));
+            }
+            if (right->type == ExpressionType::LITERAL) {
+                return make_constant(LogicEngine::execute_binary_op(op, left->constant, right->constant));
+            }
+        }
+        
+        ExpressionNode* node = arena.create<ExpressionNode>();
+        node->type = ExpressionType::BINARY_OP;
+        node->op = op;
+        node->left = left;
+        node->right = right;
+        return node;
+    }
+    
+    ExpressionNode* make_unary(OperatorType op, ExpressionNode* operand) {
+        if (operand->type == ExpressionType::LITERAL) {
+            return make_constant(LogicEngine::execute_unary_op(op, operand->constant));
+        }
+        
+        ExpressionNode* node = arena.create<ExpressionNode>();
+        node->type = ExpressionType::UNARY_OP;
+        node->op = op;
+        node->left = operand;
+        return node;
+    }
+    
+    ExpressionNode* make_constant(StateValue value) {
+        ExpressionNode* node = arena.create<ExpressionNode>();
+        node->constant = std::move(value);
+        return node;
+    }
+};
+
 // LogicEngine 实现
-LogicEngine::LogicEngine() : resolver(nullptr) {}
+LogicEngine::LogicEngine() : resolver(nullptr), slot_resolver(nullptr) {}
 
 LogicEngine::LogicEngine(std::unique_ptr<VariableResolver> var_resolver) 
-    : resolver(std::move(var_resolver)) {}
+    : resolver(std::move(var_resolver)) {
+    slot_resolver = dynamic_cast<StateVariableResolver*>(resolver.get());
+}
 
-std::unique_ptr<ExpressionNode> LogicEngine::parse_expression(const std::string& expression) {
-    // 简单的表达式解析器
-    // 这里实现一个基础的解析器，支持基本的操作
-    auto node = std::make_unique<ExpressionNode>();
-    
+ExpressionNode* LogicEngine::parse_expression(std::string_view expression, Arena& arena) {
     // 检查是否是赋值操作
-    size_t assign_pos = expression.find('=');
-    if (assign_pos != std::string::npos) {
+    size_t assign_pos = find_assignment(expression);
+    if (assign_pos != std::string_view::npos) {
+        ExpressionNode* node = arena.create<ExpressionNode>();
         node->type = ExpressionType::BINARY_OP;
         node->op = OperatorType::ASSIGN;
-        node->left = std::make_unique<ExpressionNode>(ExpressionType::VARIABLE, 
-                                                     expression.substr(0, assign_pos));
-        node->right = std::make_unique<ExpressionNode>(ExpressionType::LITERAL, 
-                                                      expression.substr(assign_pos + 1));
+        node->left = arena.create<ExpressionNode>(ExpressionType::VARIABLE,
+                                                  arena.copy(trim(expression.substr(0, assign_pos))));
+        node->right = parse_expression(expression.substr(assign_pos + 1), arena);
         return node;
     }
     
-    // 检查是否是变量引用
-    if (expression.find('.') != std::string::npos || 
-        (expression.length() > 0 && std::isalpha(expression[0]))) {
-        node->type = ExpressionType::VARIABLE;
-        node->value = expression;
+    if (ExpressionNode* node = ExpressionParser(expression, arena).parse()) {
         return node;
     }
     
+    // 无法按表达式语法解析：去除两端的括号后，含 '.' 或以字母开头的视为变量引用，其余为字面量
+    std::string_view text = strip(expression, " \t\r\n(", " \t\r\n)");
+    if (text.find('.') != std::string_view::npos || 
+        (text.length() > 0 && std::isalpha(static_cast<unsigned char>(text[0])))) {
+        return arena.create<ExpressionNode>(ExpressionType::VARIABLE, arena.copy(text));
+    }
+    
     // 默认为字面量
-    node->type = ExpressionType::LITERAL;
-    node->value = expression;
-    return node;
+    return make_literal(expression, arena);
+}
+
+OutOfGasError::OutOfGasError(uint64_t limit)
+    : std::runtime_error("Out of gas (limit " + std::to_string(limit) + ")") {}
+
+void LogicEngine::out_of_gas() {
+    gas_used = gas_limit;
+    throw OutOfGasError(gas_limit);
+}
+
+uint64_t LogicEngine::expression_gas(const ExpressionNode* node) {
+    if (!node) {
+        return 0;
+    }
+    return 1 + expression_gas(node->left) + expression_gas(node->right);
 }
 
 std::string LogicEngine::evaluate_expression(const std::string& expression) {
     if (!resolver) {
-        std::cerr << "No variable resolver set" << std::endl;
+        CARDITY_LOG_ERROR("No variable resolver set");
         return "";
     }
     
-    auto node = parse_expression(expression);
-    return evaluate_node(*node);
+    Arena::Scope scope(scratch);
+    return evaluate_node(*parse_expression(expression, scratch));
 }
 
 std::string LogicEngine::evaluate_node(const ExpressionNode& node) {
+    StateValue storage;
+    return evaluate_ref(node, storage).to_string();
+}
+
+const StateValue& LogicEngine::evaluate_ref(const ExpressionNode& node, StateValue& storage) {
+    if (const StateValue* value = peek_node_variable(node)) {
+        count_read(node);
+        return *value;
+    }
+    storage = evaluate_value(node);
+    return storage;
+}
+
+StateValue LogicEngine::evaluate_value(const ExpressionNode& node) {
     switch (node.type) {
         case ExpressionType::LITERAL:
-            return parse_literal(node.value);
+            return node.constant;
             
         case ExpressionType::VARIABLE:
-            return parse_variable(node.value);
+            count_read(node);
+            return resolve_node_variable(node);
             
         case ExpressionType::BINARY_OP:
+            if (node.op == OperatorType::ASSIGN && node.left && node.right) {
+                StateValue value = evaluate_value(*node.right);
+                assign(trim(node.left->value), value);
+                return value;
+            }
+            if ((node.op == OperatorType::AND || node.op == OperatorType::OR) && node.left && node.right) {
+                // 短路求值：左操作数已决定结果时不计算右操作数
+                StateValue left;
+                bool left_true = evaluate_ref(*node.left, left).to_bool();
+                if (left_true == (node.op == OperatorType::OR)) {
+                    return StateValue::from_bool(left_true);
+                }
+                StateValue right;
+                return StateValue::from_bool(evaluate_ref(*node.right, right).to_bool());
+            }
             if (node.left && node.right) {
-                std::string left_val = evaluate_node(*node.left);
-                std::string right_val = evaluate_node(*node.right);
-                return execute_binary_op(node.op, left_val, right_val);
+                StateValue left, right;
+                StateValue result = execute_binary_op(node.op, evaluate_ref(*node.left, left), evaluate_ref(*node.right, right));
+                if (node.op == OperatorType::ADD) {
+                    // 拼接按结果长度收费：固定的节点收费不能限制反复翻倍的字符串
+                    if (const std::string* text = result.as_string()) {
+                        charge_gas(text->size() / STRING_BYTES_PER_GAS);
+                    }
+                }
+                return result;
             }
             break;
             
         case ExpressionType::UNARY_OP:
             if (node.left) {
-                std::string operand = evaluate_node(*node.left);
-                return execute_unary_op(node.op, operand);
+                StateValue operand;
+                return execute_unary_op(node.op, evaluate_ref(*node.left, operand));
             }
             break;
             
@@ -81,132 +500,320 @@ std::string LogicEngine::evaluate_node(const ExpressionNode& node) {
             break;
     }
     
-    return "";
+    return StateValue();
 }
 
 bool LogicEngine::execute_assignment(const std::string& assignment) {
     if (!resolver) {
-        std::cerr << "No variable resolver set" << std::endl;
+        CARDITY_LOG_ERROR("No variable resolver set");
         return false;
     }
     
-    size_t assign_pos = assignment.find('=');
+    size_t assign_pos = find_assignment(assignment);
     if (assign_pos == std::string::npos) {
-        std::cerr << "Invalid assignment: " << assignment << std::endl;
+        CARDITY_LOG_ERROR("Invalid assignment: " << assignment);
         return false;
     }
     
-    std::string var_name = assignment.substr(0, assign_pos);
-    std::string value_expr = assignment.substr(assign_pos + 1);
-    
-    // 去除空白字符
-    var_name.erase(0, var_name.find_first_not_of(" \t"));
-    var_name.erase(var_name.find_last_not_of(" \t") + 1);
-    value_expr.erase(0, value_expr.find_first_not_of(" \t"));
-    value_expr.erase(value_expr.find_last_not_of(" \t") + 1);
+    // 去除空白字符（子串视图，不复制）
+    std::string_view text(assignment);
+    std::string_view var_name = strip(text.substr(0, assign_pos), " \t", " \t");
+    std::string_view value_expr = strip(text.substr(assign_pos + 1), " \t", " \t");
     
-    // 计算值
-    std::string value = evaluate_expression(value_expr);
-    
-    // 设置变量
-    resolver->set_variable(var_name, value);
+    // 计算值并设置变量
+    Arena::Scope scope(scratch);
+    assign(var_name, evaluate_value(*parse_expression(value_expr, scratch)));
     return true;
 }
 
 bool LogicEngine::execute_condition(const std::string& condition) {
-    std::string result = evaluate_expression(condition);
-    return string_to_bool(result);
+    if (!resolver) {
+        CARDITY_LOG_ERROR("No variable resolver set");
+        return false;
+    }
+    
+    Arena::Scope scope(scratch);
+    return evaluate_value(*parse_expression(condition, scratch)).to_bool();
 }
 
 std::string LogicEngine::execute_method_logic(const std::string& logic, const std::vector<std::string>& args) {
     (void)args; // 避免未使用参数警告
     if (!resolver) {
-        std::cerr << "No variable resolver set" << std::endl;
+        CARDITY_LOG_ERROR("No variable resolver set");
         return "";
     }
     
     // 参数已经在 runtime.cpp 中设置，这里不需要重复设置
-    
-    // 解析逻辑语句
-    std::istringstream iss(logic);
-    std::string line;
-    std::string last_result;
-    
-    while (std::getline(iss, line, ';')) {
-        // 去除空白字符
-        line.erase(0, line.find_first_not_of(" \t"));
-        line.erase(line.find_last_not_of(" \t") + 1);
-        
-        if (line.empty()) continue;
+    // 逐条解析执行，临时节点在 scratch 中；已加载协议的方法应直接使用缓存的 CompiledProgram
+    Arena::Scope scope(scratch);
+    StateValue last_result;
+    interpret_statements(logic, last_result);
+    return last_result.to_string();
+}
+
+void LogicEngine::interpret_statements(std::string_view logic, StateValue& last_result) {
+    for_each_statement(logic, [&](std::string_view line) {
+        StatementText parts;
+        if (!split_statement(line, parts)) {
+            return;
+        }
         
-        std::cerr << "DEBUG: Processing line: '" << line << "'" << std::endl;
+        // 字面量条件与 compile_statements 相同处理：条件语句本身不计数、不收费，
+        // 真分支按外层语句执行，假分支跳过
+        const ExpressionNode* condition = nullptr;
+        if (parts.type == StatementType::CONDITIONAL) {
+            condition = parse_expression(parts.expression, scratch);
+            if (condition->type == ExpressionType::LITERAL) {
+                if (condition->constant.to_bool()) {
+                    interpret_statements(parts.body, last_result);
+                }
+                return;
+            }
+        }
         
-        // 检查是否是 emit 语句
-        if (line.substr(0, 4) == "emit") {
-            // 暂时跳过 emit 语句，后续会处理
-            continue;
+        CARDITY_LOG_DEBUG("Executing statement: '" << line << "'");
+        if (counters) {
+            ++counters->statements;
         }
         
-        // 检查是否是条件语句
-        if (line.length() >= 2 && line.substr(0, 2) == "if") {
-            // 简单的条件语句处理
-            size_t open_brace = line.find('{');
-            size_t close_brace = line.find_last_of('}');
-            
-            if (open_brace != std::string::npos && close_brace != std::string::npos) {
-                std::string condition = line.substr(2, open_brace - 2);
-                std::string body = line.substr(open_brace + 1, close_brace - open_brace - 1);
+        // 其余语句解析后、求值前按节点数收取，与预编译语句的 gas 相同
+        switch (parts.type) {
+            case StatementType::EMIT:
+                interpret_emit(parts.target, parts.body);
+                break;
+                
+            case StatementType::CONDITIONAL: {
+                charge_gas(1 + expression_gas(condition));
+                if (evaluate_value(*condition).to_bool()) {
+                    interpret_statements(parts.body, last_result);
+                }
+                break;
+            }
                 
-                // 去除条件中的括号
-                condition.erase(0, condition.find_first_not_of(" \t("));
-                condition.erase(condition.find_last_not_of(" \t)") + 1);
+            case StatementType::ASSIGNMENT: {
+                const ExpressionNode* value = parse_expression(parts.expression, scratch);
+                charge_gas(1 + expression_gas(value));
+                assign(parts.target, evaluate_value(*value));
+                break;
+            }
                 
-                // 调试信息
-                std::cerr << "DEBUG: Condition: '" << condition << "'" << std::endl;
-                std::cerr << "DEBUG: Body: '" << body << "'" << std::endl;
+            case StatementType::EXPRESSION: {
+                const ExpressionNode* expression = parse_expression(parts.expression, scratch);
+                charge_gas(1 + expression_gas(expression));
+                last_result = evaluate_value(*expression);
+                break;
+            }
+        }
+    });
+}
+
+void LogicEngine::interpret_emit(std::string_view name, std::string_view arguments) {
+    // 先数出实参个数，按个数一次分配
+    std::vector<const ExpressionNode*> nodes;
+    nodes.reserve(for_each_argument(arguments, [](std::string_view) {}));
+    uint64_t gas = 1;
+    for_each_argument(arguments, [&](std::string_view argument) {
+        nodes.push_back(parse_expression(argument, scratch));
+        gas += expression_gas(nodes.back());
+    });
+    charge_gas(gas);
+    if (!event_sink) {
+        return;
+    }
+    
+    std::vector<std::string> values;
+    values.reserve(nodes.size());
+    for (const ExpressionNode* node : nodes) {
+        StateValue storage;
+        values.push_back(evaluate_ref(*node, storage).to_string());
+    }
+    event_sink->emit(name, std::move(values));
+}
+
+void LogicEngine::count_read(const ExpressionNode& node) {
+    if (counters && (node.scope == VariableScope::STATE ||
+                     (node.scope == VariableScope::UNRESOLVED && !is_param_reference(trim(node.value))))) {
+        ++counters->state_reads;
+    }
+}
+
+void LogicEngine::assign(std::string_view target, const StateValue& value) {
+    if (counters && !is_param_reference(target)) {
+        ++counters->state_writes;
+    }
+    resolver->set_variable(target, value);
+}
+
+std::shared_ptr<const CompiledProgram> LogicEngine::compile_program(const std::string& logic,
+                                                                    const std::string& returns,
+                                                                    const SlotLayout* layout) {
+    auto program = std::make_shared<CompiledProgram>();
+    compile_statements(logic, program->statements, program->arena);
+    
+    std::string_view return_expr = trim(returns);
+    if (!return_expr.empty()) {
+        program->returns = parse_expression(return_expr, program->arena);
+        program->returns_gas = expression_gas(program->returns);
+    }
+    
+    if (layout) {
+        resolve_slots(program->statements, *layout);
+        if (program->returns) {
+            resolve_slots(*program->returns, *layout);
+        }
+        program->uses_slots = true;
+    }
+    return program;
+}
+
+void LogicEngine::resolve_slots(ExpressionNode& node, const SlotLayout& layout) {
+    if (node.type == ExpressionType::VARIABLE) {
+        layout.resolve(trim(node.value), node.scope, node.slot);
+    }
+    if (node.left) resolve_slots(*node.left, layout);
+    if (node.right) resolve_slots(*node.right, layout);
+}
+
+void LogicEngine::resolve_slots(std::vector<Statement>& statements, const SlotLayout& layout) {
+    for (auto& stmt : statements) {
+        if (stmt.type == StatementType::ASSIGNMENT &&
+            layout.resolve(stmt.target, stmt.target_scope, stmt.target_slot) &&
+            stmt.target_scope == VariableScope::STATE && stmt.target_slot < layout.state_types.size()) {
+            stmt.coerce_target = true;
+            stmt.target_type = layout.state_types[stmt.target_slot];
+        }
+        if (stmt.expression) {
+            resolve_slots(*stmt.expression, layout);
+        }
+        for (ExpressionNode* argument : stmt.arguments) {
+            resolve_slots(*argument, layout);
+        }
+        resolve_slots(stmt.body, layout);
+    }
+}
+
+void LogicEngine::compile_statements(std::string_view logic, std::vector<Statement>& statements, Arena& arena) {
+    for_each_statement(logic, [&](std::string_view line) {
+        StatementText parts;
+        if (!split_statement(line, parts)) {
+            // 格式不完整的条件语句不执行任何操作
+            return;
+        }
+        
+        Statement stmt;
+        stmt.type = parts.type;
+        stmt.source = std::string(line);
+        switch (parts.type) {
+            case StatementType::EMIT:
+                stmt.target = std::string(parts.target);
+                for_each_argument(parts.body, [&](std::string_view argument) {
+                    stmt.arguments.push_back(parse_expression(argument, arena));
+                });
+                break;
                 
-                if (execute_condition(condition)) {
-                    std::cerr << "DEBUG: Condition is true, executing body" << std::endl;
-                    // 执行条件体
-                    std::istringstream body_iss(body);
-                    std::string body_line;
-                    while (std::getline(body_iss, body_line, ';')) {
-                        body_line.erase(0, body_line.find_first_not_of(" \t"));
-                        body_line.erase(body_line.find_last_not_of(" \t") + 1);
-                        
-                        if (body_line.empty()) continue;
-                        
-                        std::cerr << "DEBUG: Executing body line: '" << body_line << "'" << std::endl;
-                        
-                        if (body_line.substr(0, 4) == "emit") {
-                            // 处理 emit 语句
-                            std::cerr << "DEBUG: Skipping emit statement" << std::endl;
-                            continue;
-                        }
-                        
-                        if (body_line.find('=') != std::string::npos) {
-                            execute_assignment(body_line);
-                        } else {
-                            last_result = evaluate_expression(body_line);
-                        }
+            case StatementType::CONDITIONAL:
+                stmt.expression = parse_expression(parts.expression, arena);
+                if (stmt.expression->type == ExpressionType::LITERAL) {
+                    // 条件在加载时已确定：真分支直接展开到外层，假分支整体删除
+                    if (stmt.expression->constant.to_bool()) {
+                        compile_statements(parts.body, statements, arena);
                     }
-                } else {
-                    std::cerr << "DEBUG: Condition is false, skipping body" << std::endl;
+                    return;
                 }
-            }
-            continue;
+                compile_statements(parts.body, stmt.body, arena);
+                break;
+                
+            case StatementType::ASSIGNMENT:
+                stmt.target = std::string(parts.target);
+                stmt.expression = parse_expression(parts.expression, arena);
+                break;
+                
+            case StatementType::EXPRESSION:
+                stmt.expression = parse_expression(parts.expression, arena);
+                break;
         }
-        
-        // 检查是否是赋值
-        if (line.find('=') != std::string::npos) {
-            execute_assignment(line);
-        } else {
-            // 计算表达式
-            last_result = evaluate_expression(line);
+        stmt.gas = 1 + expression_gas(stmt.expression);
+        for (const ExpressionNode* argument : stmt.arguments) {
+            stmt.gas += expression_gas(argument);
         }
+        statements.push_back(std::move(stmt));
+    });
+}
+
+std::string LogicEngine::execute_program(const CompiledProgram& program) {
+    if (!resolver) {
+        CARDITY_LOG_ERROR("No variable resolver set");
+        return "";
     }
     
-    return last_result;
+    StateValue last_result;
+    execute_statements(program.statements, last_result);
+    return last_result.to_string();
+}
+
+std::string LogicEngine::evaluate_returns(const CompiledProgram& program) {
+    if (!resolver || !program.returns) {
+        return "";
+    }
+    charge_gas(program.returns_gas);
+    return evaluate_node(*program.returns);
+}
+
+void LogicEngine::execute_statements(const std::vector<Statement>& statements, StateValue& last_result) {
+    for (const auto& stmt : statements) {
+        CARDITY_LOG_DEBUG("Executing statement: '" << stmt.source << "'");
+        if (counters) {
+            ++counters->statements;
+        }
+        charge_gas(stmt.gas);
+        
+        switch (stmt.type) {
+            case StatementType::EMIT:
+                if (event_sink) {
+                    std::vector<std::string> values;
+                    values.reserve(stmt.arguments.size());
+                    for (const ExpressionNode* argument : stmt.arguments) {
+                        StateValue storage;
+                        values.push_back(evaluate_ref(*argument, storage).to_string());
+                    }
+                    event_sink->emit(stmt.target, std::move(values));
+                }
+                break;
+                
+            case StatementType::CONDITIONAL:
+                if (evaluate_value(*stmt.expression).to_bool()) {
+                    CARDITY_LOG_DEBUG("Condition is true, executing body");
+                    execute_statements(stmt.body, last_result);
+                } else {
+                    CARDITY_LOG_DEBUG("Condition is false, skipping body");
+                }
+                break;
+                
+            case StatementType::ASSIGNMENT:
+                if (slot_resolver && stmt.target_scope != VariableScope::UNRESOLVED) {
+                    if (counters && stmt.target_scope == VariableScope::STATE) {
+                        ++counters->state_writes;
+                    }
+                    StateValue storage;
+                    const StateValue& value = evaluate_ref(*stmt.expression, storage);
+                    if (stmt.coerce_target && value.type() != stmt.target_type) {
+                        storage = value.coerce(stmt.target_type);
+                        slot_resolver->set_slot(stmt.target_scope, stmt.target_slot, storage);
+                    } else {
+                        // 直接从源槽位复制到目标槽位，不经过临时值
+                        slot_resolver->set_slot(stmt.target_scope, stmt.target_slot, value);
+                    }
+                } else {
+                    StateValue storage;
+                    assign(stmt.target, evaluate_ref(*stmt.expression, storage));
+                }
+                break;
+                
+            case StatementType::EXPRESSION:
+                last_result = evaluate_value(*stmt.expression);
+                break;
+        }
+    }
 }
 
 std::vector<std::string> LogicEngine::parse_parameters(const std::string& param_str) {
@@ -227,9 +834,10 @@ std::vector<std::string> LogicEngine::parse_parameters(const std::string& param_
 
 void LogicEngine::set_resolver(std::unique_ptr<VariableResolver> var_resolver) {
     resolver = std::move(var_resolver);
+    slot_resolver = dynamic_cast<StateVariableResolver*>(resolver.get());
 }
 
-OperatorType LogicEngine::parse_operator(const std::string& op_str) {
+OperatorType LogicEngine::parse_operator(std::string_view op_str) {
     if (op_str == "+") return OperatorType::ADD;
     if (op_str == "-") return OperatorType::SUB;
     if (op_str == "*") return OperatorType::MUL;
@@ -249,9 +857,9 @@ OperatorType LogicEngine::parse_operator(const std::string& op_str) {
     return OperatorType::ADD; // 默认
 }
 
-std::string LogicEngine::parse_literal(const std::string& literal) {
+std::string_view LogicEngine::parse_literal(std::string_view literal) {
     // 去除引号
-    std::string result = literal;
+    std::string_view result = literal;
     if (result.length() >= 2 && 
         ((result[0] == '"' && result[result.length()-1] == '"') ||
          (result[0] == '\'' && result[result.length()-1] == '\''))) {
@@ -260,86 +868,133 @@ std::string LogicEngine::parse_literal(const std::string& literal) {
     return result;
 }
 
-std::string LogicEngine::parse_variable(const std::string& var_name) {
-    if (!resolver) {
-        return "";
+ExpressionNode* LogicEngine::make_literal(std::string_view literal, Arena& arena) {
+    ExpressionNode* node = arena.create<ExpressionNode>(ExpressionType::LITERAL, arena.copy(literal));
+    std::string_view text = trim(literal);
+    std::string_view unquoted = parse_literal(text);
+    if (unquoted.length() != text.length()) {
+        node->constant.data = std::string(unquoted);
+    } else {
+        node->constant = StateValue::from_literal(std::string(text));
     }
-    
-    // 处理 state.xxx 格式
-    if (var_name.substr(0, 6) == "state.") {
-        std::string state_var = var_name.substr(6);
-        return resolver->resolve_variable(state_var);
+    return node;
+}
+
+StateValue LogicEngine::resolve_node_variable(const ExpressionNode& node) {
+    if (slot_resolver && node.scope != VariableScope::UNRESOLVED) {
+        return slot_resolver->resolve_slot(node.scope, node.slot);
     }
-    
-    // 处理 params.xxx 格式
-    if (var_name.substr(0, 7) == "params.") {
-        std::string param_name = var_name.substr(7);
-        return resolver->resolve_variable(param_name);
+    if (!resolver) {
+        return StateValue();
     }
-    
-    return resolver->resolve_variable(var_name);
+    const StateValue* value = resolver->resolve_variable(trim(node.value));
+    return value ? *value : StateValue();
 }
 
-std::string LogicEngine::execute_binary_op(OperatorType op, const std::string& left, const std::string& right) {
+const StateValue* LogicEngine::peek_node_variable(const ExpressionNode& node) const {
+    if (node.type != ExpressionType::VARIABLE || !slot_resolver || node.scope == VariableScope::UNRESOLVED) {
+        return nullptr;
+    }
+    return slot_resolver->peek_slot(node.scope, node.slot);
+}
+
+StateValue LogicEngine::execute_binary_op(OperatorType op, const StateValue& left, const StateValue& right) {
+    int64_t li = 0, ri = 0, result = 0;
+    double lf = 0.0, rf = 0.0;
+    bool integral = left.try_int64(li) && right.try_int64(ri);
+    
     switch (op) {
         case OperatorType::ADD:
-            return std::to_string(string_to_float(left) + string_to_float(right));
+            if (integral && !__builtin_add_overflow(li, ri, &result)) {
+                return StateValue::from_int(result);
+            }
+            if (left.try_float(lf) && right.try_float(rf)) {
+                return StateValue::from_float(lf + rf);
+            }
+            // 非数字操作数按字符串拼接
+            return StateValue::from_string(left.to_string() + right.to_string());
             
         case OperatorType::SUB:
-            return std::to_string(string_to_float(left) - string_to_float(right));
+            if (integral && !__builtin_sub_overflow(li, ri, &result)) {
+                return StateValue::from_int(result);
+            }
+            return StateValue::from_float(left.to_float() - right.to_float());
             
         case OperatorType::MUL:
-            return std::to_string(string_to_float(left) * string_to_float(right));
+            if (integral && !__builtin_mul_overflow(li, ri, &result)) {
+                return StateValue::from_int(result);
+            }
+            return StateValue::from_float(left.to_float() * right.to_float());
             
         case OperatorType::DIV:
-            if (string_to_float(right) == 0) return "0";
-            return std::to_string(string_to_float(left) / string_to_float(right));
+            rf = right.to_float();
+            if (rf == 0) return StateValue::from_int(0);
+            if (integral && ri != -1 && li % ri == 0) {
+                return StateValue::from_int(li / ri);
+            }
+            return StateValue::from_float(left.to_float() / rf);
             
         case OperatorType::MOD:
-            return std::to_string(string_to_int(left) % string_to_int(right));
+            li = left.to_int64();
+            ri = right.to_int64();
+            if (ri == 0 || ri == -1) return StateValue::from_int(0);
+            return StateValue::from_int(li % ri);
             
         case OperatorType::EQ:
-            return bool_to_string(left == right);
-            
-        case OperatorType::NE:
-            return bool_to_string(left != right);
+        case OperatorType::NE: {
+            bool equal;
+            if (left.try_float(lf) && right.try_float(rf)) {
+                equal = integral ? li == ri : lf == rf;
+            } else if (left.type() == right.type()) {
+                equal = left == right;
+            } else {
+                equal = left.to_string() == right.to_string();
+            }
+            return StateValue::from_bool(op == OperatorType::EQ ? equal : !equal);
+        }
             
         case OperatorType::LT:
-            return bool_to_string(string_to_float(left) < string_to_float(right));
-            
         case OperatorType::GT:
-            return bool_to_string(string_to_float(left) > string_to_float(right));
-            
         case OperatorType::LE:
-            return bool_to_string(string_to_float(left) <= string_to_float(right));
-            
-        case OperatorType::GE:
-            return bool_to_string(string_to_float(left) >= string_to_float(right));
+        case OperatorType::GE: {
+            int cmp;
+            if (integral) {
+                cmp = li < ri ? -1 : (li > ri ? 1 : 0);
+            } else if (left.try_float(lf) && right.try_float(rf)) {
+                cmp = lf < rf ? -1 : (lf > rf ? 1 : 0);
+            } else {
+                cmp = left.to_string().compare(right.to_string());
+            }
+            switch (op) {
+                case OperatorType::LT: return StateValue::from_bool(cmp < 0);
+                case OperatorType::GT: return StateValue::from_bool(cmp > 0);
+                case OperatorType::LE: return StateValue::from_bool(cmp <= 0);
+                default: return StateValue::from_bool(cmp >= 0);
+            }
+        }
             
         case OperatorType::AND:
-            return bool_to_string(string_to_bool(left) && string_to_bool(right));
+            return StateValue::from_bool(left.to_bool() && right.to_bool());
             
         case OperatorType::OR:
-            return bool_to_string(string_to_bool(left) || string_to_bool(right));
-            
-        case OperatorType::ASSIGN:
-            if (resolver) {
-                resolver->set_variable(left, right);
-            }
-            return right;
+            return StateValue::from_bool(left.to_bool() || right.to_bool());
             
         default:
             return left;
     }
 }
 
-std::string LogicEngine::execute_unary_op(OperatorType op, const std::string& operand) {
+StateValue LogicEngine::execute_unary_op(OperatorType op, const StateValue& operand) {
+    int64_t i = 0;
     switch (op) {
         case OperatorType::NOT:
-            return bool_to_string(!string_to_bool(operand));
+            return StateValue::from_bool(!operand.to_bool());
             
         case OperatorType::SUB:
-            return std::to_string(-string_to_float(operand));
+            if (operand.try_int64(i) && i != INT64_MIN) {
+                return StateValue::from_int(-i);
+            }
+            return StateValue::from_float(-operand.to_float());
             
         default:
             return operand;
@@ -380,84 +1035,160 @@ std::string LogicEngine::float_to_string(double value) const {
     return std::to_string(value);
 }
 
+// SlotLayout 实现
+bool SlotLayout::resolve(std::string_view reference, VariableScope& scope, size_t& slot) const {
+    auto find = [](const std::vector<std::string>& names, std::string_view name, size_t& index) {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) return false;
+        index = static_cast<size_t>(it - names.begin());
+        return true;
+    };
+    
+    if (reference.compare(0, 6, "state.") == 0) {
+        if (find(state, reference.substr(6), slot)) {
+            scope = VariableScope::STATE;
+            return true;
+        }
+        return false;
+    }
+    
+    if (reference.compare(0, 7, "params.") == 0) {
+        std::string_view name = reference.substr(7);
+        if (find(params, name, slot)) {
+            scope = VariableScope::PARAM;
+            return true;
+        }
+        // params.0 形式的位置参数
+        if (!name.empty() && std::all_of(name.begin(), name.end(), ::isdigit) &&
+            name.length() < 10 && std::stoul(std::string(name)) < params.size()) {
+            slot = std::stoul(std::string(name));
+            scope = VariableScope::PARAM;
+            return true;
+        }
+        return false;
+    }
+    
+    // 裸名称：先参数后状态，与 StateVariableResolver 的查找顺序一致
+    if (find(params, reference, slot)) {
+        scope = VariableScope::PARAM;
+        return true;
+    }
+    if (find(state, reference, slot)) {
+        scope = VariableScope::STATE;
+        return true;
+    }
+    return false;
+}
+
 // StateVariableResolver 实现
 StateVariableResolver::StateVariableResolver(StateManager* manager) : state_manager(manager) {}
 
 void StateVariableResolver::set_parameters(const std::map<std::string, std::string>& parameters) {
-    params = parameters;
+    params.clear();
+    for (const auto& [name, value] : parameters) {
+        params[name] = StateValue::from_string(value);
+    }
 }
 
 void StateVariableResolver::set_parameter(const std::string& name, const std::string& value) {
-    params[name] = value;
+    params[name] = StateValue::from_string(value);
 }
 
-std::string StateVariableResolver::resolve_variable(const std::string& name) const {
-    // 处理 params.xxx 格式
-    if (name.substr(0, 7) == "params.") {
-        std::string param_name = name.substr(7);
-        auto param_it = params.find(param_name);
-        if (param_it != params.end()) {
-            return param_it->second;
-        }
-        return "";
+void StateVariableResolver::bind_arguments(const std::vector<std::string>& args) {
+    if (param_slots.size() < args.size()) {
+        param_slots.resize(args.size());
     }
-    
-    // 处理 state.xxx 格式
-    if (name.substr(0, 6) == "state.") {
-        std::string state_var = name.substr(6);
-        if (state_manager) {
-            return state_manager->get_string(state_var);
+    param_count = args.size();
+    for (size_t i = 0; i < args.size(); ++i) {
+        // 槽位仍是字符串时原地赋值，复用上一次调用的容量
+        if (auto* text = std::get_if<std::string>(&param_slots[i].data)) {
+            text->assign(args[i]);
+        } else {
+            param_slots[i] = StateValue::from_string(args[i]);
         }
-        return "";
     }
-    
-    // 首先检查参数
-    auto param_it = params.find(name);
-    if (param_it != params.end()) {
-        return param_it->second;
+}
+
+StateValue StateVariableResolver::resolve_slot(VariableScope scope, size_t slot) const {
+    if (scope == VariableScope::PARAM) {
+        return slot < param_count ? param_slots[slot] : StateValue();
     }
-    
-    // 然后检查状态
-    if (state_manager) {
-        return state_manager->get_string(name);
+    return state_manager ? state_manager->get_slot(slot) : StateValue();
+}
+
+const StateValue* StateVariableResolver::peek_slot(VariableScope scope, size_t slot) const {
+    if (scope == VariableScope::PARAM) {
+        return slot < param_count ? &param_slots[slot] : nullptr;
     }
-    
-    return "";
+    return state_manager ? state_manager->find_slot_value(slot) : nullptr;
 }
 
-void StateVariableResolver::set_variable(const std::string& name, const std::string& value) {
-    // 处理 state.xxx 格式
-    if (name.substr(0, 6) == "state.") {
-        std::string state_var = name.substr(6);
-        if (state_manager) {
-            state_manager->set(state_var, value);
+void StateVariableResolver::set_slot(VariableScope scope, size_t slot, const StateValue& value) {
+    if (scope == VariableScope::PARAM) {
+        if (slot < param_count) {
+            param_slots[slot] = value;
         }
         return;
     }
+    if (state_manager) {
+        state_manager->set_slot(slot, value);
+    }
+}
+
+const StateValue* StateVariableResolver::resolve_variable(std::string_view name) const {
+    // 前缀按 string_view 截取，不分配临时字符串；参数以字符串保存，状态保留原生类型
+    if (name.compare(0, 7, "params.") == 0) {
+        auto param_it = params.find(name.substr(7));
+        return param_it != params.end() ? &param_it->second : nullptr;
+    }
     
-    // 处理 params.xxx 格式
-    if (name.substr(0, 7) == "params.") {
-        std::string param_name = name.substr(7);
-        params[param_name] = value;
-        return;
+    bool state_only = name.compare(0, 6, "state.") == 0;
+    std::string_view key = state_only ? name.substr(6) : name;
+    if (!state_only) {
+        auto param_it = params.find(key);
+        if (param_it != params.end()) {
+            return &param_it->second;
+        }
+    }
+    if (!state_manager) {
+        return nullptr;
+    }
+    if (const StateValue* found = state_manager->find_value(key)) {
+        return found;
     }
     
-    // 默认设置到状态管理器
-    if (state_manager) {
-        state_manager->set(name, value);
+    // 存储没有可引用的值对象时复制到缓冲区
+    std::string owned(key);
+    if (!state_manager->has(owned)) {
+        return nullptr;
     }
+    lookup_buffer = state_manager->get_value(owned);
+    return &lookup_buffer;
 }
 
-bool StateVariableResolver::has_variable(const std::string& name) const {
-    if (params.find(name) != params.end()) {
-        return true;
+void StateVariableResolver::set_variable(std::string_view name, const StateValue& value) {
+    if (name.compare(0, 7, "params.") == 0) {
+        params[name.substr(7)] = StateValue::from_string(value.to_string());
+        return;
     }
     
+    // state.xxx 和裸名称都写入状态
     if (state_manager) {
-        return state_manager->has(name);
+        state_manager->set_value(std::string(name.compare(0, 6, "state.") == 0 ? name.substr(6) : name), value);
+    }
+}
+
+bool StateVariableResolver::has_variable(std::string_view name) const {
+    if (name.compare(0, 7, "params.") == 0) {
+        return params.contains(name.substr(7));
     }
     
-    return false;
+    bool state_only = name.compare(0, 6, "state.") == 0;
+    std::string_view key = state_only ? name.substr(6) : name;
+    if (!state_only && params.contains(key)) {
+        return true;
+    }
+    return state_manager && (state_manager->find_value(key) || state_manager->has(std::string(key)));
 }
 
 } // namespace cardity 
\ No newline at end of file
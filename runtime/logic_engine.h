@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
 #include <functional>
 #include <memory>
+#include <stdexcept>
+#include <string_view>
+#include "arena.h"
 #include "state_store.h"
 
 namespace cardity {
@@ -37,59 +41,177 @@ enum class OperatorType {
     ASSIGN      // =
 };
 
+// 变量作用域（加载时解析）
+enum class VariableScope {
+    UNRESOLVED, // 未分配槽位，运行时按名称解析
+    STATE,      // 已声明的状态变量槽位
+    PARAM       // 方法参数槽位
+};
+
 // 表达式节点
+// 节点及其文本由所属的 Arena 持有（预编译程序的 Arena 或 LogicEngine 的临时 Arena），子节点为非拥有指针
 struct ExpressionNode {
     ExpressionType type;
-    std::string value;
+    std::string_view value; // 源文本，存放在所属 Arena 中
+    StateValue constant;    // 字面量节点的预解析值
     OperatorType op;
-    std::unique_ptr<ExpressionNode> left;
-    std::unique_ptr<ExpressionNode> right;
+    VariableScope scope;
+    size_t slot;
+    ExpressionNode* left;
+    ExpressionNode* right;
+    
+    ExpressionNode() : type(ExpressionType::LITERAL), op(OperatorType::ADD),
+                       scope(VariableScope::UNRESOLVED), slot(0), left(nullptr), right(nullptr) {}
+    ExpressionNode(ExpressionType t, std::string_view v)
+        : type(t), value(v), op(OperatorType::ADD), scope(VariableScope::UNRESOLVED), slot(0),
+          left(nullptr), right(nullptr) {}
+};
+
+// 槽位布局：状态变量和方法参数的整数索引表
+struct SlotLayout {
+    std::vector<std::string> state;
+    std::vector<ValueType> state_types;     // 与 state 对应的声明类型（可为空）
+    std::vector<std::string> params;
     
-    ExpressionNode() : type(ExpressionType::LITERAL), op(OperatorType::ADD) {}
-    ExpressionNode(ExpressionType t, const std::string& v) 
-        : type(t), value(v), op(OperatorType::ADD) {}
+    // 将变量引用解析为槽位，无法解析时返回 false
+    bool resolve(std::string_view reference, VariableScope& scope, size_t& slot) const;
+};
+
+// 语句类型
+enum class StatementType {
+    EXPRESSION,     // 普通表达式
+    ASSIGNMENT,     // 赋值语句
+    CONDITIONAL,    // if 条件语句
+    EMIT            // emit 事件语句
+};
+
+// 预编译语句
+struct Statement {
+    StatementType type;
+    std::string source;                          // 原始语句文本
+    std::string target;                          // 赋值目标 / 事件名
+    VariableScope target_scope;                  // 赋值目标槽位
+    size_t target_slot;
+    bool coerce_target;                          // 赋值时转换为声明类型
+    ValueType target_type;
+    ExpressionNode* expression;                  // 表达式 / 赋值右值 / 条件（位于程序的 Arena 中）
+    std::vector<Statement> body;                 // 条件体
+    std::vector<ExpressionNode*> arguments;      // emit 实参（位于程序的 Arena 中）
+    uint64_t gas;                                // 执行本语句收取的 gas（编译时计算，条件体各语句另计）
+    
+    Statement() : type(StatementType::EXPRESSION), target_scope(VariableScope::UNRESOLVED), target_slot(0),
+                  coerce_target(false), target_type(ValueType::STRING), expression(nullptr), gas(1) {}
+};
+
+// 预编译的方法程序（加载时生成，执行时直接使用）
+struct CompiledProgram {
+    Arena arena{256};                            // 持有全部表达式节点
+    std::vector<Statement> statements;
+    ExpressionNode* returns = nullptr;           // 返回值表达式（可选）
+    uint64_t returns_gas = 0;                    // 计算返回值收取的 gas
+    bool uses_slots = false;                     // 是否按 SlotLayout 解析过变量
+};
+
+class StateVariableResolver;
+class ExpressionParser;
+
+// 执行计数（启用运行时指标时由 CardityRuntime 提供，未设置时不计数）
+struct ExecutionCounters {
+    uint64_t statements = 0;        // 执行的语句数
+    uint64_t state_reads = 0;       // 读取状态变量的次数（不含方法参数）
+    uint64_t state_writes = 0;      // 写入状态变量的次数
+};
+
+// gas 耗尽：方法执行中止，CardityRuntime 回滚本次调用
+class OutOfGasError : public std::runtime_error {
+public:
+    explicit OutOfGasError(uint64_t limit);
+};
+
+// 事件接收器：emit 语句按实参顺序求值为字符串后交给接收器（通常是 CardityRuntime）
+class EventSink {
+public:
+    virtual ~EventSink() = default;
+    virtual void emit(std::string_view name, std::vector<std::string>&& values) = 0;
 };
 
-// 变量解析器
+// 变量解析器（名称可带 state. / params. 前缀，裸名称先查参数后查状态）
 class VariableResolver {
 public:
     virtual ~VariableResolver() = default;
     
-    // 解析变量值
-    virtual std::string resolve_variable(const std::string& name) const = 0;
+    // 解析变量值：返回值的指针（下一次解析或写入前有效），变量不存在时返回 nullptr
+    virtual const StateValue* resolve_variable(std::string_view name) const = 0;
     
     // 设置变量值
-    virtual void set_variable(const std::string& name, const std::string& value) = 0;
+    virtual void set_variable(std::string_view name, const StateValue& value) = 0;
     
     // 检查变量是否存在
-    virtual bool has_variable(const std::string& name) const = 0;
+    virtual bool has_variable(std::string_view name) const = 0;
 };
 
-// 逻辑引擎
+// 逻辑引擎（每个运行时实例独占一个；静态编译接口无共享可变状态，可并发调用）
+// 未预编译的逻辑（evaluate_expression、execute_assignment 等）在 scratch Arena 中解析并执行，
+// 每个入口返回时回收；CardityRuntime 在每次方法调用结束时 reset_scratch
 class LogicEngine {
+    friend class ExpressionParser;
+    
 private:
     std::unique_ptr<VariableResolver> resolver;
+    StateVariableResolver* slot_resolver;  // resolver 支持槽位访问时非空
+    Arena scratch;                         // 单次调用内的临时表达式节点和文本
+    EventSink* event_sink = nullptr;       // 未设置时 emit 语句不执行
+    ExecutionCounters* counters = nullptr; // 未设置时不计数（只多一次指针判断）
+    uint64_t gas_used = 0;
+    uint64_t gas_limit = 0;
+    uint64_t gas_budget = UINT64_MAX;      // 超过即耗尽；不限制时为最大值，收取只需一次比较
     
 public:
     LogicEngine();
     explicit LogicEngine(std::unique_ptr<VariableResolver> var_resolver);
     
-    // 解析表达式
-    std::unique_ptr<ExpressionNode> parse_expression(const std::string& expression);
+    // 解析表达式，节点分配在 arena 中
+    // 按优先级解析 || && == != < > <= >= + - * / % 和一元 ! -，支持括号；只含字面量的子表达式在解析时折叠。
+    // 顶层的单个 = 解析为赋值。无法按表达式语法解析的文本沿用原规则，视为变量引用或字面量
+    static ExpressionNode* parse_expression(std::string_view expression, Arena& arena);
+    
+    // 预编译方法逻辑和返回值表达式
+    // 提供 layout 时变量引用在编译期解析为槽位
+    static std::shared_ptr<const CompiledProgram> compile_program(const std::string& logic,
+                                                                  const std::string& returns = "",
+                                                                  const SlotLayout* layout = nullptr);
+    
+    // 执行预编译程序，返回最后一个表达式的结果
+    std::string execute_program(const CompiledProgram& program);
     
-    // 执行表达式
+    // 计算预编译程序的返回值
+    std::string evaluate_returns(const CompiledProgram& program);
+    
+    // 执行表达式（字符串结果用于 JSON/CLI 边界）
     std::string evaluate_expression(const std::string& expression);
     std::string evaluate_node(const ExpressionNode& node);
     
+    // 执行表达式，返回原生类型值
+    StateValue evaluate_value(const ExpressionNode& node);
+    
+    // 执行表达式；已解析槽位的变量直接返回存储中值的引用，其余结果写入 storage
+    // 表达式求值不写入状态，引用在本次求值期间有效
+    const StateValue& evaluate_ref(const ExpressionNode& node, StateValue& storage);
+    
     // 执行赋值语句
     bool execute_assignment(const std::string& assignment);
     
     // 执行条件语句
     bool execute_condition(const std::string& condition);
     
-    // 执行方法逻辑
+    // 执行方法逻辑（不生成 CompiledProgram，逐条解析并执行）
+    // emit 语句同样交给事件接收器；收取的 gas 与执行同一逻辑的预编译程序相同
     std::string execute_method_logic(const std::string& logic, const std::vector<std::string>& args);
     
+    // 回收临时表达式占用的内存（保留内存块供下一次调用复用）
+    void reset_scratch() { scratch.reset(); }
+    const Arena& get_scratch() const { return scratch; }
+    
     // 解析参数
     std::vector<std::string> parse_parameters(const std::string& param_str);
     
@@ -99,22 +221,74 @@ public:
     // 获取变量解析器
     VariableResolver* get_resolver() { return resolver.get(); }
     const VariableResolver* get_resolver() const { return resolver.get(); }
+    
+    // 获取支持槽位访问的解析器（可能为空）
+    StateVariableResolver* get_slot_resolver() { return slot_resolver; }
+    
+    // 设置 emit 语句的事件接收器（不持有）
+    void set_event_sink(EventSink* sink) { event_sink = sink; }
+    
+    // 设置执行计数的累加目标（不持有），nullptr 关闭计数
+    void set_counters(ExecutionCounters* target) { counters = target; }
+    
+    // gas 计量：每条语句收取 1 加其表达式（条件、右值、emit 实参）的节点数，返回值表达式按节点数收取。
+    // 预编译程序的收费在编译时算好，执行时每条语句只有一次加法和比较；
+    // 字符串拼接另按结果长度每 STRING_BYTES_PER_GAS 字节收取 1，使 gas 上限同时限制内存和复制量。
+    // 收费只取决于程序和状态，各节点一致。累计超过 limit 时抛出 OutOfGasError，limit 为 0 表示只计量不限制
+    void start_metering(uint64_t limit) {
+        gas_used = 0;
+        gas_limit = limit;
+        gas_budget = limit ? limit : UINT64_MAX;
+    }
+    uint64_t get_gas_used() const { return gas_used; }
+    
+    static constexpr uint64_t STRING_BYTES_PER_GAS = 32;
+    
+    // 表达式树的 gas（节点数）
+    static uint64_t expression_gas(const ExpressionNode* node);
 
 private:
+    // 编译语句列表
+    static void compile_statements(std::string_view logic, std::vector<Statement>& statements, Arena& arena);
+    
+    // 直接解释执行逻辑文本，表达式节点分配在 scratch 中
+    void interpret_statements(std::string_view logic, StateValue& last_result);
+    void assign(std::string_view target, const StateValue& value);
+    void interpret_emit(std::string_view name, std::string_view arguments);
+    void count_read(const ExpressionNode& node);
+    
+    // 热路径只有加法和比较，抛出异常的部分不内联
+    void charge_gas(uint64_t cost) {
+        gas_used += cost;
+        if (gas_used > gas_budget) {
+            out_of_gas();
+        }
+    }
+    [[noreturn]] void out_of_gas();
+    
+    // 将表达式树中的变量引用解析为槽位
+    static void resolve_slots(ExpressionNode& node, const SlotLayout& layout);
+    static void resolve_slots(std::vector<Statement>& statements, const SlotLayout& layout);
+    
+    // 执行语句列表
+    void execute_statements(const std::vector<Statement>& statements, StateValue& last_result);
+    
     // 解析操作符
-    OperatorType parse_operator(const std::string& op_str);
+    static OperatorType parse_operator(std::string_view op_str);
     
     // 解析字面量
-    std::string parse_literal(const std::string& literal);
+    static std::string_view parse_literal(std::string_view literal);
+    static ExpressionNode* make_literal(std::string_view literal, Arena& arena);
     
     // 解析变量引用
-    std::string parse_variable(const std::string& var_name);
+    StateValue resolve_node_variable(const ExpressionNode& node);
+    const StateValue* peek_node_variable(const ExpressionNode& node) const;
     
-    // 执行二元操作
-    std::string execute_binary_op(OperatorType op, const std::string& left, const std::string& right);
+    // 执行二元操作（不含赋值；无副作用，加载时的常量折叠也使用）
+    static StateValue execute_binary_op(OperatorType op, const StateValue& left, const StateValue& right);
     
     // 执行一元操作
-    std::string execute_unary_op(OperatorType op, const std::string& operand);
+    static StateValue execute_unary_op(OperatorType op, const StateValue& operand);
     
     // 类型转换
     bool string_to_bool(const std::string& value) const;
@@ -129,7 +303,10 @@ private:
 class StateVariableResolver : public VariableResolver {
 private:
     StateManager* state_manager;
-    std::map<std::string, std::string> params;
+    FlatHashMap<StateValue> params;         // 按名称设置的参数（字符串值）
+    mutable StateValue lookup_buffer;       // 存储无法提供稳定引用（如内存映射镜像）时保存解析结果
+    std::vector<StateValue> param_slots;    // 按参数槽位连续存储的实参（只增不减，复用字符串容量）
+    size_t param_count = 0;                 // 本次调用绑定的实参个数
     
 public:
     explicit StateVariableResolver(StateManager* manager);
@@ -138,10 +315,20 @@ public:
     void set_parameters(const std::map<std::string, std::string>& parameters);
     void set_parameter(const std::string& name, const std::string& value);
     
+    // 按参数槽位绑定实参（顺序与 Method::params 一致）
+    void bind_arguments(const std::vector<std::string>& args);
+    
+    // 槽位访问
+    StateValue resolve_slot(VariableScope scope, size_t slot) const;
+    void set_slot(VariableScope scope, size_t slot, const StateValue& value);
+    
+    // 槽位中值的指针（下一次写入前有效），无法直接引用时返回 nullptr
+    const StateValue* peek_slot(VariableScope scope, size_t slot) const;
+    
     // 实现 VariableResolver 接口
-    std::string resolve_variable(const std::string& name) const override;
-    void set_variable(const std::string& name, const std::string& value) override;
-    bool has_variable(const std::string& name) const override;
+    const StateValue* resolve_variable(std::string_view name) const override;
+    void set_variable(std::string_view name, const StateValue& value) override;
+    bool has_variable(std::string_view name) const override;
     
     // 获取状态管理器
     StateManager* get_state_manager() { return state_manager; }
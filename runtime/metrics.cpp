@@ -0,0 +1,101 @@
+#include "metrics.h"
+#include <algorithm>
+
+namespace cardity {
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    uint64_t micros = nanoseconds / 1000;
+    size_t bucket = 0;
+    while (micros > 0 && bucket + 1 < BUCKETS) {
+        micros >>= 1;
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++samples;
+    total += nanoseconds;
+    maximum = std::max(maximum, nanoseconds);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    samples += other.samples;
+    total += other.total;
+    maximum = std::max(maximum, other.maximum);
+}
+
+uint64_t LatencyHistogram::percentile_us(double quantile) const {
+    if (samples == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(samples - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return uint64_t(1) << i;
+        }
+    }
+    return uint64_t(1) << (BUCKETS - 1);
+}
+
+nlohmann::json LatencyHistogram::to_json() const {
+    nlohmann::json histogram;
+    histogram["count"] = samples;
+    histogram["mean_ns"] = samples ? total / samples : 0;
+    histogram["max_ns"] = maximum;
+    histogram["p50_us"] = percentile_us(0.50);
+    histogram["p99_us"] = percentile_us(0.99);
+
+    // 只输出非空的桶：[上界（微秒）, 调用数]
+    nlohmann::json counts = nlohmann::json::array();
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        if (buckets[i] > 0) {
+            counts.push_back({uint64_t(1) << i, buckets[i]});
+        }
+    }
+    histogram["buckets_us"] = counts;
+    return histogram;
+}
+
+void MethodMetrics::merge(const MethodMetrics& other) {
+    calls += other.calls;
+    failures += other.failures;
+    events += other.events;
+    gas += other.gas;
+    scratch_bytes += other.scratch_bytes;
+    execution.statements += other.execution.statements;
+    execution.state_reads += other.execution.state_reads;
+    execution.state_writes += other.execution.state_writes;
+    latency.merge(other.latency);
+}
+
+nlohmann::json MethodMetrics::to_json() const {
+    nlohmann::json metrics;
+    metrics["calls"] = calls;
+    metrics["failures"] = failures;
+    metrics["statements"] = execution.statements;
+    metrics["state_reads"] = execution.state_reads;
+    metrics["state_writes"] = execution.state_writes;
+    metrics["events"] = events;
+    metrics["gas"] = gas;
+    metrics["scratch_bytes"] = scratch_bytes;
+    metrics["latency"] = latency.to_json();
+    return metrics;
+}
+
+nlohmann::json RuntimeMetrics::to_json() const {
+    nlohmann::json result;
+    uint64_t calls = 0;
+    nlohmann::json methods_json = nlohmann::json::object();
+    for (const auto& [name, metrics] : methods) {
+        calls += metrics.calls;
+        methods_json[name] = metrics.to_json();
+    }
+    result["calls"] = calls;
+    result["methods"] = methods_json;
+    return result;
+}
+
+} // namespace cardity
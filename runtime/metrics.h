@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include "flat_hash_map.h"
+#include "logic_engine.h"
+
+namespace cardity {
+
+// 延迟直方图：按 2 的幂划分的微秒桶
+// 桶 0 记录不足 1 微秒的调用，桶 i 记录 [2^(i-1), 2^i) 微秒，最后一个桶不设上限
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 24;
+
+    void record(uint64_t nanoseconds);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return samples; }
+    uint64_t total_ns() const { return total; }
+    uint64_t max_ns() const { return maximum; }
+
+    // 分位数的上界估计（微秒，所在桶的上界）；没有样本时为 0
+    uint64_t percentile_us(double quantile) const;
+
+    nlohmann::json to_json() const;
+
+private:
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t samples = 0;
+    uint64_t total = 0;
+    uint64_t maximum = 0;
+};
+
+// 单个方法的累计指标
+struct MethodMetrics {
+    uint64_t calls = 0;
+    uint64_t failures = 0;
+    uint64_t events = 0;
+    uint64_t gas = 0;               // 收取的 gas 总量（含失败的调用）
+    uint64_t scratch_bytes = 0;     // 引擎临时 Arena 中分配的字节数（未预编译的逻辑）
+    ExecutionCounters execution;    // 执行的语句数和状态读写次数
+    LatencyHistogram latency;
+
+    // 累加另一份指标（例如并行重放的工作实例上记录的调用）
+    void merge(const MethodMetrics& other);
+
+    nlohmann::json to_json() const;
+};
+
+// 运行时指标（RuntimeConfig::enable_metrics 开启时由 CardityRuntime 记录）
+// 非线程安全，由所属的运行时串行更新
+class RuntimeMetrics {
+public:
+    MethodMetrics& method(std::string_view name) { return methods[name]; }
+    const FlatHashMap<MethodMetrics>& get_methods() const { return methods; }
+
+    void clear() { methods.clear(); }
+
+    // {"calls": 总调用数, "methods": {name: {...}}}
+    nlohmann::json to_json() const;
+
+private:
+    FlatHashMap<MethodMetrics> methods;
+};
+
+} // namespace cardity
@@ -0,0 +1,517 @@
+#include "mmap_state_store.h"
+#include "binary_codec.h"
+#include "log.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace cardity {
+
+namespace {
+
+const char IMAGE_MAGIC[4] = {'C', 'M', 'A', 'P'};
+const uint32_t IMAGE_VERSION = 1;
+const size_t IMAGE_HEADER_SIZE = 48;
+const size_t BUCKET_SIZE = 16;
+
+// 覆盖层中的保留键
+const char TOMBSTONE_PREFIX = '\0';
+const std::string BASE_CLEARED_KEY(1, TOMBSTONE_PREFIX);
+
+std::string tombstone_key(const std::string& key) {
+    return BASE_CLEARED_KEY + key;
+}
+
+bool is_reserved_key(const std::string& key) {
+    return !key.empty() && key[0] == TOMBSTONE_PREFIX;
+}
+
+// FNV-1a 64 位哈希（写入文件，必须跨平台稳定）
+uint64_t hash_key(const char* data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+json value_to_json(const StateValue& value) {
+    json value_json;
+    value_json["type"] = static_cast<int>(value.type());
+    value_json["value"] = value.to_string();
+    return value_json;
+}
+
+StateValue value_from_json(const json& value_json) {
+    return StateValue(static_cast<ValueType>(value_json["type"].get<int>()),
+                      value_json["value"].get<std::string>());
+}
+
+} // namespace
+
+MmapStateStore::MmapStateStore(std::unique_ptr<StateStore> overlay_store)
+    : overlay(overlay_store ? std::move(overlay_store) : std::make_unique<MemoryStateStore>()),
+      base(nullptr), base_size(0), entry_count(0), bucket_count(0), index_offset(0), data_offset(0),
+      base_cleared(false) {
+    load_overlay_markers();
+}
+
+void MmapStateStore::load_overlay_markers() {
+    base_cleared = false;
+    removed_keys.clear();
+    overlay->for_each([this](const std::string& key, const StateValue&) {
+        if (key == BASE_CLEARED_KEY) {
+            base_cleared = true;
+        } else if (is_reserved_key(key)) {
+            removed_keys[std::string_view(key).substr(1)] = true;
+        }
+    });
+}
+
+MmapStateStore::~MmapStateStore() {
+    close();
+}
+
+bool MmapStateStore::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        CARDITY_LOG_ERROR("Failed to open state image: " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < IMAGE_HEADER_SIZE) {
+        CARDITY_LOG_ERROR("Invalid state image: " << path);
+        ::close(fd);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        CARDITY_LOG_ERROR("Failed to map state image: " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(mapped);
+    uint64_t entries = get_u64(data + 8);
+    uint64_t buckets = get_u64(data + 16);
+    uint64_t index_start = get_u64(data + 24);
+    uint64_t data_start = get_u64(data + 32);
+    uint64_t file_size = get_u64(data + 40);
+
+    // 校验文件头，之后的查找只做廉价的边界检查
+    bool valid = std::memcmp(data, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+                 get_u32(data + 4) == IMAGE_VERSION &&
+                 file_size == length &&
+                 buckets > 0 && (buckets & (buckets - 1)) == 0 && entries <= buckets &&
+                 index_start == IMAGE_HEADER_SIZE &&
+                 buckets <= (length - index_start) / BUCKET_SIZE &&
+                 data_start == index_start + buckets * BUCKET_SIZE;
+    // 索引中的每个非空偏移都必须指向数据区内至少能容纳键长字段的位置，
+    // 查找时不必再担心偏移越过映射末尾
+    for (uint64_t bucket = 0; valid && bucket < buckets; ++bucket) {
+        uint64_t offset = get_u64(data + index_start + bucket * BUCKET_SIZE + 8);
+        valid = offset == 0 || (offset >= data_start && offset <= length - 4);
+    }
+    if (!valid) {
+        CARDITY_LOG_ERROR("Corrupt or unsupported state image: " << path);
+        ::munmap(mapped, length);
+        return false;
+    }
+
+#ifdef MADV_RANDOM
+    // 哈希查找是随机访问，避免无用的预读
+    ::madvise(mapped, length, MADV_RANDOM);
+#endif
+
+    image_path = path;
+    base = data;
+    base_size = length;
+    entry_count = entries;
+    bucket_count = buckets;
+    index_offset = index_start;
+    data_offset = data_start;
+
+    CARDITY_LOG_DEBUG("Mapped state image " << path << " (" << entry_count << " keys, " << length << " bytes)");
+    return true;
+}
+
+void MmapStateStore::close() {
+    if (base) {
+        ::munmap(const_cast<char*>(base), base_size);
+    }
+    base = nullptr;
+    base_size = 0;
+    entry_count = 0;
+    bucket_count = 0;
+    index_offset = 0;
+    data_offset = 0;
+}
+
+bool MmapStateStore::read_record(uint64_t offset, std::string* key, StateValue* value, uint64_t* next) const {
+    if (offset < data_offset || offset > base_size || base_size - offset < 4) {
+        return false;
+    }
+    uint64_t key_length = get_u32(base + offset);
+    uint64_t pos = offset + 4;
+    if (base_size - pos < key_length + 5) {
+        return false;
+    }
+    const char* key_data = base + pos;
+    pos += key_length;
+
+    uint8_t type = static_cast<uint8_t>(base[pos]);
+    uint64_t value_length = get_u32(base + pos + 1);
+    pos += 5;
+    if (type > static_cast<uint8_t>(ValueType::FLOAT) || base_size - pos < value_length) {
+        return false;
+    }
+
+    if (key) {
+        key->assign(key_data, key_length);
+    }
+    if (value) {
+        *value = StateValue(static_cast<ValueType>(type), std::string(base + pos, value_length));
+    }
+    if (next) {
+        *next = pos + value_length;
+    }
+    return true;
+}
+
+uint64_t MmapStateStore::find_record(const std::string& key) const {
+    if (!base) {
+        return 0;
+    }
+
+    uint64_t hash = hash_key(key.data(), key.size());
+    uint64_t mask = bucket_count - 1;
+    uint64_t bucket = hash & mask;
+
+    for (uint64_t probes = 0; probes < bucket_count; ++probes) {
+        const char* entry = base + index_offset + bucket * BUCKET_SIZE;
+        uint64_t offset = get_u64(entry + 8);
+        if (offset == 0) {
+            return 0;
+        }
+        if (get_u64(entry) == hash && offset >= data_offset && offset <= base_size && base_size - offset >= 4) {
+            uint64_t key_length = get_u32(base + offset);
+            if (key_length == key.size() && base_size - offset - 4 >= key_length &&
+                std::memcmp(base + offset + 4, key.data(), key_length) == 0) {
+                return offset;
+            }
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return 0;
+}
+
+uint64_t MmapStateStore::visible_record(const std::string& key) const {
+    if (!base || base_cleared || removed_keys.contains(key)) {
+        return 0;
+    }
+    return find_record(key);
+}
+
+void MmapStateStore::visit_base(const StateVisitor& visitor) const {
+    if (!base || base_cleared) {
+        return;
+    }
+
+    std::string key;
+    StateValue value;
+    uint64_t offset = data_offset;
+    for (uint64_t i = 0; i < entry_count; ++i) {
+        uint64_t next = 0;
+        if (!read_record(offset, &key, &value, &next)) {
+            CARDITY_LOG_ERROR("Corrupt record in state image: " << image_path);
+            return;
+        }
+        if (!removed_keys.contains(key) && !overlay->has_key(key)) {
+            visitor(key, value);
+        }
+        offset = next;
+    }
+}
+
+bool MmapStateStore::set_value(const std::string& key, const StateValue& value) {
+    if (is_reserved_key(key)) {
+        CARDITY_LOG_ERROR("State keys must not start with a NUL byte");
+        return false;
+    }
+    if (!overlay->set_value(key, value)) {
+        return false;
+    }
+
+    if (removed_keys.erase(key) != 0) {
+        overlay->remove_key(tombstone_key(key));
+    }
+    return true;
+}
+
+StateValue MmapStateStore::get_value(const std::string& key) const {
+    if (overlay->has_key(key)) {
+        return overlay->get_value(key);
+    }
+
+    StateValue value;
+    if (uint64_t offset = visible_record(key)) {
+        read_record(offset, nullptr, &value, nullptr);
+    }
+    return value;
+}
+
+bool MmapStateStore::has_key(const std::string& key) const {
+    return overlay->has_key(key) || visible_record(key) != 0;
+}
+
+bool MmapStateStore::remove_key(const std::string& key) {
+    if (is_reserved_key(key)) {
+        return false;
+    }
+
+    bool removed = overlay->remove_key(key);
+    if (visible_record(key) != 0) {
+        overlay->set_value(tombstone_key(key), StateValue::from_bool(true));
+        removed_keys[key] = true;
+        removed = true;
+    }
+    return removed;
+}
+
+void MmapStateStore::set_multiple(const std::map<std::string, StateValue>& values) {
+    for (const auto& [key, value] : values) {
+        set_value(key, value);
+    }
+}
+
+std::map<std::string, StateValue> MmapStateStore::get_all() const {
+    std::map<std::string, StateValue> result;
+    for_each([&result](const std::string& key, const StateValue& value) {
+        result[key] = value;
+    });
+    return result;
+}
+
+void MmapStateStore::for_each(const StateVisitor& visitor) const {
+    visit_base(visitor);
+    overlay->for_each([&visitor](const std::string& key, const StateValue& value) {
+        if (!is_reserved_key(key)) {
+            visitor(key, value);
+        }
+    });
+}
+
+const StateValue* MmapStateStore::find_value(std::string_view key) const {
+    // 覆盖层优先；镜像中的值没有稳定的 StateValue 对象，由调用方改用 get_value
+    return overlay->find_value(key);
+}
+
+bool MmapStateStore::save_to_file(const std::string& file_path) const {
+    try {
+        json j = json::object();
+        for_each([&j](const std::string& key, const StateValue& value) {
+            j[key] = value_to_json(value);
+        });
+
+        std::ofstream file(file_path);
+        if (!file.is_open()) {
+            CARDITY_LOG_ERROR("Failed to open file for writing: " << file_path);
+            return false;
+        }
+
+        file << j.dump(2);
+        return true;
+    } catch (const std::exception& e) {
+        CARDITY_LOG_ERROR("Error saving to file: " << e.what());
+        return false;
+    }
+}
+
+bool MmapStateStore::load_from_file(const std::string& file_path) {
+    try {
+        std::ifstream file(file_path);
+        if (!file.is_open()) {
+            CARDITY_LOG_ERROR("Failed to open file: " << file_path);
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+
+        json j = json::parse(buffer.str());
+
+        clear();
+        for (const auto& [key, value_json] : j.items()) {
+            set_value(key, value_from_json(value_json));
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        CARDITY_LOG_ERROR("Error loading from file: " << e.what());
+        return false;
+    }
+}
+
+json MmapStateStore::create_snapshot() const {
+    json snapshot;
+    json state_json = json::object();
+    for_each([&state_json](const std::string& key, const StateValue& value) {
+        state_json[key] = value_to_json(value);
+    });
+    snapshot["state"] = state_json;
+    return snapshot;
+}
+
+bool MmapStateStore::restore_from_snapshot(const json& snapshot) {
+    try {
+        if (!snapshot.contains("state")) {
+            CARDITY_LOG_ERROR("Invalid snapshot format: missing state");
+            return false;
+        }
+
+        clear();
+        for (const auto& [key, value_json] : snapshot["state"].items()) {
+            set_value(key, value_from_json(value_json));
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        CARDITY_LOG_ERROR("Error restoring from snapshot: " << e.what());
+        return false;
+    }
+}
+
+void MmapStateStore::clear() {
+    overlay->clear();
+    removed_keys.clear();
+    base_cleared = base != nullptr;
+    if (base_cleared) {
+        overlay->set_value(BASE_CLEARED_KEY, StateValue::from_bool(true));
+    }
+}
+
+size_t MmapStateStore::size() const {
+    bool use_base = base && !base_cleared;
+    size_t count = use_base ? static_cast<size_t>(entry_count) : 0;
+
+    // 覆盖层中的新键增加计数，删除镜像键的墓碑减少计数
+    overlay->for_each([&](const std::string& key, const StateValue&) {
+        if (key == BASE_CLEARED_KEY) {
+            return;
+        }
+        if (is_reserved_key(key)) {
+            if (use_base && find_record(key.substr(1)) != 0) {
+                --count;
+            }
+        } else if (!use_base || find_record(key) == 0) {
+            ++count;
+        }
+    });
+    return count;
+}
+
+bool MmapStateStore::write_image(const std::string& path, const StateStore& source) {
+    // 先按遍历顺序编码记录（偏移相对于数据区起点），再建立索引
+    std::string records;
+    std::vector<std::pair<uint64_t, uint64_t>> hashed;     // {键哈希, 相对偏移}
+    source.for_each([&](const std::string& key, const StateValue& value) {
+        hashed.emplace_back(hash_key(key.data(), key.size()), records.size());
+        put_string(records, key);
+        records.push_back(static_cast<char>(value.type()));
+        put_string(records, value.to_string());
+    });
+
+    // 负载因子不超过 0.5
+    uint64_t buckets = 8;
+    while (buckets < hashed.size() * 2) {
+        buckets <<= 1;
+    }
+
+    uint64_t data_start = IMAGE_HEADER_SIZE + buckets * BUCKET_SIZE;
+    std::vector<uint64_t> index(buckets * 2, 0);
+    for (const auto& [hash, relative] : hashed) {
+        uint64_t bucket = hash & (buckets - 1);
+        while (index[bucket * 2 + 1] != 0) {
+            bucket = (bucket + 1) & (buckets - 1);
+        }
+        index[bucket * 2] = hash;
+        index[bucket * 2 + 1] = data_start + relative;
+    }
+
+    std::string contents(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    contents.reserve(data_start + records.size());
+    put_u32(contents, IMAGE_VERSION);
+    put_u64(contents, hashed.size());
+    put_u64(contents, buckets);
+    put_u64(contents, IMAGE_HEADER_SIZE);
+    put_u64(contents, data_start);
+    put_u64(contents, data_start + records.size());
+    for (uint64_t slot : index) {
+        put_u64(contents, slot);
+    }
+    contents.append(records);
+
+    // 写入临时文件后原子替换（已有的映射仍指向旧文件）
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        CARDITY_LOG_ERROR("Failed to create state image: " << temp_path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    bool written = true;
+    const char* data = contents.data();
+    size_t remaining = contents.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, data, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            written = false;
+            break;
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    written = written && ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!written || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        CARDITY_LOG_ERROR("Failed to write state image: " << path);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MmapStateStore::compact(const std::string& path) {
+    if (!write_image(path, *this)) {
+        return false;
+    }
+
+    // 新镜像已包含覆盖层中的全部写入
+    if (!open(path)) {
+        return false;
+    }
+    overlay->clear();
+    overlay->sync_point();
+    removed_keys.clear();
+    base_cleared = false;
+    return true;
+}
+
+} // namespace cardity
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "state_store.h"
+#include "flat_hash_map.h"
+
+namespace cardity {
+
+// 内存映射状态存储（读多写少的大状态）
+// 基础镜像是只读映射的文件，带开放寻址哈希索引，get_value/has_key 只访问用到的页：
+//   文件头:   "CMAP" + u32 版本 + u64 条目数 + u64 桶数 + u64 索引偏移 + u64 数据偏移 + u64 文件大小
+//   索引:     桶数 × {u64 键哈希, u64 记录偏移}（偏移为 0 表示空桶，线性探测）
+//   记录:     u32 键长 + 键 + u8 类型 + u32 值长 + 值文本
+// 写入进入覆盖层存储（默认 MemoryStateStore，传入 WalStateStore 即可持久化）；
+// 删除镜像中的键时在覆盖层写入以 '\0' 开头的墓碑键，clear 写入单独的 "\0" 键隐藏整个镜像
+class MmapStateStore : public StateStore {
+private:
+    std::unique_ptr<StateStore> overlay;
+
+    // 映射的基础镜像
+    std::string image_path;
+    const char* base;
+    size_t base_size;
+    uint64_t entry_count;
+    uint64_t bucket_count;
+    uint64_t index_offset;
+    uint64_t data_offset;
+
+    // 覆盖层中保留键的内存副本，读路径不必为每次查找构造墓碑键：
+    // base_cleared 对应 "\0" 键，removed_keys 为墓碑键去掉前缀后的原键
+    bool base_cleared;
+    FlatHashMap<bool> removed_keys;
+
+    // 从覆盖层（例如重放后的 WAL）重建上面的副本
+    void load_overlay_markers();
+
+    // 在镜像中查找键，返回记录偏移（0 表示不存在）
+    uint64_t find_record(const std::string& key) const;
+
+    // 解码 offset 处的记录，next 返回下一条记录的偏移
+    bool read_record(uint64_t offset, std::string* key, StateValue* value, uint64_t* next) const;
+
+    // 键在镜像中存在且未被删除时返回记录偏移，否则返回 0
+    uint64_t visible_record(const std::string& key) const;
+
+    // 遍历镜像中仍可见的键值
+    void visit_base(const StateVisitor& visitor) const;
+
+public:
+    explicit MmapStateStore(std::unique_ptr<StateStore> overlay_store = nullptr);
+    ~MmapStateStore() override;
+
+    MmapStateStore(const MmapStateStore&) = delete;
+    MmapStateStore& operator=(const MmapStateStore&) = delete;
+
+    // 映射基础镜像（只校验文件头和索引，不读取记录）；覆盖层保持不变
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return base != nullptr; }
+
+    // 将当前合并视图写成新镜像并重新映射，随后清空覆盖层；应在事务之外调用
+    bool compact(const std::string& path);
+
+    // 将任意存储的内容写成镜像文件
+    static bool write_image(const std::string& path, const StateStore& source);
+
+    // 实现 StateStore 接口
+    bool set_value(const std::string& key, const StateValue& value) override;
+    StateValue get_value(const std::string& key) const override;
+    bool has_key(const std::string& key) const override;
+    bool remove_key(const std::string& key) override;
+
+    void set_multiple(const std::map<std::string, StateValue>& values) override;
+    std::map<std::string, StateValue> get_all() const override;
+    void for_each(const StateVisitor& visitor) const override;
+    const StateValue* find_value(std::string_view key) const override;
+
+    // 文件读写使用与 MemoryStateStore 相同的 JSON 格式（导入写入覆盖层）
+    bool save_to_file(const std::string& file_path) const override;
+    bool load_from_file(const std::string& file_path) override;
+
+    json create_snapshot() const override;
+    bool restore_from_snapshot(const json& snapshot) override;
+
+    void clear() override;
+    size_t size() const override;
+
+    void sync_point() override { overlay->sync_point(); }
+    bool flush() override { return overlay->flush(); }
+
+    // 覆盖层只能经本存储修改（保留键的副本需要与之一致）
+    const StateStore* get_overlay() const { return overlay.get(); }
+    uint64_t get_image_entry_count() const { return entry_count; }
+};
+
+} // namespace cardity
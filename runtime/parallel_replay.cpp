@@ -0,0 +1,307 @@
+#include "parallel_replay.h"
+#include "log.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+namespace cardity {
+
+// 推测执行使用的存储：读操作转发到只读的基础存储并记录读集，写操作留在本地写集中
+// 读取本调用已写入的键不计入读集。get_all/for_each/size 视为读取全部状态；
+// clear/load/restore 等无法用写集表示的操作使该调用只能在主运行时上顺序执行
+class RecordingStateStore : public StateStore {
+public:
+    struct Write {
+        bool removed;
+        StateValue value;
+    };
+
+    // 开始记录一个新的调用
+    void reset(const StateStore* base_store) {
+        base = base_store;
+        writes.clear();
+        reads.clear();
+        read_all = false;
+        unsupported = false;
+    }
+
+    const FlatHashMap<Write>& get_writes() const { return writes; }
+    const FlatHashMap<char>& get_reads() const { return reads; }
+    bool reads_everything() const { return read_all; }
+    bool is_unsupported() const { return unsupported; }
+
+    bool set_value(const std::string& key, const StateValue& value) override {
+        writes.insert_or_assign(key, Write{false, value});
+        return true;
+    }
+
+    StateValue get_value(const std::string& key) const override {
+        auto it = writes.find(key);
+        if (it != writes.end()) {
+            return it->second.removed ? StateValue() : it->second.value;
+        }
+        reads.try_emplace(key, 1);
+        return base ? base->get_value(key) : StateValue();
+    }
+
+    bool has_key(const std::string& key) const override {
+        auto it = writes.find(key);
+        if (it != writes.end()) {
+            return !it->second.removed;
+        }
+        reads.try_emplace(key, 1);
+        return base && base->has_key(key);
+    }
+
+    const StateValue* find_value(std::string_view key) const override {
+        auto it = writes.find(key);
+        if (it != writes.end()) {
+            return it->second.removed ? nullptr : &it->second.value;
+        }
+        reads.try_emplace(key, 1);
+        return base ? base->find_value(key) : nullptr;
+    }
+
+    bool remove_key(const std::string& key) override {
+        bool existed = has_key(key);
+        writes.insert_or_assign(key, Write{true, StateValue()});
+        return existed;
+    }
+
+    void set_multiple(const std::map<std::string, StateValue>& values) override {
+        for (const auto& [key, value] : values) {
+            set_value(key, value);
+        }
+    }
+
+    std::map<std::string, StateValue> get_all() const override {
+        std::map<std::string, StateValue> result;
+        for_each([&result](const std::string& key, const StateValue& value) { result[key] = value; });
+        return result;
+    }
+
+    void for_each(const StateVisitor& visitor) const override {
+        read_all = true;
+        if (base) {
+            base->for_each([this, &visitor](const std::string& key, const StateValue& value) {
+                if (!writes.contains(key)) {
+                    visitor(key, value);
+                }
+            });
+        }
+        for (const auto& [key, write] : writes) {
+            if (!write.removed) {
+                visitor(key, write.value);
+            }
+        }
+    }
+
+    bool save_to_file(const std::string&) const override { return false; }
+
+    bool load_from_file(const std::string&) override {
+        unsupported = true;
+        return false;
+    }
+
+    json create_snapshot() const override {
+        unsupported = true;
+        return json::object();
+    }
+
+    bool restore_from_snapshot(const json&) override {
+        unsupported = true;
+        return false;
+    }
+
+    void clear() override { unsupported = true; }
+
+    size_t size() const override {
+        size_t count = 0;
+        for_each([&count](const std::string&, const StateValue&) { ++count; });
+        return count;
+    }
+
+private:
+    const StateStore* base = nullptr;
+    FlatHashMap<Write> writes;
+    mutable FlatHashMap<char> reads;
+    mutable bool read_all = false;
+    mutable bool unsupported = false;
+};
+
+struct ParallelReplay::Speculation {
+    MethodResult result;
+    std::vector<std::pair<std::string, RecordingStateStore::Write>> writes;
+    std::vector<std::string> reads;
+    bool read_all = false;
+    bool unsupported = false;
+    MethodMetrics metrics;      // 工作实例为本调用记录的指标（未开启指标时为空）
+};
+
+ParallelReplay::ParallelReplay(CardityRuntime& rt, RuntimeExecutor& exec, size_t worker_count)
+    : runtime(rt), executor(exec) {
+    if (worker_count == 0) {
+        worker_count = std::max<size_t>(1, executor.thread_count());
+    }
+
+    for (size_t i = 0; i < worker_count; ++i) {
+        Worker worker;
+        worker.runtime = std::make_unique<CardityRuntime>(runtime.get_config());
+        auto recorder = std::make_unique<RecordingStateStore>();
+        worker.recorder = recorder.get();
+        worker.runtime->set_state_store(std::move(recorder));
+        workers.push_back(std::move(worker));
+    }
+}
+
+ParallelReplay::~ParallelReplay() = default;
+
+void ParallelReplay::prepare_workers() {
+    auto protocol = runtime.get_shared_protocol();
+    RuntimeConfig config = runtime.get_config();
+    for (auto& worker : workers) {
+        // 构造之后主运行时的配置（gas 上限、指标开关等）可能已改变
+        worker.runtime->set_config(config);
+        if (worker.runtime->get_shared_protocol() != protocol) {
+            // attach_protocol 会把默认值写入记录器，随后的 reset 会丢弃它们
+            worker.runtime->attach_protocol(protocol);
+        }
+    }
+}
+
+void ParallelReplay::speculate(Worker& worker, const StateStore* base, const MethodCall& call, Speculation& out) const {
+    CardityRuntime& rt = *worker.runtime;
+    RecordingStateStore& recorder = *worker.recorder;
+
+    recorder.reset(base);
+    rt.clear_event_log();
+    rt.get_state_manager()->clear_dirty();
+
+    rt.reset_metrics();
+    out.result = rt.call_method(call.method, call.args);
+    out.metrics = MethodMetrics();
+    if (const RuntimeMetrics* metrics = rt.get_runtime_metrics()) {
+        auto it = metrics->get_methods().find(call.method);
+        if (it != metrics->get_methods().end()) {
+            out.metrics = it->second;
+        }
+    }
+
+    out.reads.clear();
+    for (const auto& entry : recorder.get_reads()) {
+        out.reads.push_back(entry.first);
+    }
+    out.read_all = recorder.reads_everything();
+    out.unsupported = recorder.is_unsupported();
+    classify(call, out.read_all, out.unsupported);
+
+    // 失败的调用已回滚，写集中只剩回滚写回的旧值，不需要提交；事件随结果返回（失败时为空）
+    out.writes.clear();
+    if (out.result.success) {
+        out.writes.assign(recorder.get_writes().begin(), recorder.get_writes().end());
+    }
+}
+
+void ParallelReplay::apply(const MethodCall& call, const Speculation& speculation) {
+    StateManager* state = runtime.get_state_manager();
+    state->begin_transaction();
+    for (const auto& [key, write] : speculation.writes) {
+        if (write.removed) {
+            state->remove(key);
+        } else {
+            state->set_value(key, write.value);
+        }
+    }
+    state->commit();
+
+    for (const auto& event : speculation.result.events) {
+        runtime.emit_event(event);
+    }
+
+    // 只计入被采用的那次执行，作废的推测执行不计入主运行时的指标
+    RuntimeMetrics* metrics = runtime.get_runtime_metrics();
+    if (metrics && speculation.metrics.calls > 0) {
+        metrics->method(call.method).merge(speculation.metrics);
+    }
+}
+
+std::vector<MethodResult> ParallelReplay::replay(const std::vector<MethodCall>& calls) {
+    stats = ReplayStats();
+    stats.calls = calls.size();
+
+    std::vector<MethodResult> results;
+    results.reserve(calls.size());
+    if (calls.empty() || !runtime.get_protocol()) {
+        for (const auto& call : calls) {
+            results.push_back(runtime.call_method(call.method, call.args));
+        }
+        return results;
+    }
+
+    prepare_workers();
+    const StateStore* base = runtime.get_state_manager()->get_store();
+
+    // 推测执行：工作实例从共享计数器领取调用，主存储在此期间只读
+    std::vector<Speculation> speculations(calls.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> done;
+    for (auto& worker : workers) {
+        auto finished = std::make_shared<std::promise<void>>();
+        done.push_back(finished->get_future());
+        executor.post(*worker.runtime, [&, finished, worker_ptr = &worker](CardityRuntime&) {
+            try {
+                for (size_t i = next.fetch_add(1); i < calls.size(); i = next.fetch_add(1)) {
+                    speculate(*worker_ptr, base, calls[i], speculations[i]);
+                }
+                finished->set_value();
+            } catch (...) {
+                finished->set_exception(std::current_exception());
+            }
+        });
+    }
+    for (auto& future : done) {
+        future.get();
+    }
+
+    // 按顺序验证并提交
+    FlatHashMap<char> committed;    // 本批次已提交调用写过的键
+    bool committed_all = false;     // 有调用在主运行时上直接执行过，之后的推测结果全部作废
+    Speculation serial;
+
+    for (size_t i = 0; i < calls.size(); ++i) {
+        const Speculation* outcome = &speculations[i];
+
+        bool valid = !outcome->unsupported &&
+                     !(committed_all && (outcome->read_all || !outcome->reads.empty())) &&
+                     !(outcome->read_all && !committed.empty());
+        for (size_t r = 0; valid && r < outcome->reads.size(); ++r) {
+            valid = !committed.contains(outcome->reads[r]);
+        }
+
+        if (valid) {
+            ++stats.speculative;
+        } else {
+            // 冲突：在已提交的状态上重新执行（此时没有并发读取主存储）
+            ++stats.reexecuted;
+            speculate(workers.front(), base, calls[i], serial);
+            outcome = &serial;
+
+            if (serial.unsupported) {
+                CARDITY_LOG_DEBUG("Replay call " << i << " (" << calls[i].method << ") runs directly on the runtime");
+                results.push_back(runtime.call_method(calls[i].method, calls[i].args));
+                committed_all = true;
+                continue;
+            }
+        }
+
+        apply(calls[i], *outcome);
+        for (const auto& write : outcome->writes) {
+            committed.try_emplace(write.first, 1);
+        }
+        results.push_back(outcome->result);
+    }
+
+    return results;
+}
+
+} // namespace cardity
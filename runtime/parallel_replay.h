@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "runtime.h"
+#include "runtime_executor.h"
+
+namespace cardity {
+
+class RecordingStateStore;
+
+// 并行重放统计
+struct ReplayStats {
+    size_t calls;           // 重放的调用数
+    size_t speculative;     // 直接采用推测执行结果的调用数
+    size_t reexecuted;      // 因冲突重新执行的调用数
+
+    ReplayStats() : calls(0), speculative(0), reexecuted(0) {}
+};
+
+// 单个运行时上的乐观并行重放（Block-STM 思路的简化版本）
+// 1. 推测执行：所有调用以批次开始时的状态为基础，在共享同一协议的工作实例上并行执行，
+//    工作实例的存储（RecordingStateStore）只读访问主存储，并记录每个调用的读集和写集
+// 2. 按顺序提交：调用的读集与前面已提交调用的写集不相交时，直接把它的写集作为一个事务
+//    写入主运行时；否则在已提交的状态上重新执行该调用
+// 结果与对主运行时按顺序逐个 call_method 相同；开启指标时每个调用只有被采用的那次执行计入主运行时的指标。
+// 工作实例在每次 replay 开始时同步主运行时的配置。
+// 事务的撤销日志在写入前读取旧值，因此写过的键也计入读集（保守，只会多重新执行）。
+// 重放期间不得从其他线程访问主运行时，也不能在 executor 的任务中调用 replay。
+class ParallelReplay {
+public:
+    // worker_count 为 0 时使用 executor 的线程数
+    ParallelReplay(CardityRuntime& runtime, RuntimeExecutor& executor, size_t worker_count = 0);
+    virtual ~ParallelReplay();
+
+    ParallelReplay(const ParallelReplay&) = delete;
+    ParallelReplay& operator=(const ParallelReplay&) = delete;
+
+    // 重放一批调用，按顺序返回每个调用的结果
+    std::vector<MethodResult> replay(const std::vector<MethodCall>& calls);
+
+    // 最近一次 replay 的统计
+    const ReplayStats& get_stats() const { return stats; }
+
+protected:
+    // 每次推测执行之后调用，可把结果标记为读取了全部状态（read_all）或包含无法记录的操作
+    // （unsupported），两者都使该调用回退到按顺序执行；默认使用记录器得到的标记
+    virtual void classify(const MethodCall& call, bool& read_all, bool& unsupported) const {
+        (void)call;
+        (void)read_all;
+        (void)unsupported;
+    }
+
+private:
+    struct Worker {
+        std::unique_ptr<CardityRuntime> runtime;
+        RecordingStateStore* recorder;
+    };
+
+    // 推测执行的结果及其读写集
+    struct Speculation;
+
+    CardityRuntime& runtime;
+    RuntimeExecutor& executor;
+    std::vector<Worker> workers;
+    ReplayStats stats;
+
+    // 让工作实例使用主运行时当前的配置和协议
+    void prepare_workers();
+
+    // 在工作实例上执行一个调用并记录读写集
+    void speculate(Worker& worker, const StateStore* base, const MethodCall& call, Speculation& out) const;
+
+    // 把推测结果的写集、事件和指标提交到主运行时
+    void apply(const MethodCall& call, const Speculation& speculation);
+};
+
+} // namespace cardity
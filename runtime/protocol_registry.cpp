@@ -0,0 +1,110 @@
+#include "protocol_registry.h"
+#include "log.h"
+#include "sha256.h"
+#include "base64.h"
+
+namespace cardity {
+
+ProtocolRegistry& ProtocolRegistry::global() {
+    static ProtocolRegistry registry;
+    return registry;
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::load_from_file(const std::string& file_path) {
+    SourceBuffer source;
+    if (!source.open(file_path)) {
+        return nullptr;
+    }
+    return load_source(source.data(), Sha256::hex(source.data()));
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::load_from_json(const std::string& json_str) {
+    return load_source(json_str, Sha256::hex(json_str));
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::load_from_base64(const std::string& base64_str) {
+    std::string decoded;
+    if (!base64_decode(base64_str, decoded)) {
+        CARDITY_LOG_ERROR("Base64 decoding error: invalid input");
+        return nullptr;
+    }
+    return load_from_json(decoded);
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::load_source(std::string_view json_text,
+                                                            const std::string& content_hash) {
+    if (ProtocolPtr existing = find(content_hash)) {
+        return existing;
+    }
+
+    // 解析和编译在锁外进行；并发加载同一协议时由 add 保留先注册的版本
+    auto protocol = CarLoader::load_from_source(json_text, content_hash);
+    if (!protocol) {
+        CARDITY_LOG_ERROR("Failed to load protocol from JSON");
+        return nullptr;
+    }
+    return add(std::move(protocol));
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::add(std::unique_ptr<CarProtocol> protocol) {
+    if (!protocol) {
+        return nullptr;
+    }
+
+    if (!CarLoader::validate_protocol(*protocol)) {
+        CARDITY_LOG_ERROR("Invalid protocol format");
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto result = protocols.try_emplace(protocol->content_hash);
+    if (result.second) {
+        result.first->second = ProtocolPtr(std::move(protocol));
+        CARDITY_LOG_DEBUG("Registered protocol " << result.first->second->protocol
+                          << " (" << result.first->first << ")");
+    }
+    return result.first->second;
+}
+
+ProtocolRegistry::ProtocolPtr ProtocolRegistry::find(const std::string& hash) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = protocols.find(hash);
+    return it == protocols.end() ? nullptr : it->second;
+}
+
+bool ProtocolRegistry::contains(const std::string& hash) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return protocols.contains(hash);
+}
+
+bool ProtocolRegistry::remove(const std::string& hash) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return protocols.erase(hash) > 0;
+}
+
+size_t ProtocolRegistry::prune() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t removed = 0;
+    for (auto it = protocols.begin(); it != protocols.end();) {
+        // 只有注册表自己持有引用
+        if (it->second.use_count() == 1) {
+            it = protocols.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+size_t ProtocolRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return protocols.size();
+}
+
+void ProtocolRegistry::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    protocols.clear();
+}
+
+} // namespace cardity
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include "car_loader.h"
+#include "flat_hash_map.h"
+
+namespace cardity {
+
+// 协议注册表：按 CarProtocol::content_hash（原始字节的 SHA-256）缓存已解析并预编译的协议
+// 不使用文件中声明的 hash 字段作为键，两个不同的协议无法通过声明相同的 hash 互相替换
+// 同一协议只解析、编译一次，之后以 shared_ptr<const CompiledProtocol> 交给任意多个运行时实例，
+// 实例只持有自己的状态和事件日志（CardityRuntime::attach_protocol）
+// 注册表的公开方法可以从多个线程调用；返回的协议是只读的，可以跨线程共享
+class ProtocolRegistry {
+public:
+    using ProtocolPtr = std::shared_ptr<const CompiledProtocol>;
+
+    ProtocolRegistry() = default;
+    ProtocolRegistry(const ProtocolRegistry&) = delete;
+    ProtocolRegistry& operator=(const ProtocolRegistry&) = delete;
+
+    // 进程范围的默认注册表
+    static ProtocolRegistry& global();
+
+    // 加载协议：先计算内容哈希，已注册时直接返回已编译的协议（不解析 JSON），
+    // 否则解析、验证并注册；失败返回 nullptr
+    ProtocolPtr load_from_file(const std::string& file_path);
+    ProtocolPtr load_from_json(const std::string& json_str);
+    ProtocolPtr load_from_base64(const std::string& base64_str);
+
+    // 注册已加载的协议；同一内容哈希已存在时保留已注册的版本并返回它
+    ProtocolPtr add(std::unique_ptr<CarProtocol> protocol);
+
+    // 按内容哈希查找，未注册返回 nullptr
+    ProtocolPtr find(const std::string& hash) const;
+    bool contains(const std::string& hash) const;
+
+    // 移除协议（已持有该协议的实例不受影响）
+    bool remove(const std::string& hash);
+
+    // 移除不再被任何实例引用的协议，返回移除的数量
+    size_t prune();
+
+    size_t size() const;
+    void clear();
+
+private:
+    mutable std::mutex mutex;
+    FlatHashMap<ProtocolPtr> protocols;
+
+    // 按已计算的内容哈希查找，未命中时解析 JSON 文本
+    ProtocolPtr load_source(std::string_view json_text, const std::string& content_hash);
+};
+
+} // namespace cardity
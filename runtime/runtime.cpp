@@ -1,38 +1,76 @@
 #include "runtime.h"
+#include "protocol_registry.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <ctime>
-#include <iomanip>
+#include <algorithm>
+#include <chrono>
 
 namespace cardity {
 
+namespace {
+
+// 区块上下文以整数保存，时间戳字符串只在导出 JSON 时生成
+json block_to_json(const BlockContext& block) {
+    json block_json;
+    block_json["height"] = block.height;
+    block_json["time"] = block.time;
+    return block_json;
+}
+
+// 读取 "block"；旧格式只有格式化的 "timestamp"
+BlockContext block_from_json(const json& owner) {
+    BlockContext block;
+    auto it = owner.find("block");
+    if (it != owner.end() && it->is_object()) {
+        block.height = it->value("height", uint64_t(0));
+        block.time = it->value("time", int64_t(0));
+    } else {
+        auto timestamp = owner.find("timestamp");
+        if (timestamp != owner.end() && timestamp->is_string()) {
+            parse_timestamp(timestamp->get_ref<const std::string&>(), block.time);
+        }
+    }
+    return block;
+}
+
+} // namespace
+
 // CardityRuntime 实现
-CardityRuntime::CardityRuntime() : config() {
+CardityRuntime::CardityRuntime()
+    : config(), has_snapshot_base(false), deltas_since_full(0), snapshot_event_cursor(0),
+      state_view_version(UINT64_MAX), state_view_serialized(false) {
     initialize_runtime();
 }
 
-CardityRuntime::CardityRuntime(const RuntimeConfig& cfg) : config(cfg) {
+CardityRuntime::CardityRuntime(const RuntimeConfig& cfg)
+    : config(cfg), has_snapshot_base(false), deltas_since_full(0), snapshot_event_cursor(0),
+      state_view_version(UINT64_MAX), state_view_serialized(false) {
     initialize_runtime();
 }
 
 void CardityRuntime::initialize_runtime() {
+    set_log_level(config.log_level);
+    
     state_manager = std::make_unique<StateManager>();
-    variable_resolver = std::make_unique<StateVariableResolver>(state_manager.get());
-    logic_engine = std::make_unique<LogicEngine>(std::move(variable_resolver));
-    variable_resolver = std::make_unique<StateVariableResolver>(state_manager.get());
-    logic_engine->set_resolver(std::move(variable_resolver));
+    logic_engine = std::make_unique<LogicEngine>(std::make_unique<StateVariableResolver>(state_manager.get()));
+    event_recorder = std::make_unique<EventRecorder>();
+    logic_engine->set_event_sink(event_recorder.get());
+    event_log.set_capacity(config.event_log_capacity);
+    if (config.enable_metrics) {
+        metrics = std::make_unique<RuntimeMetrics>();
+    }
 }
 
 bool CardityRuntime::load_protocol(const std::string& car_file_path) {
     protocol = CarLoader::load_from_file(car_file_path);
     if (!protocol) {
-        std::cerr << "Failed to load protocol from file: " << car_file_path << std::endl;
+        CARDITY_LOG_ERROR("Failed to load protocol from file: " << car_file_path);
         return false;
     }
     
     if (!CarLoader::validate_protocol(*protocol)) {
-        std::cerr << "Invalid protocol format" << std::endl;
+        CARDITY_LOG_ERROR("Invalid protocol format");
         return false;
     }
     
@@ -44,12 +82,12 @@ bool CardityRuntime::load_protocol(const std::string& car_file_path) {
 bool CardityRuntime::load_protocol_from_json(const std::string& json_str) {
     protocol = CarLoader::load_from_json(json_str);
     if (!protocol) {
-        std::cerr << "Failed to load protocol from JSON" << std::endl;
+        CARDITY_LOG_ERROR("Failed to load protocol from JSON");
         return false;
     }
     
     if (!CarLoader::validate_protocol(*protocol)) {
-        std::cerr << "Invalid protocol format" << std::endl;
+        CARDITY_LOG_ERROR("Invalid protocol format");
         return false;
     }
     
@@ -61,12 +99,12 @@ bool CardityRuntime::load_protocol_from_json(const std::string& json_str) {
 bool CardityRuntime::load_protocol_from_base64(const std::string& base64_str) {
     protocol = CarLoader::load_from_base64(base64_str);
     if (!protocol) {
-        std::cerr << "Failed to load protocol from base64" << std::endl;
+        CARDITY_LOG_ERROR("Failed to load protocol from base64");
         return false;
     }
     
     if (!CarLoader::validate_protocol(*protocol)) {
-        std::cerr << "Invalid protocol format" << std::endl;
+        CARDITY_LOG_ERROR("Invalid protocol format");
         return false;
     }
     
@@ -75,7 +113,23 @@ bool CardityRuntime::load_protocol_from_base64(const std::string& base64_str) {
     return true;
 }
 
+void CardityRuntime::attach_protocol(std::shared_ptr<const CompiledProtocol> loaded) {
+    protocol = std::move(loaded);
+    
+    // 初始化状态
+    reset_state();
+}
+
 MethodResult CardityRuntime::call_method(const std::string& method_name, const std::vector<std::string>& args) {
+    return invoke_method(method_name, args, true);
+}
+
+MethodResult CardityRuntime::simulate_method(const std::string& method_name, const std::vector<std::string>& args) {
+    return invoke_method(method_name, args, false);
+}
+
+MethodResult CardityRuntime::invoke_method(const std::string& method_name, const std::vector<std::string>& args,
+                                           bool commit_changes) {
     MethodResult result;
     
     if (!protocol) {
@@ -91,32 +145,60 @@ MethodResult CardityRuntime::call_method(const std::string& method_name, const s
     
     const Method& method = method_it->second;
     
+    // 指标关闭时 method_metrics 为空，调用路径上没有计时和计数
+    MethodMetrics* method_metrics = metrics ? &metrics->method(method_name) : nullptr;
+    std::chrono::steady_clock::time_point started;
+    if (method_metrics) {
+        started = std::chrono::steady_clock::now();
+        ++method_metrics->calls;
+    }
+    
     // 验证参数数量
     if (args.size() != method.params.size()) {
         result.error_message = "Parameter count mismatch. Expected " + 
                               std::to_string(method.params.size()) + ", got " + 
                               std::to_string(args.size());
+        if (method_metrics) {
+            ++method_metrics->failures;
+        }
         return result;
     }
     
+    if (method_metrics) {
+        logic_engine->set_counters(&method_metrics->execution);
+    }
+    
+    // 每次调用是一个事务：失败时按撤销日志回滚，模拟调用始终回滚
+    state_manager->begin_transaction();
+    event_recorder->pending.clear();
+    logic_engine->start_metering(config.gas_limit);
+    
     try {
+        // 执行预编译逻辑（未经 CarLoader 加载的方法在此临时编译）
+        std::shared_ptr<const CompiledProgram> program = method.program;
+        if (!program) {
+            program = LogicEngine::compile_program(method.logic, method.returns);
+        }
+        
         // 设置参数
-        auto resolver = dynamic_cast<StateVariableResolver*>(logic_engine->get_resolver());
+        auto resolver = logic_engine->get_slot_resolver();
         if (resolver) {
-            for (size_t i = 0; i < method.params.size(); ++i) {
-                resolver->set_parameter(method.params[i], args[i]);
+            if (program->uses_slots) {
+                resolver->bind_arguments(args);
+            } else {
+                for (size_t i = 0; i < method.params.size(); ++i) {
+                    resolver->set_parameter(method.params[i], args[i]);
+                }
             }
         }
         
-        // 执行逻辑
         if (!method.logic.empty()) {
-            std::string logic_result = logic_engine->execute_method_logic(method.logic, args);
-            result.return_value = logic_result;
+            result.return_value = logic_engine->execute_program(*program);
         }
         
         // 处理返回值
-        if (!method.returns.empty()) {
-            result.return_value = process_return_value(method_name, method.returns);
+        if (program->returns) {
+            result.return_value = logic_engine->evaluate_returns(*program);
         }
         
         result.success = true;
@@ -124,6 +206,46 @@ MethodResult CardityRuntime::call_method(const std::string& method_name, const s
     } catch (const std::exception& e) {
         result.error_message = "Error executing method: " + std::string(e.what());
     }
+    result.gas_used = logic_engine->get_gas_used();
+    
+    if (result.success && commit_changes) {
+        state_manager->commit();
+    } else {
+        state_manager->rollback();
+    }
+    
+    // 事件随事务提交：同一调用的事件共用一个区块上下文
+    std::vector<EventInstance>& pending_events = event_recorder->pending;
+    if (!pending_events.empty()) {
+        if (result.success && config.enable_events) {
+            BlockContext block = current_block();
+            for (auto& event : pending_events) {
+                event.block = block;
+            }
+            if (commit_changes) {
+                result.events = pending_events;
+                for (auto& event : pending_events) {
+                    event_log.append(std::move(event));
+                }
+            } else {
+                result.events = std::move(pending_events);
+            }
+        }
+        event_recorder->pending.clear();
+    }
+    
+    if (method_metrics) {
+        logic_engine->set_counters(nullptr);
+        method_metrics->failures += result.success ? 0 : 1;
+        method_metrics->events += result.events.size();
+        method_metrics->gas += result.gas_used;
+        method_metrics->scratch_bytes += logic_engine->get_scratch().bytes_used();
+        method_metrics->latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count()));
+    }
+    
+    // 回收本次调用的临时表达式，内存块留给下一次调用
+    logic_engine->reset_scratch();
     
     return result;
 }
@@ -133,6 +255,62 @@ MethodResult CardityRuntime::call_method_with_json(const std::string& method_nam
     return call_method(method_name, string_args);
 }
 
+std::vector<MethodResult> CardityRuntime::call_methods_batch(const std::vector<MethodCall>& calls, bool stop_on_error) {
+    std::vector<MethodResult> results;
+    results.reserve(calls.size());
+    
+    for (const auto& call : calls) {
+        results.push_back(call_method(call.method, call.args));
+        if (stop_on_error && !results.back().success) {
+            break;
+        }
+    }
+    
+    return results;
+}
+
+std::vector<MethodResult> CardityRuntime::call_methods_batch_with_json(const json& calls, bool stop_on_error) {
+    std::vector<MethodResult> results;
+    if (!calls.is_array()) {
+        MethodResult result;
+        result.error_message = "Batch calls must be a JSON array";
+        results.push_back(result);
+        return results;
+    }
+    
+    results.reserve(calls.size());
+    for (const auto& call : calls) {
+        if (!call.is_object() || !call.contains("method") || !call["method"].is_string()) {
+            MethodResult result;
+            result.error_message = "Invalid batch call entry";
+            results.push_back(result);
+        } else {
+            static const json no_args = json::array();
+            const json& args = call.contains("args") ? call["args"] : no_args;
+            results.push_back(call_method_with_json(call["method"].get<std::string>(), args));
+        }
+        
+        if (stop_on_error && !results.back().success) {
+            break;
+        }
+    }
+    
+    return results;
+}
+
+void CardityRuntime::set_state_store(std::unique_ptr<StateStore> store) {
+    state_manager = std::make_unique<StateManager>(std::move(store));
+    state_view_version = UINT64_MAX;
+    logic_engine->set_resolver(std::make_unique<StateVariableResolver>(state_manager.get()));
+    
+    if (protocol) {
+        state_manager->bind_slots(protocol->cpl.state_slots);
+        if (state_manager->size() == 0) {
+            reset_state();
+        }
+    }
+}
+
 bool CardityRuntime::set_state(const std::string& key, const std::string& value) {
     if (!state_manager) {
         return false;
@@ -147,17 +325,44 @@ std::string CardityRuntime::get_state(const std::string& key, const std::string&
     return state_manager->get_string(key, default_value);
 }
 
+void CardityRuntime::refresh_state_view() const {
+    if (state_view_version == state_manager->get_write_version()) {
+        return;
+    }
+    
+    state_view = json::object();
+    state_manager->for_each([this](const std::string& key, const StateValue& value) {
+        state_view[key] = value.to_string();
+    });
+    state_view_version = state_manager->get_write_version();
+    state_view_serialized = false;
+}
+
 json CardityRuntime::get_all_state() const {
     if (!state_manager) {
         return json::object();
     }
-    
-    auto all_state = state_manager->get_all_strings();
-    json result = json::object();
-    for (const auto& [key, value] : all_state) {
-        result[key] = value;
+    refresh_state_view();
+    return state_view;
+}
+
+const std::string& CardityRuntime::get_all_state_json() const {
+    if (!state_manager) {
+        static const std::string empty_object = "{}";
+        return empty_object;
+    }
+    refresh_state_view();
+    if (!state_view_serialized) {
+        state_view_text = state_view.dump();
+        state_view_serialized = true;
+    }
+    return state_view_text;
+}
+
+void CardityRuntime::for_each_state(const StateVisitor& visitor) const {
+    if (state_manager) {
+        state_manager->for_each(visitor);
     }
-    return result;
 }
 
 void CardityRuntime::emit_event(const std::string& event_name, const std::vector<std::string>& values) {
@@ -165,20 +370,41 @@ void CardityRuntime::emit_event(const std::string& event_name, const std::vector
         return;
     }
     
-    EventInstance event;
-    event.name = event_name;
-    event.values = values;
-    event.timestamp = generate_timestamp();
-    
-    event_log.push_back(event);
+    EventInstance event(event_recorder->names.intern(event_name), values);
+    event.block = current_block();
+    event_log.append(std::move(event));
+}
+
+void CardityRuntime::emit_event(EventInstance event) {
+    if (!config.enable_events) {
+        return;
+    }
+    event_log.append(std::move(event));
 }
 
 std::vector<EventInstance> CardityRuntime::get_event_log() const {
-    return event_log;
+    return event_log.copy_since(0);
+}
+
+void CardityRuntime::for_each_event(const std::function<void(const EventInstance&)>& visitor) const {
+    event_log.for_each([&visitor](uint64_t, const EventInstance& event) { visitor(event); });
+}
+
+uint64_t CardityRuntime::for_each_event_since(uint64_t cursor, const EventVisitor& visitor, size_t limit) const {
+    return event_log.for_each_since(cursor, visitor, limit);
+}
+
+size_t CardityRuntime::subscribe_events(EventVisitor subscriber) {
+    return event_log.subscribe(std::move(subscriber));
+}
+
+bool CardityRuntime::unsubscribe_events(size_t id) {
+    return event_log.unsubscribe(id);
 }
 
 void CardityRuntime::clear_event_log() {
     event_log.clear();
+    snapshot_event_cursor = event_log.next_sequence();
 }
 
 Snapshot CardityRuntime::create_snapshot(const std::string& block_height) const {
@@ -190,101 +416,248 @@ Snapshot CardityRuntime::create_snapshot(const std::string& block_height) const
     }
     
     snapshot.state = get_all_state();
-    snapshot.event_log = event_log;
-    snapshot.timestamp = generate_timestamp();
+    snapshot.event_log = event_log.copy_since(0);
+    snapshot.event_sequence = event_log.first_sequence();
+    snapshot.block = current_block();
     snapshot.block_height = block_height;
     
     return snapshot;
 }
 
 bool CardityRuntime::restore_from_snapshot(const Snapshot& snapshot) {
+    if (snapshot.is_delta && (!has_snapshot_base || snapshot.base_block_height != last_snapshot_height)) {
+        CARDITY_LOG_ERROR("Delta snapshot at block " << snapshot.block_height << " expects base "
+                          << snapshot.base_block_height << ", current base is "
+                          << (has_snapshot_base ? last_snapshot_height : std::string("<none>")));
+        return false;
+    }
+    
     try {
-        // 恢复状态
+        // 恢复状态（已声明的状态变量按声明类型解析）
         if (state_manager) {
             for (const auto& [key, value] : snapshot.state.items()) {
-                state_manager->set(key, value.get<std::string>());
+                const std::string text = value.get<std::string>();
+                const StateVariable* var = nullptr;
+                if (protocol) {
+                    auto var_it = protocol->cpl.state.find(key);
+                    if (var_it != protocol->cpl.state.end()) {
+                        var = &var_it->second;
+                    }
+                }
+                if (var) {
+                    state_manager->set_value(key, StateValue::parse(text, value_type_from_name(var->type)));
+                } else {
+                    state_manager->set(key, text);
+                }
+            }
+            for (const auto& key : snapshot.removed_keys) {
+                state_manager->remove(key);
             }
         }
         
-        // 恢复事件日志
-        event_log = snapshot.event_log;
+        // 恢复事件日志（不通知订阅者）：增量快照只包含新增事件
+        std::vector<EventInstance> events = snapshot.event_log;
+        for (auto& event : events) {
+            event.interned_name = event_recorder->names.intern(event.name());
+        }
+        event_log.restore(std::move(events), !snapshot.is_delta, snapshot.event_sequence);
+        if (snapshot.is_delta) {
+            ++deltas_since_full;
+        } else {
+            deltas_since_full = 0;
+        }
         
+        mark_snapshot_base(snapshot.block_height);
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error restoring from snapshot: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error restoring from snapshot: " << e.what());
+        return false;
+    }
+}
+
+Snapshot CardityRuntime::create_delta_snapshot(const std::string& block_height) {
+    bool full = !has_snapshot_base || !state_manager || state_manager->is_fully_dirty() ||
+                config.full_snapshot_interval == 0 || deltas_since_full >= config.full_snapshot_interval;
+    
+    if (full) {
+        Snapshot snapshot = create_snapshot(block_height);
+        deltas_since_full = 0;
+        mark_snapshot_base(block_height);
+        return snapshot;
+    }
+    
+    Snapshot snapshot;
+    if (protocol) {
+        snapshot.protocol_name = protocol->protocol;
+        snapshot.version = protocol->version;
+    }
+    
+    snapshot.is_delta = true;
+    snapshot.base_block_height = last_snapshot_height;
+    snapshot.block_height = block_height;
+    snapshot.block = current_block();
+    
+    // 只序列化变更过的键
+    snapshot.state = json::object();
+    for (const auto& key : state_manager->get_dirty_keys()) {
+        if (state_manager->has(key)) {
+            snapshot.state[key] = state_manager->get_string(key);
+        } else {
+            snapshot.removed_keys.push_back(key);
+        }
+    }
+    
+    if (event_log.first_sequence() > snapshot_event_cursor) {
+        CARDITY_LOG_WARN("Event log capacity exceeded since block " << last_snapshot_height << ": "
+                         << (event_log.first_sequence() - snapshot_event_cursor)
+                         << " events are missing from the delta snapshot");
+    }
+    snapshot.event_log = event_log.copy_since(snapshot_event_cursor);
+    snapshot.event_sequence = std::max(snapshot_event_cursor, event_log.first_sequence());
+    
+    ++deltas_since_full;
+    mark_snapshot_base(block_height);
+    return snapshot;
+}
+
+bool CardityRuntime::restore_from_snapshot_chain(const std::vector<Snapshot>& chain) {
+    if (chain.empty()) {
+        return false;
+    }
+    
+    if (chain.front().is_delta) {
+        CARDITY_LOG_ERROR("Snapshot chain must start with a full snapshot");
         return false;
     }
+    
+    // 基线快照包含完整状态，先清空现有状态（保留槽位绑定）
+    if (state_manager) {
+        state_manager->clear();
+    }
+    
+    for (const auto& snapshot : chain) {
+        if (!restore_from_snapshot(snapshot)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CardityRuntime::mark_snapshot_base(const std::string& block_height) {
+    has_snapshot_base = true;
+    last_snapshot_height = block_height;
+    snapshot_event_cursor = event_log.next_sequence();
+    if (state_manager) {
+        state_manager->clear_dirty();
+    }
+}
+
+json CardityRuntime::event_to_json(const EventInstance& event) {
+    json event_json;
+    event_json["name"] = event.name();
+    event_json["values"] = event.values;
+    event_json["timestamp"] = format_timestamp(event.block.time);
+    event_json["block"] = block_to_json(event.block);
+    return event_json;
+}
+
+json CardityRuntime::method_result_to_json(const MethodResult& result) {
+    json response;
+    response["success"] = result.success;
+    response["return_value"] = result.return_value;
+    response["error_message"] = result.error_message;
+    response["gas_used"] = result.gas_used;
+    if (!result.events.empty()) {
+        json& events = response["events"] = json::array();
+        for (const auto& event : result.events) {
+            events.push_back(event_to_json(event));
+        }
+    }
+    return response;
+}
+
+json CardityRuntime::snapshot_to_json(const Snapshot& snapshot) {
+    json snapshot_json;
+    snapshot_json["protocol_name"] = snapshot.protocol_name;
+    snapshot_json["version"] = snapshot.version;
+    snapshot_json["state"] = snapshot.state;
+    snapshot_json["timestamp"] = format_timestamp(snapshot.block.time);
+    snapshot_json["block"] = block_to_json(snapshot.block);
+    snapshot_json["block_height"] = snapshot.block_height;
+    
+    if (snapshot.is_delta) {
+        snapshot_json["is_delta"] = true;
+        snapshot_json["base_block_height"] = snapshot.base_block_height;
+        snapshot_json["removed_keys"] = snapshot.removed_keys;
+    }
+    
+    // 序列化事件日志
+    json events_array = json::array();
+    for (const auto& event : snapshot.event_log) {
+        events_array.push_back(event_to_json(event));
+    }
+    snapshot_json["event_log"] = events_array;
+    snapshot_json["event_sequence"] = snapshot.event_sequence;
+    
+    return snapshot_json;
+}
+
+Snapshot CardityRuntime::snapshot_from_json(const json& snapshot_json) {
+    Snapshot snapshot;
+    snapshot.protocol_name = snapshot_json.value("protocol_name", "");
+    snapshot.version = snapshot_json.value("version", "");
+    snapshot.state = snapshot_json.value("state", json::object());
+    snapshot.block = block_from_json(snapshot_json);
+    snapshot.block_height = snapshot_json.value("block_height", "");
+    snapshot.is_delta = snapshot_json.value("is_delta", false);
+    snapshot.base_block_height = snapshot_json.value("base_block_height", "");
+    if (snapshot_json.contains("removed_keys")) {
+        snapshot.removed_keys = snapshot_json["removed_keys"].get<std::vector<std::string>>();
+    }
+    
+    // 反序列化事件日志
+    if (snapshot_json.contains("event_log")) {
+        for (const auto& event_json : snapshot_json["event_log"]) {
+            EventInstance event(event_json["name"].get<std::string>(),
+                                event_json["values"].get<std::vector<std::string>>());
+            event.block = block_from_json(event_json);
+            snapshot.event_log.push_back(std::move(event));
+        }
+    }
+    snapshot.event_sequence = snapshot_json.value("event_sequence", uint64_t(0));
+    
+    return snapshot;
 }
 
 bool CardityRuntime::save_snapshot_to_file(const std::string& file_path) const {
     try {
-        Snapshot snapshot = create_snapshot();
-        json snapshot_json;
-        snapshot_json["protocol_name"] = snapshot.protocol_name;
-        snapshot_json["version"] = snapshot.version;
-        snapshot_json["state"] = snapshot.state;
-        snapshot_json["timestamp"] = snapshot.timestamp;
-        snapshot_json["block_height"] = snapshot.block_height;
-        
-        // 序列化事件日志
-        json events_array = json::array();
-        for (const auto& event : snapshot.event_log) {
-            json event_json;
-            event_json["name"] = event.name;
-            event_json["values"] = event.values;
-            event_json["timestamp"] = event.timestamp;
-            events_array.push_back(event_json);
-        }
-        snapshot_json["event_log"] = events_array;
+        json snapshot_json = snapshot_to_json(create_snapshot());
         
         std::ofstream file(file_path);
         if (!file.is_open()) {
-            std::cerr << "Failed to open file for writing: " << file_path << std::endl;
+            CARDITY_LOG_ERROR("Failed to open file for writing: " << file_path);
             return false;
         }
         
-        file << snapshot_json.dump(2);
+        file << snapshot_json.dump();
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error saving snapshot: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error saving snapshot: " << e.what());
         return false;
     }
 }
 
 bool CardityRuntime::load_snapshot_from_file(const std::string& file_path) {
     try {
-        std::ifstream file(file_path);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file: " << file_path << std::endl;
+        SourceBuffer source;
+        if (!source.open(file_path)) {
             return false;
         }
         
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        
-        json snapshot_json = json::parse(buffer.str());
-        
-        Snapshot snapshot;
-        snapshot.protocol_name = snapshot_json.value("protocol_name", "");
-        snapshot.version = snapshot_json.value("version", "");
-        snapshot.state = snapshot_json["state"];
-        snapshot.timestamp = snapshot_json.value("timestamp", "");
-        snapshot.block_height = snapshot_json.value("block_height", "");
-        
-        // 反序列化事件日志
-        if (snapshot_json.contains("event_log")) {
-            for (const auto& event_json : snapshot_json["event_log"]) {
-                EventInstance event;
-                event.name = event_json["name"].get<std::string>();
-                event.values = event_json["values"].get<std::vector<std::string>>();
-                event.timestamp = event_json["timestamp"].get<std::string>();
-                snapshot.event_log.push_back(event);
-            }
-        }
-        
-        return restore_from_snapshot(snapshot);
+        std::string_view text = source.data();
+        return restore_from_snapshot(snapshot_from_json(json::parse(text.begin(), text.end())));
     } catch (const std::exception& e) {
-        std::cerr << "Error loading snapshot: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error loading snapshot: " << e.what());
         return false;
     }
 }
@@ -335,7 +708,15 @@ json CardityRuntime::get_abi() const {
     if (!protocol) {
         return json::object();
     }
-    return protocol->abi;
+    return protocol->abi();
+}
+
+const std::string& CardityRuntime::get_abi_json() const {
+    if (!protocol) {
+        static const std::string empty_object = "{}";
+        return empty_object;
+    }
+    return protocol->abi_json();
 }
 
 std::vector<std::string> CardityRuntime::get_method_names() const {
@@ -360,6 +741,13 @@ std::vector<std::string> CardityRuntime::get_state_variables() const {
 
 void CardityRuntime::set_config(const RuntimeConfig& cfg) {
     config = cfg;
+    set_log_level(config.log_level);
+    event_log.set_capacity(config.event_log_capacity);
+    if (!config.enable_metrics) {
+        metrics.reset();
+    } else if (!metrics) {
+        metrics = std::make_unique<RuntimeMetrics>();
+    }
 }
 
 RuntimeConfig CardityRuntime::get_config() const {
@@ -377,12 +765,13 @@ void CardityRuntime::reset_state() {
         return;
     }
     
-    // 清空当前状态
+    // 清空当前状态并绑定状态变量槽位
     state_manager->clear();
+    state_manager->bind_slots(protocol->cpl.state_slots);
     
     // 初始化默认状态
     for (const auto& [name, var] : protocol->cpl.state) {
-        state_manager->set(name, var.default_value);
+        state_manager->set_value(name, StateValue::parse(var.default_value, value_type_from_name(var.type)));
     }
 }
 
@@ -437,6 +826,9 @@ std::string CardityRuntime::execute_method_logic(const std::string& method_name,
         return "";
     }
     
+    if (method_it->second.program) {
+        return logic_engine->execute_program(*method_it->second.program);
+    }
     return logic_engine->execute_method_logic(method_it->second.logic, args);
 }
 
@@ -449,103 +841,234 @@ std::string CardityRuntime::process_return_value(const std::string& method_name,
     return logic_engine->evaluate_expression(return_expr);
 }
 
-std::string CardityRuntime::generate_timestamp() const {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+json CardityRuntime::get_metrics() const {
+    json result = metrics ? metrics->to_json() : json::object();
+    result["enabled"] = metrics != nullptr;
+    
+    json& events = result["events"];
+    events["retained"] = event_log.size();
+    events["dropped"] = event_log.dropped();
+    events["next_sequence"] = event_log.next_sequence();
     
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+    if (protocol) {
+        const LoadTimings& timings = protocol->load_timings;
+        json& load = result["protocol_load"];
+        load["bytes"] = timings.bytes;
+        load["read_ms"] = timings.read_ms;
+        load["parse_ms"] = timings.parse_ms;
+        load["compile_ms"] = timings.compile_ms;
+        load["streamed"] = timings.streamed;
+    }
+    return result;
+}
+
+void CardityRuntime::reset_metrics() {
+    if (metrics) {
+        metrics->clear();
+    }
+}
+
+BlockContext CardityRuntime::current_block() const {
+    return config.clock ? config.clock->now() : SystemClock::instance().now();
 }
 
 // WASM 导出接口实现
 #ifdef __EMSCRIPTEN__
+namespace {
+
+// WASM 运行时句柄：运行时实例及其可复用的结果缓冲区
+struct WasmRuntimeHandle {
+    CardityRuntime runtime;
+    std::string result;     // 最近一次导出调用的结果，下次调用同一句柄前有效
+    const std::string* shared = nullptr;    // 非空时最近的结果是运行时自己的缓存，不经过 result
+};
+
+CardityRuntime* runtime_of(void* runtime) {
+    return &static_cast<WasmRuntimeHandle*>(runtime)->runtime;
+}
+
+// 写入句柄的结果缓冲区并返回其指针（复用已分配的容量）
+const char* store_result(void* runtime, const std::string& value) {
+    auto* handle = static_cast<WasmRuntimeHandle*>(runtime);
+    handle->shared = nullptr;
+    handle->result.assign(value);
+    return handle->result.c_str();
+}
+
+// 直接返回运行时缓存的文本（ABI、状态视图），不复制；在下一次写入状态之前有效
+const char* share_result(void* runtime, const std::string& cached) {
+    auto* handle = static_cast<WasmRuntimeHandle*>(runtime);
+    handle->shared = &cached;
+    return cached.c_str();
+}
+
+// 以 CBOR 写入句柄的结果缓冲区（二进制安全，长度通过 get_result_length 获取）
+const uint8_t* store_cbor_result(void* runtime, const json& value) {
+    auto* handle = static_cast<WasmRuntimeHandle*>(runtime);
+    handle->shared = nullptr;
+    handle->result.clear();
+    json::to_cbor(value, handle->result);
+    return reinterpret_cast<const uint8_t*>(handle->result.data());
+}
+
+json error_response(const std::string& message) {
+    json response;
+    response["success"] = false;
+    response["return_value"] = "";
+    response["error_message"] = message;
+    return response;
+}
+
+json events_to_json(const CardityRuntime& runtime) {
+    json events_json = json::array();
+    runtime.for_each_event([&events_json](const EventInstance& event) {
+        events_json.push_back(CardityRuntime::event_to_json(event));
+    });
+    return events_json;
+}
+
+} // namespace
+
 extern "C" {
     void* create_runtime() {
-        return new CardityRuntime();
+        return new WasmRuntimeHandle();
     }
     
     void destroy_runtime(void* runtime) {
-        delete static_cast<CardityRuntime*>(runtime);
+        delete static_cast<WasmRuntimeHandle*>(runtime);
     }
     
     bool load_protocol(void* runtime, const char* car_data) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        return rt->load_protocol_from_json(car_data);
+        // 经全局注册表加载：同一协议的多个句柄共享一份已编译协议
+        auto shared = ProtocolRegistry::global().load_from_json(car_data);
+        if (!shared) {
+            return false;
+        }
+        runtime_of(runtime)->attach_protocol(std::move(shared));
+        return true;
+    }
+    
+    bool load_protocol_base64(void* runtime, const char* car_base64) {
+        // 链上 base64 铭文直接在 WASM 内解码，无需先在 JS 中解码再复制
+        auto shared = ProtocolRegistry::global().load_from_base64(car_base64);
+        if (!shared) {
+            return false;
+        }
+        runtime_of(runtime)->attach_protocol(std::move(shared));
+        return true;
+    }
+    
+    size_t prune_protocols() {
+        return ProtocolRegistry::global().prune();
     }
     
     const char* call_method(void* runtime, const char* method_name, const char* args_json) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
         json args = json::parse(args_json);
-        MethodResult result = rt->call_method_with_json(method_name, args);
+        MethodResult result = runtime_of(runtime)->call_method_with_json(method_name, args);
+        return store_result(runtime, CardityRuntime::method_result_to_json(result).dump());
+    }
+    
+    const char* call_batch(void* runtime, const char* calls_json, bool stop_on_error) {
+        json calls = json::parse(calls_json);
+        std::vector<MethodResult> results = runtime_of(runtime)->call_methods_batch_with_json(calls, stop_on_error);
         
-        json response;
-        response["success"] = result.success;
-        response["return_value"] = result.return_value;
-        response["error_message"] = result.error_message;
+        json response = json::array();
+        for (const auto& result : results) {
+            response.push_back(CardityRuntime::method_result_to_json(result));
+        }
+        return store_result(runtime, response.dump());
+    }
+    
+    const uint8_t* call_method_cbor(void* runtime, const uint8_t* data, size_t length) {
+        json call = json::from_cbor(data, data + length, true, false);
+        if (call.is_discarded() || !call.is_object() || !call.contains("method") || !call["method"].is_string()) {
+            return store_cbor_result(runtime, error_response("Invalid CBOR call"));
+        }
+        
+        static const json no_args = json::array();
+        const json& args = call.contains("args") ? call["args"] : no_args;
+        MethodResult result = runtime_of(runtime)->call_method_with_json(call["method"].get<std::string>(), args);
+        return store_cbor_result(runtime, CardityRuntime::method_result_to_json(result));
+    }
+    
+    const uint8_t* call_batch_cbor(void* runtime, const uint8_t* data, size_t length, bool stop_on_error) {
+        json calls = json::from_cbor(data, data + length, true, false);
+        if (calls.is_discarded()) {
+            return store_cbor_result(runtime, json::array({error_response("Invalid CBOR batch")}));
+        }
         
-        std::string* response_str = new std::string(response.dump());
-        return response_str->c_str();
+        std::vector<MethodResult> results = runtime_of(runtime)->call_methods_batch_with_json(calls, stop_on_error);
+        json response = json::array();
+        for (const auto& result : results) {
+            response.push_back(CardityRuntime::method_result_to_json(result));
+        }
+        return store_cbor_result(runtime, response);
     }
     
     const char* get_state(void* runtime, const char* key) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        std::string* value = new std::string(rt->get_state(key));
-        return value->c_str();
+        return store_result(runtime, runtime_of(runtime)->get_state(key));
     }
     
     bool set_state(void* runtime, const char* key, const char* value) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        return rt->set_state(key, value);
+        return runtime_of(runtime)->set_state(key, value);
     }
     
     const char* get_event_log(void* runtime) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        auto events = rt->get_event_log();
-        
-        json events_json = json::array();
-        for (const auto& event : events) {
-            json event_json;
-            event_json["name"] = event.name;
-            event_json["values"] = event.values;
-            event_json["timestamp"] = event.timestamp;
-            events_json.push_back(event_json);
-        }
-        
-        std::string* events_str = new std::string(events_json.dump());
-        return events_str->c_str();
+        return store_result(runtime, events_to_json(*runtime_of(runtime)).dump());
+    }
+    
+    const char* get_metrics(void* runtime) {
+        return store_result(runtime, runtime_of(runtime)->get_metrics().dump());
+    }
+    
+    void set_metrics_enabled(void* runtime, bool enabled) {
+        RuntimeConfig config = runtime_of(runtime)->get_config();
+        config.enable_metrics = enabled;
+        runtime_of(runtime)->set_config(config);
+    }
+    
+    void set_gas_limit(void* runtime, size_t limit) {
+        RuntimeConfig config = runtime_of(runtime)->get_config();
+        config.gas_limit = limit;
+        runtime_of(runtime)->set_config(config);
+    }
+    
+    const char* get_events_since(void* runtime, size_t cursor, size_t limit) {
+        json response;
+        json& events = response["events"] = json::array();
+        response["next"] = runtime_of(runtime)->for_each_event_since(
+            cursor, [&events](uint64_t, const EventInstance& event) { events.push_back(CardityRuntime::event_to_json(event)); },
+            limit);
+        return store_result(runtime, response.dump());
     }
     
     const char* create_snapshot(void* runtime) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        Snapshot snapshot = rt->create_snapshot();
-        
-        json snapshot_json;
-        snapshot_json["protocol_name"] = snapshot.protocol_name;
-        snapshot_json["version"] = snapshot.version;
-        snapshot_json["state"] = snapshot.state;
-        snapshot_json["timestamp"] = snapshot.timestamp;
-        snapshot_json["block_height"] = snapshot.block_height;
-        
-        json events_array = json::array();
-        for (const auto& event : snapshot.event_log) {
-            json event_json;
-            event_json["name"] = event.name;
-            event_json["values"] = event.values;
-            event_json["timestamp"] = event.timestamp;
-            events_array.push_back(event_json);
-        }
-        snapshot_json["event_log"] = events_array;
-        
-        std::string* snapshot_str = new std::string(snapshot_json.dump());
-        return snapshot_str->c_str();
+        Snapshot snapshot = runtime_of(runtime)->create_snapshot();
+        return store_result(runtime, CardityRuntime::snapshot_to_json(snapshot).dump());
+    }
+    
+    const char* create_delta_snapshot(void* runtime, const char* block_height) {
+        Snapshot snapshot = runtime_of(runtime)->create_delta_snapshot(block_height);
+        return store_result(runtime, CardityRuntime::snapshot_to_json(snapshot).dump());
     }
     
     const char* get_abi(void* runtime) {
-        auto* rt = static_cast<CardityRuntime*>(runtime);
-        json abi = rt->get_abi();
-        std::string* abi_str = new std::string(abi.dump());
-        return abi_str->c_str();
+        return share_result(runtime, runtime_of(runtime)->get_abi_json());
+    }
+    
+    const char* get_all_state(void* runtime) {
+        return share_result(runtime, runtime_of(runtime)->get_all_state_json());
+    }
+    
+    size_t get_result_length(void* runtime) {
+        auto* handle = static_cast<WasmRuntimeHandle*>(runtime);
+        return handle->shared ? handle->shared->size() : handle->result.size();
+    }
+    
+    void free_result(void* runtime) {
+        auto* handle = static_cast<WasmRuntimeHandle*>(runtime);
+        handle->shared = nullptr;
+        std::string().swap(handle->result);
     }
 }
 #endif
@@ -8,43 +8,51 @@
 #include "car_loader.h"
 #include "state_store.h"
 #include "logic_engine.h"
+#include "event_log.h"
+#include "metrics.h"
+#include "log.h"
 
 namespace cardity {
 
 using json = nlohmann::json;
 
-// 事件实例
-struct EventInstance {
-    std::string name;
-    std::vector<std::string> values;
-    std::string timestamp;
-    
-    EventInstance() = default;
-    EventInstance(const std::string& n, const std::vector<std::string>& v)
-        : name(n), values(v) {}
-};
-
 // 方法调用结果
 struct MethodResult {
     bool success;
     std::string return_value;
-    std::vector<EventInstance> events;
+    std::vector<EventInstance> events;      // 本次调用 emit 的事件（失败的调用为空）
     std::string error_message;
+    uint64_t gas_used;                      // 本次调用收取的 gas（耗尽时等于 RuntimeConfig::gas_limit）
+    
+    MethodResult() : success(false), gas_used(0) {}
+    MethodResult(bool s, const std::string& ret) : success(s), return_value(ret), gas_used(0) {}
+};
+
+// 方法调用请求（批量调用使用）
+struct MethodCall {
+    std::string method;
+    std::vector<std::string> args;
     
-    MethodResult() : success(false) {}
-    MethodResult(bool s, const std::string& ret) : success(s), return_value(ret) {}
+    MethodCall() = default;
+    MethodCall(const std::string& m, const std::vector<std::string>& a) : method(m), args(a) {}
 };
 
 // 快照信息
+// 增量快照（is_delta）只包含 base_block_height 之后变更的键和新增的事件，
+// 需要从最近的完整快照开始按顺序恢复
 struct Snapshot {
     std::string protocol_name;
     std::string version;
     json state;
     std::vector<EventInstance> event_log;
-    std::string timestamp;
-    std::string block_height;
+    uint64_t event_sequence;                // event_log 第一个事件的序号
+    BlockContext block;                     // 创建快照时的区块上下文
+    std::string block_height;               // 快照标识（调用方提供，增量快照链按它衔接）
+    bool is_delta;
+    std::string base_block_height;
+    std::vector<std::string> removed_keys;
     
-    Snapshot() = default;
+    Snapshot() : event_sequence(0), is_delta(false) {}
 };
 
 // 运行时配置
@@ -54,22 +62,60 @@ struct RuntimeConfig {
     bool enable_persistence;
     std::string snapshot_interval;
     std::string storage_path;
+    LogLevel log_level;         // 运行时日志级别（进程范围，受 CARDITY_LOG_MAX_LEVEL 编译期上限约束）
+    size_t full_snapshot_interval;  // 每隔多少个增量快照生成一次完整基线（0 表示总是完整快照）
+    size_t event_log_capacity;      // 事件日志保留的事件数（0 表示不限），超出后覆盖最旧的事件
+    std::shared_ptr<const BlockClock> clock;    // 事件和快照的区块上下文来源，为空时使用系统时钟
+    bool enable_metrics;            // 记录每个方法的调用指标（关闭时调用路径上只有一次指针判断）
+    uint64_t gas_limit;             // 每次调用的 gas 预算（0 表示不限），耗尽时调用失败并回滚
     
     RuntimeConfig() : enable_events(true), enable_snapshots(true), 
-                     enable_persistence(true), snapshot_interval("7d") {}
+                     enable_persistence(true), snapshot_interval("7d"),
+                     log_level(LogLevel::WARN), full_snapshot_interval(64),
+                     event_log_capacity(65536), enable_metrics(false), gas_limit(0) {}
 };
 
 // 主运行时类
+// 线程安全：不同实例可以在不同线程上同时使用（共享的 CompiledProtocol 只读）；
+// 同一实例不加锁，调用必须串行（RuntimeExecutor 按实例串行调度）。
+// 日志级别是进程范围的原子变量，RuntimeConfig::log_level 会影响所有实例。
+// 事件：方法中 emit 的事件先暂存，调用提交时写入有界的事件日志并通知订阅者，
+// 失败或模拟的调用不写入日志（模拟调用的 MethodResult::events 仍包含将要发出的事件）。
 class CardityRuntime {
 private:
-    std::unique_ptr<CarProtocol> protocol;
+    std::shared_ptr<const CompiledProtocol> protocol;    // 只读，可由多个实例共享
     std::unique_ptr<StateManager> state_manager;
     std::unique_ptr<LogicEngine> logic_engine;
-    std::unique_ptr<StateVariableResolver> variable_resolver;
     
-    std::vector<EventInstance> event_log;
+    // 逻辑引擎的事件接收器：暂存当前调用 emit 的事件（单独分配，实例移动后引擎持有的指针仍有效）
+    struct EventRecorder : EventSink {
+        EventNameTable names;
+        std::vector<EventInstance> pending;
+        
+        void emit(std::string_view name, std::vector<std::string>&& values) override {
+            pending.emplace_back(names.intern(name), std::move(values));
+        }
+    };
+    
+    EventLog event_log;
+    std::unique_ptr<EventRecorder> event_recorder;
+    std::unique_ptr<RuntimeMetrics> metrics;    // 仅在 enable_metrics 时分配
     RuntimeConfig config;
     
+    // 增量快照链的位置
+    bool has_snapshot_base;
+    std::string last_snapshot_height;
+    size_t deltas_since_full;
+    uint64_t snapshot_event_cursor;     // 上一个快照时的下一个事件序号
+    
+    // 缓存的全部状态视图：StateManager 的写入版本不变时直接返回，轮询不重复构建和序列化
+    mutable json state_view;
+    mutable std::string state_view_text;
+    mutable uint64_t state_view_version;    // 缓存对应的写入版本，UINT64_MAX 表示无效
+    mutable bool state_view_serialized;
+    
+    void refresh_state_view() const;
+    
 public:
     CardityRuntime();
     explicit CardityRuntime(const RuntimeConfig& cfg);
@@ -79,26 +125,75 @@ public:
     bool load_protocol_from_json(const std::string& json_str);
     bool load_protocol_from_base64(const std::string& base64_str);
     
+    // 使用已加载的协议（不做格式验证，由调用方负责）
+    // 传入 ProtocolRegistry 返回的共享协议时，实例只持有自己的状态和事件，不再复制协议
+    void attach_protocol(std::shared_ptr<const CompiledProtocol> loaded);
+    
     // 执行方法
     MethodResult call_method(const std::string& method_name, const std::vector<std::string>& args);
     MethodResult call_method_with_json(const std::string& method_name, const json& args);
     
+    // 模拟执行：返回结果但回滚所有状态修改
+    MethodResult simulate_method(const std::string& method_name, const std::vector<std::string>& args);
+    
+    // 批量执行方法，按顺序返回每个调用的结果；stop_on_error 时在第一个失败处停止
+    std::vector<MethodResult> call_methods_batch(const std::vector<MethodCall>& calls, bool stop_on_error = false);
+    
+    // 批量执行 JSON 调用列表：[{"method": "...", "args": [...] 或 {...}}, ...]
+    std::vector<MethodResult> call_methods_batch_with_json(const json& calls, bool stop_on_error = false);
+    
+    // 替换状态存储后端（例如 WalStateStore）；应在加载协议之后调用，
+    // 存储为空时写入协议声明的默认值，否则保留存储中的状态
+    void set_state_store(std::unique_ptr<StateStore> store);
+    
     // 状态管理
     bool set_state(const std::string& key, const std::string& value);
     std::string get_state(const std::string& key, const std::string& default_value = "") const;
     json get_all_state() const;
     
+    // 全部状态的序列化 JSON（自上次读取后没有写入时返回缓存，引用在下一次写入状态前有效）
+    const std::string& get_all_state_json() const;
+    
+    // 遍历状态（不复制整个状态）
+    void for_each_state(const StateVisitor& visitor) const;
+    
     // 事件管理
     void emit_event(const std::string& event_name, const std::vector<std::string>& values);
-    std::vector<EventInstance> get_event_log() const;
+    void emit_event(EventInstance event);       // 记录已构造的事件（保留其区块上下文）
+    std::vector<EventInstance> get_event_log() const;   // 复制日志中保留的全部事件
+    void for_each_event(const std::function<void(const EventInstance&)>& visitor) const;
     void clear_event_log();
     
+    // 增量读取：从 cursor（序号）开始遍历最多 limit 个事件（0 表示不限），返回下一次读取的 cursor
+    uint64_t for_each_event_since(uint64_t cursor, const EventVisitor& visitor, size_t limit = 0) const;
+    
+    // 订阅提交的事件：回调在事件写入日志时同步调用，返回订阅编号
+    size_t subscribe_events(EventVisitor subscriber);
+    bool unsubscribe_events(size_t id);
+    
+    const EventLog& get_event_stream() const { return event_log; }
+    
     // 快照管理
     Snapshot create_snapshot(const std::string& block_height = "") const;
     bool restore_from_snapshot(const Snapshot& snapshot);
     bool save_snapshot_to_file(const std::string& file_path) const;
     bool load_snapshot_from_file(const std::string& file_path);
     
+    // 增量快照：只记录自上一个快照以来变更的键，按配置周期性生成完整基线；
+    // 代价与变更量成正比，而不是与状态总量成正比
+    Snapshot create_delta_snapshot(const std::string& block_height);
+    
+    // 从完整快照开始依次应用增量快照
+    bool restore_from_snapshot_chain(const std::vector<Snapshot>& chain);
+    
+    // 快照序列化
+    static json snapshot_to_json(const Snapshot& snapshot);
+    static Snapshot snapshot_from_json(const json& snapshot_json);
+    
+    // 事件和调用结果的 JSON 形式（WASM 导出和命令服务共用）
+    static json event_to_json(const EventInstance& event);
+    static json method_result_to_json(const MethodResult& result);
+    
     // 持久化
     bool save_state_to_file(const std::string& file_path) const;
     bool load_state_from_file(const std::string& file_path);
@@ -111,6 +206,9 @@ public:
     std::string get_protocol_name() const;
     std::string get_protocol_version() const;
     json get_abi() const;
+    
+    // 序列化的 ABI（首次访问时生成，之后返回协议缓存的文本）
+    const std::string& get_abi_json() const;
     std::vector<std::string> get_method_names() const;
     std::vector<std::string> get_state_variables() const;
     
@@ -118,12 +216,23 @@ public:
     void set_config(const RuntimeConfig& cfg);
     RuntimeConfig get_config() const;
     
+    // 当前区块上下文（来自 RuntimeConfig::clock）
+    BlockContext current_block() const;
+    
+    // 调用指标：{"enabled", "calls", "methods": {name: {calls, failures, statements, state_reads,
+    // state_writes, events, scratch_bytes, latency}}, "events": {...}, "protocol_load": {...}}
+    json get_metrics() const;
+    void reset_metrics();
+    const RuntimeMetrics* get_runtime_metrics() const { return metrics.get(); }
+    RuntimeMetrics* get_runtime_metrics() { return metrics.get(); }
+    
     // 重置
     void reset();
     void reset_state();
     
     // 获取内部组件
     const CarProtocol* get_protocol() const { return protocol.get(); }
+    std::shared_ptr<const CompiledProtocol> get_shared_protocol() const { return protocol; }
     StateManager* get_state_manager() { return state_manager.get(); }
     const StateManager* get_state_manager() const { return state_manager.get(); }
     LogicEngine* get_logic_engine() { return logic_engine.get(); }
@@ -133,6 +242,10 @@ private:
     // 初始化运行时
     void initialize_runtime();
     
+    // 在事务中执行方法，commit_changes 为 false 时总是回滚
+    MethodResult invoke_method(const std::string& method_name, const std::vector<std::string>& args,
+                               bool commit_changes);
+    
     // 解析方法参数
     std::vector<std::string> parse_method_args(const std::string& method_name, const json& args);
     
@@ -142,11 +255,14 @@ private:
     // 处理返回值
     std::string process_return_value(const std::string& method_name, const std::string& logic_result);
     
-    // 生成时间戳
-    std::string generate_timestamp() const;
+    
+    // 以当前状态作为增量快照链的新起点
+    void mark_snapshot_base(const std::string& block_height);
 };
 
 // WASM 导出接口
+// 返回 const char* 的接口写入运行时句柄自带的结果缓冲区：
+// 结果在同一句柄的下一次调用前有效，调用方无需释放
 #ifdef __EMSCRIPTEN__
 extern "C" {
     // 创建运行时实例
@@ -155,12 +271,27 @@ extern "C" {
     // 销毁运行时实例
     void destroy_runtime(void* runtime);
     
-    // 加载协议
+    // 加载协议（经全局协议注册表，相同协议的实例共享编译结果）
     bool load_protocol(void* runtime, const char* car_data);
     
+    // 加载 base64 编码的协议（同样经全局协议注册表）
+    bool load_protocol_base64(void* runtime, const char* car_base64);
+    
+    // 释放已没有实例使用的共享协议，返回释放的数量
+    size_t prune_protocols();
+    
     // 调用方法
     const char* call_method(void* runtime, const char* method_name, const char* args_json);
     
+    // 批量调用方法
+    const char* call_batch(void* runtime, const char* calls_json, bool stop_on_error);
+    
+    // CBOR 编码的调用：输入 {"method": ..., "args": [...]}，输出 CBOR 结果
+    const uint8_t* call_method_cbor(void* runtime, const uint8_t* data, size_t length);
+    
+    // CBOR 编码的批量调用：输入 [{"method": ..., "args": [...]}, ...]
+    const uint8_t* call_batch_cbor(void* runtime, const uint8_t* data, size_t length, bool stop_on_error);
+    
     // 获取状态
     const char* get_state(void* runtime, const char* key);
     
@@ -170,11 +301,35 @@ extern "C" {
     // 获取事件日志
     const char* get_event_log(void* runtime);
     
+    // 获取调用指标（RuntimeConfig::enable_metrics 关闭时只有 "enabled": false 和事件日志信息）
+    const char* get_metrics(void* runtime);
+    
+    // 开启或关闭调用指标（关闭时丢弃已记录的指标）
+    void set_metrics_enabled(void* runtime, bool enabled);
+    
+    // 设置每次调用的 gas 预算（0 表示不限）
+    void set_gas_limit(void* runtime, size_t limit);
+    
+    // 增量获取事件：返回 {"events": [...], "next": 下一次读取的序号}，limit 为 0 表示不限
+    const char* get_events_since(void* runtime, size_t cursor, size_t limit);
+    
     // 创建快照
     const char* create_snapshot(void* runtime);
     
-    // 获取 ABI
+    // 创建增量快照（按配置周期性返回完整快照）
+    const char* create_delta_snapshot(void* runtime, const char* block_height);
+    
+    // 获取 ABI（直接返回协议缓存的文本，不复制）
     const char* get_abi(void* runtime);
+    
+    // 获取全部状态（JSON 对象）：直接返回缓存的序列化结果，不复制；在下一次写入状态之前有效
+    const char* get_all_state(void* runtime);
+    
+    // 最近一次结果的字节长度（配合 HEAPU8 视图零拷贝读取）
+    size_t get_result_length(void* runtime);
+    
+    // 释放结果缓冲区占用的内存
+    void free_result(void* runtime);
 }
 #endif
 
@@ -1,11 +1,12 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <nlohmann/json.hpp>
+#include "runtime.h"
 
 using json = nlohmann::json;
 
+// CardityRuntime 的轻量封装：协议在加载时预编译，调用不再遍历原始 JSON
 class RuntimeEngine {
 public:
     RuntimeEngine(const std::string& car_json_path);
@@ -32,17 +33,12 @@ public:
     // 验证方法是否存在
     bool has_method(const std::string& method_name) const;
 
+    // 获取底层运行时
+    cardity::CardityRuntime& get_runtime() { return runtime; }
+    const cardity::CardityRuntime& get_runtime() const { return runtime; }
+
 private:
-    json car_data;
-    json state;
+    cardity::CardityRuntime runtime;
 
     void load_car_file(const std::string& path);
-    void init_default_state();
-    void execute_logic(const std::string& logic, const std::map<std::string, std::string>& param_map);
-    
-    // 解析参数引用 (params.new_msg, params.0, etc.)
-    std::string resolve_param(const std::string& param_ref, const std::map<std::string, std::string>& param_map);
-    
-    // 解析状态引用 (state.msg, state.count, etc.)
-    std::string resolve_state(const std::string& state_ref);
-}; 
\ No newline at end of file
+};
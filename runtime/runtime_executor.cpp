@@ -0,0 +1,228 @@
+#include "runtime_executor.h"
+#include "log.h"
+#include <algorithm>
+
+namespace cardity {
+
+namespace {
+
+// 当前线程所属的执行器和工作队列（非工作线程为空）
+thread_local const RuntimeExecutor* current_executor = nullptr;
+thread_local size_t current_queue = 0;
+
+} // namespace
+
+RuntimeExecutor::RuntimeExecutor(size_t thread_count) {
+#ifndef __EMSCRIPTEN__
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(&RuntimeExecutor::worker_loop, this, i);
+    }
+#else
+    (void)thread_count;
+#endif
+}
+
+RuntimeExecutor::~RuntimeExecutor() {
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void RuntimeExecutor::post(CardityRuntime& runtime, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ++pending_tasks;
+    }
+
+    // 没有工作线程：在调用线程上直接执行
+    if (workers.empty()) {
+        run_task(runtime, task);
+        finish_tasks(1);
+        return;
+    }
+
+    std::shared_ptr<Strand> to_schedule;
+    {
+        std::lock_guard<std::mutex> lock(strand_mutex);
+        auto& strand = strands[&runtime];
+        if (!strand) {
+            strand = std::make_shared<Strand>();
+            strand->runtime = &runtime;
+        }
+        strand->tasks.push_back(std::move(task));
+        if (!strand->scheduled) {
+            strand->scheduled = true;
+            to_schedule = strand;
+        }
+    }
+
+    if (to_schedule) {
+        push_job([this, to_schedule]() { run_strand(to_schedule); });
+    }
+}
+
+std::future<MethodResult> RuntimeExecutor::call(CardityRuntime& runtime, const std::string& method_name,
+                                                std::vector<std::string> args) {
+    auto promise = std::make_shared<std::promise<MethodResult>>();
+    auto future = promise->get_future();
+    post(runtime, [promise, method_name, args = std::move(args)](CardityRuntime& rt) {
+        try {
+            promise->set_value(rt.call_method(method_name, args));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+std::future<std::vector<MethodResult>> RuntimeExecutor::call_batch(CardityRuntime& runtime,
+                                                                   std::vector<MethodCall> calls,
+                                                                   bool stop_on_error) {
+    auto promise = std::make_shared<std::promise<std::vector<MethodResult>>>();
+    auto future = promise->get_future();
+    post(runtime, [promise, calls = std::move(calls), stop_on_error](CardityRuntime& rt) {
+        try {
+            promise->set_value(rt.call_methods_batch(calls, stop_on_error));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+void RuntimeExecutor::wait_idle() {
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    idle.wait(lock, [this]() { return pending_tasks == 0; });
+}
+
+void RuntimeExecutor::push_job(Job job) {
+    // 工作线程提交到自己的队列，外部线程轮流分配
+    size_t index = current_executor == this ? current_queue
+                                             : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        ++queued_jobs;
+    }
+    wake.notify_one();
+}
+
+bool RuntimeExecutor::take_job(size_t self, Job& job) {
+    // 先取自己队列的尾部
+    {
+        WorkerQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    // 从其他队列头部窃取
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void RuntimeExecutor::worker_loop(size_t index) {
+    current_executor = this;
+    current_queue = index;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [this]() { return stopping || queued_jobs > 0; });
+            if (queued_jobs == 0) {
+                return;
+            }
+            // 预占一个任务，保证下面一定能取到
+            --queued_jobs;
+        }
+
+        Job job;
+        while (!take_job(index, job)) {
+            std::this_thread::yield();
+        }
+        job();
+    }
+}
+
+void RuntimeExecutor::run_strand(const std::shared_ptr<Strand>& strand) {
+    std::vector<Task> batch;
+    {
+        std::lock_guard<std::mutex> lock(strand_mutex);
+        size_t count = std::min(strand->tasks.size(), STRAND_BATCH);
+        for (size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(strand->tasks.front()));
+            strand->tasks.pop_front();
+        }
+    }
+
+    for (auto& task : batch) {
+        run_task(*strand->runtime, task);
+    }
+
+    bool reschedule = false;
+    {
+        std::lock_guard<std::mutex> lock(strand_mutex);
+        if (strand->tasks.empty()) {
+            strand->scheduled = false;
+            strands.erase(strand->runtime);
+        } else {
+            reschedule = true;
+        }
+    }
+
+    // 先计完成数再重新调度，wait_idle 不会错过仍在排队的任务（pending_tasks 已包含它们）
+    finish_tasks(batch.size());
+    if (reschedule) {
+        push_job([this, strand]() { run_strand(strand); });
+    }
+}
+
+void RuntimeExecutor::run_task(CardityRuntime& runtime, Task& task) {
+    try {
+        task(runtime);
+    } catch (const std::exception& e) {
+        CARDITY_LOG_ERROR("Executor task failed: " << e.what());
+    } catch (...) {
+        CARDITY_LOG_ERROR("Executor task failed with unknown exception");
+    }
+}
+
+void RuntimeExecutor::finish_tasks(size_t count) {
+    bool now_idle;
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        pending_tasks -= count;
+        now_idle = pending_tasks == 0;
+    }
+    if (now_idle) {
+        idle.notify_all();
+    }
+}
+
+} // namespace cardity
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "runtime.h"
+
+namespace cardity {
+
+// 多实例并行执行器
+// 每个 CardityRuntime 实例对应一个 strand：同一实例的任务按提交顺序串行执行，
+// 不同实例的任务在工作线程上并行执行。工作线程各有一个任务队列，
+// 本线程提交的任务放入自己的队列（后进先出），空闲线程从其他队列头部窃取。
+// 任务执行期间实例必须保持有效；调用方不得在任务之外同时访问同一实例。
+// Emscripten 构建没有线程，任务在提交线程上立即执行。
+class RuntimeExecutor {
+public:
+    using Task = std::function<void(CardityRuntime&)>;
+
+    // thread_count 为 0 时使用硬件并发数
+    explicit RuntimeExecutor(size_t thread_count = 0);
+    ~RuntimeExecutor();
+
+    RuntimeExecutor(const RuntimeExecutor&) = delete;
+    RuntimeExecutor& operator=(const RuntimeExecutor&) = delete;
+
+    // 在实例的 strand 上执行任务（任务抛出的异常被记录并忽略）
+    void post(CardityRuntime& runtime, Task task);
+
+    // 在实例的 strand 上调用方法
+    std::future<MethodResult> call(CardityRuntime& runtime, const std::string& method_name,
+                                   std::vector<std::string> args);
+    std::future<std::vector<MethodResult>> call_batch(CardityRuntime& runtime, std::vector<MethodCall> calls,
+                                                      bool stop_on_error = false);
+
+    // 等待所有已提交的任务完成
+    void wait_idle();
+
+    size_t thread_count() const { return workers.size(); }
+
+private:
+    // 每个 strand 最多连续执行的任务数，之后让出线程给其他实例
+    static constexpr size_t STRAND_BATCH = 64;
+
+    using Job = std::function<void()>;
+
+    struct Strand {
+        CardityRuntime* runtime;
+        std::deque<Task> tasks;
+        bool scheduled = false;     // 已在某个工作队列中或正在执行
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue{0};
+
+    // 空闲工作线程在此等待
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    size_t queued_jobs = 0;
+    bool stopping = false;
+
+    // 实例到 strand 的映射及 strand 内容；strand 队列为空时移除
+    std::mutex strand_mutex;
+    std::unordered_map<CardityRuntime*, std::shared_ptr<Strand>> strands;
+
+    // 未完成的任务数
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    size_t pending_tasks = 0;
+
+    void push_job(Job job);
+    bool take_job(size_t self, Job& job);
+    void worker_loop(size_t index);
+    void run_strand(const std::shared_ptr<Strand>& strand);
+    void run_task(CardityRuntime& runtime, Task& task);
+    void finish_tasks(size_t count);
+};
+
+} // namespace cardity
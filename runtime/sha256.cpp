@@ -0,0 +1,269 @@
+#include "sha256.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(__EMSCRIPTEN__)
+#define CARDITY_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace cardity {
+
+namespace {
+
+constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+void compress_portable(uint32_t* state, const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks > 0; --blocks, data += 64) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = load_be32(data + i * 4);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef CARDITY_SHA256_X86
+
+// SHA-NI 压缩函数：每组四轮由两条 sha256rnds2 完成，消息扩展使用 sha256msg1/msg2
+__attribute__((target("sha,ssse3,sse4.1")))
+void compress_shani(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // 状态重排为 ABEF / CDGH
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                 // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);           // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byte_swap);
+        }
+
+        // 16 组，每组 4 轮；msg[i & 3] 保存第 i 组的消息字
+        for (int i = 0; i < 16; ++i) {
+            __m128i& current = msg[i & 3];
+            __m128i wk = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + i * 4)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+
+            if (i >= 3 && i <= 14) {
+                __m128i& next = msg[(i + 1) & 3];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(i - 1) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+
+            if (i >= 1 && i <= 12) {
+                __m128i& previous = msg[(i - 1) & 3];
+                previous = _mm_sha256msg1_epu32(previous, current);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    // 还原为 ABCD / EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B);              // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);           // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);        // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+bool detect_shani() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    bool ssse3 = (ecx & (1u << 9)) != 0;
+    bool sse41 = (ecx & (1u << 19)) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    bool sha = (ebx & (1u << 29)) != 0;
+    return ssse3 && sse41 && sha;
+}
+
+#endif
+
+using CompressFunction = void (*)(uint32_t*, const uint8_t*, size_t);
+
+CompressFunction hardware_compress() {
+#ifdef CARDITY_SHA256_X86
+    static const bool available = detect_shani();
+    if (available) {
+        return compress_shani;
+    }
+#endif
+    return nullptr;
+}
+
+CompressFunction active_compress() {
+    static const CompressFunction function = hardware_compress() ? hardware_compress() : compress_portable;
+    return function;
+}
+
+} // namespace
+
+Sha256::Sha256(Implementation implementation) {
+    switch (implementation) {
+        case Implementation::PORTABLE:
+            compress = compress_portable;
+            break;
+        case Implementation::HARDWARE:
+            compress = hardware_compress() ? hardware_compress() : compress_portable;
+            break;
+        default:
+            compress = active_compress();
+            break;
+    }
+    reset();
+}
+
+bool Sha256::uses_hardware() {
+    return active_compress() != compress_portable;
+}
+
+bool Sha256::hardware_available() {
+    return hardware_compress() != nullptr;
+}
+
+void Sha256::reset() {
+    static constexpr uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    std::memcpy(state, initial, sizeof(state));
+    buffered = 0;
+    total_bytes = 0;
+}
+
+void Sha256::update(const void* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    total_bytes += length;
+
+    // 先补齐缓冲中的不完整分组
+    if (buffered > 0) {
+        size_t take = std::min(length, sizeof(buffer) - buffered);
+        std::memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        length -= take;
+        if (buffered < sizeof(buffer)) {
+            return;
+        }
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    // 完整分组直接从输入压缩，不经过缓冲
+    size_t blocks = length / 64;
+    if (blocks > 0) {
+        compress(state, bytes, blocks);
+        bytes += blocks * 64;
+        length -= blocks * 64;
+    }
+
+    std::memcpy(buffer, bytes, length);
+    buffered = length;
+}
+
+Sha256::Digest Sha256::finish() {
+    uint64_t bit_length = total_bytes * 8;
+
+    // 填充：0x80，补零到 56 字节（模 64），再写入 64 位大端长度
+    uint8_t padding[72] = {0x80};
+    size_t pad_length = (buffered < 56 ? 56 : 120) - buffered;
+    for (int i = 0; i < 8; ++i) {
+        padding[pad_length + i] = static_cast<uint8_t>(bit_length >> (56 - i * 8));
+    }
+    update(padding, pad_length + 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::digest(std::string_view data) {
+    Sha256 hasher;
+    hasher.update(data);
+    return hasher.finish();
+}
+
+std::string Sha256::hex(std::string_view data) {
+    return to_hex(digest(data));
+}
+
+std::string Sha256::to_hex(const Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string result(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); ++i) {
+        result[i * 2] = digits[digest[i] >> 4];
+        result[i * 2 + 1] = digits[digest[i] & 0x0F];
+    }
+    return result;
+}
+
+} // namespace cardity
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cardity {
+
+// SHA-256（FIPS 180-4），支持流式输入
+// x86 上运行时检测 SHA-NI 指令并使用硬件压缩函数，其余平台（含 Emscripten）使用可移植实现；
+// 两条路径结果相同
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    // 压缩函数实现：AUTO 按运行时检测选择；HARDWARE 在 CPU 不支持时退回可移植实现
+    enum class Implementation { AUTO, PORTABLE, HARDWARE };
+
+    explicit Sha256(Implementation implementation = Implementation::AUTO);
+
+    void reset();
+    void update(const void* data, size_t length);
+    void update(std::string_view data) { update(data.data(), data.size()); }
+
+    // 结束计算并返回摘要（之后需 reset 才能复用）
+    Digest finish();
+
+    // 一次性计算
+    static Digest digest(std::string_view data);
+    static std::string hex(std::string_view data);
+    static std::string to_hex(const Digest& digest);
+
+    // 当前是否使用 SHA-NI 路径
+    static bool uses_hardware();
+    
+    // CPU 是否支持 SHA-NI 路径
+    static bool hardware_available();
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered;
+    uint64_t total_bytes;
+
+    // 压缩 blocks 个连续的 64 字节分组
+    void (*compress)(uint32_t* state, const uint8_t* data, size_t blocks);
+};
+
+} // namespace cardity
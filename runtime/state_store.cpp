@@ -1,62 +1,334 @@
 #include "state_store.h"
+#include "log.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 
 namespace cardity {
 
-// StateValue 类型转换实现
-int StateValue::to_int() const {
-    try {
-        return std::stoi(value);
-    } catch (...) {
-        return 0;
+namespace {
+
+// 严格解析整数，必须完整消费文本
+bool parse_int64(const std::string& text, int64_t& out) {
+    if (text.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    long long v = std::strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || end != text.c_str() + text.size()) return false;
+    out = static_cast<int64_t>(v);
+    return true;
+}
+
+// 严格解析十进制浮点数，必须完整消费文本（不接受 inf、nan 和十六进制）
+bool parse_double(const std::string& text, double& out) {
+    if (text.empty() || text.find_first_not_of("0123456789+-.eE") != std::string::npos) return false;
+    char* end = nullptr;
+    double v = std::strtod(text.c_str(), &end);
+    if (end != text.c_str() + text.size()) return false;
+    out = v;
+    return true;
+}
+
+// 最短可往返的浮点数格式
+std::string format_double(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (std::strtod(buffer, nullptr) != value) {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value);
     }
+    return buffer;
 }
 
-bool StateValue::to_bool() const {
+bool string_to_bool(const std::string& value) {
     if (value == "true" || value == "1") return true;
     if (value == "false" || value == "0") return false;
     return !value.empty();
 }
 
+} // namespace
+
+ValueType value_type_from_name(const std::string& type_name) {
+    if (type_name == "int" || type_name == "uint" || type_name == "integer") return ValueType::INT;
+    if (type_name == "bool" || type_name == "boolean") return ValueType::BOOL;
+    if (type_name == "float" || type_name == "double" || type_name == "number") return ValueType::FLOAT;
+    return ValueType::STRING;
+}
+
+// StateValue 类型转换实现
+bool StateValue::is_numeric() const {
+    double ignored;
+    return type() != ValueType::BOOL && try_float(ignored);
+}
+
+bool StateValue::try_int64(int64_t& out) const {
+    switch (type()) {
+        case ValueType::INT:
+            out = std::get<int64_t>(data);
+            return true;
+        case ValueType::BOOL:
+            out = std::get<bool>(data) ? 1 : 0;
+            return true;
+        case ValueType::FLOAT:
+            return false;
+        default:
+            return parse_int64(std::get<std::string>(data), out);
+    }
+}
+
+bool StateValue::try_float(double& out) const {
+    switch (type()) {
+        case ValueType::INT:
+            out = static_cast<double>(std::get<int64_t>(data));
+            return true;
+        case ValueType::BOOL:
+            out = std::get<bool>(data) ? 1.0 : 0.0;
+            return true;
+        case ValueType::FLOAT:
+            out = std::get<double>(data);
+            return true;
+        default:
+            return parse_double(std::get<std::string>(data), out);
+    }
+}
+
+bool StateValue::is_empty() const {
+    const std::string* str = as_string();
+    return str && str->empty();
+}
+
+std::string StateValue::to_string() const {
+    switch (type()) {
+        case ValueType::INT:
+            return std::to_string(std::get<int64_t>(data));
+        case ValueType::BOOL:
+            return std::get<bool>(data) ? "true" : "false";
+        case ValueType::FLOAT:
+            return format_double(std::get<double>(data));
+        default:
+            return std::get<std::string>(data);
+    }
+}
+
+int64_t StateValue::to_int64() const {
+    switch (type()) {
+        case ValueType::INT:
+            return std::get<int64_t>(data);
+        case ValueType::BOOL:
+            return std::get<bool>(data) ? 1 : 0;
+        case ValueType::FLOAT:
+            return static_cast<int64_t>(std::get<double>(data));
+        default: {
+            const std::string& str = std::get<std::string>(data);
+            int64_t i;
+            if (parse_int64(str, i)) return i;
+            double d;
+            if (parse_double(str, d)) return static_cast<int64_t>(d);
+            return 0;
+        }
+    }
+}
+
+bool StateValue::to_bool() const {
+    switch (type()) {
+        case ValueType::INT:
+            return std::get<int64_t>(data) != 0;
+        case ValueType::BOOL:
+            return std::get<bool>(data);
+        case ValueType::FLOAT:
+            return std::get<double>(data) != 0.0;
+        default:
+            return string_to_bool(std::get<std::string>(data));
+    }
+}
+
 double StateValue::to_float() const {
-    try {
-        return std::stod(value);
-    } catch (...) {
-        return 0.0;
+    switch (type()) {
+        case ValueType::INT:
+            return static_cast<double>(std::get<int64_t>(data));
+        case ValueType::BOOL:
+            return std::get<bool>(data) ? 1.0 : 0.0;
+        case ValueType::FLOAT:
+            return std::get<double>(data);
+        default: {
+            double d;
+            return parse_double(std::get<std::string>(data), d) ? d : 0.0;
+        }
+    }
+}
+
+StateValue StateValue::coerce(ValueType target) const {
+    if (type() == target) {
+        return *this;
+    }
+    switch (target) {
+        case ValueType::INT:
+            return from_int(to_int64());
+        case ValueType::BOOL:
+            return from_bool(to_bool());
+        case ValueType::FLOAT:
+            return from_float(to_float());
+        default:
+            return from_string(to_string());
     }
 }
 
 StateValue StateValue::from_string(const std::string& val) {
-    return StateValue(ValueType::STRING, val);
+    StateValue value;
+    value.data = val;
+    return value;
 }
 
-StateValue StateValue::from_int(int val) {
-    return StateValue(ValueType::INT, std::to_string(val));
+StateValue StateValue::from_int(int64_t val) {
+    StateValue value;
+    value.data = val;
+    return value;
 }
 
 StateValue StateValue::from_bool(bool val) {
-    return StateValue(ValueType::BOOL, val ? "true" : "false");
+    StateValue value;
+    value.data = val;
+    return value;
 }
 
 StateValue StateValue::from_float(double val) {
-    return StateValue(ValueType::FLOAT, std::to_string(val));
+    StateValue value;
+    value.data = val;
+    return value;
+}
+
+StateValue StateValue::parse(const std::string& text, ValueType type) {
+    return from_string(text).coerce(type);
+}
+
+StateValue StateValue::from_literal(const std::string& text) {
+    if (text == "true") return from_bool(true);
+    if (text == "false") return from_bool(false);
+    
+    int64_t i;
+    if (parse_int64(text, i)) return from_int(i);
+    
+    double d;
+    if (parse_double(text, d)) return from_float(d);
+    return from_string(text);
+}
+
+// StateStore 槽位默认实现（按名称转发）
+StateValue StateStore::get_slot(size_t slot) const {
+    if (slot >= slot_names.size()) {
+        return StateValue();
+    }
+    return get_value(slot_names[slot]);
+}
+
+bool StateStore::set_slot(size_t slot, const StateValue& value) {
+    if (slot >= slot_names.size()) {
+        return false;
+    }
+    return set_value(slot_names[slot], value);
+}
+
+bool StateStore::has_slot(size_t slot) const {
+    return slot < slot_names.size() && has_key(slot_names[slot]);
+}
+
+void StateStore::for_each(const StateVisitor& visitor) const {
+    for (const auto& [key, value] : get_all()) {
+        visitor(key, value);
+    }
 }
 
 // MemoryStateStore 实现
+size_t MemoryStateStore::find_slot(std::string_view key) const {
+    if (slot_index.empty()) {
+        return std::string::npos;
+    }
+    auto it = slot_index.find(key);
+    return it != slot_index.end() ? it->second : std::string::npos;
+}
+
+void MemoryStateStore::for_each(const StateVisitor& visitor) const {
+    for (size_t i = 0; i < slot_values.size(); ++i) {
+        if (slot_present[i]) {
+            visitor(slot_names[i], slot_values[i]);
+        }
+    }
+    for (const auto& [key, value] : state) {
+        visitor(key, value);
+    }
+}
+
+void MemoryStateStore::bind_slots(const std::vector<std::string>& names) {
+    // 旧槽位中的值移回普通键
+    for (size_t i = 0; i < slot_values.size(); ++i) {
+        if (slot_present[i]) {
+            state[slot_names[i]] = std::move(slot_values[i]);
+        }
+    }
+    
+    StateStore::bind_slots(names);
+    slot_values.assign(names.size(), StateValue());
+    slot_present.assign(names.size(), 0);
+    slot_index.clear();
+    
+    // 已存在的同名键迁入槽位
+    for (size_t i = 0; i < names.size(); ++i) {
+        slot_index[names[i]] = i;
+        auto it = state.find(names[i]);
+        if (it != state.end()) {
+            slot_values[i] = std::move(it->second);
+            slot_present[i] = 1;
+            state.erase(it);
+        }
+    }
+}
+
+StateValue MemoryStateStore::get_slot(size_t slot) const {
+    if (slot >= slot_values.size() || !slot_present[slot]) {
+        return StateValue();
+    }
+    return slot_values[slot];
+}
+
+bool MemoryStateStore::set_slot(size_t slot, const StateValue& value) {
+    if (slot >= slot_values.size()) {
+        return false;
+    }
+    slot_values[slot] = value;
+    slot_present[slot] = 1;
+    return true;
+}
+
+bool MemoryStateStore::has_slot(size_t slot) const {
+    return slot < slot_present.size() && slot_present[slot];
+}
+
 bool MemoryStateStore::set_value(const std::string& key, const StateValue& value) {
+    size_t slot = find_slot(key);
+    if (slot != std::string::npos) {
+        // 非虚调用：派生存储已在 set_value 中处理过该写入
+        return MemoryStateStore::set_slot(slot, value);
+    }
+    
     try {
         state[key] = value;
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error setting value: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error setting value: " << e.what());
         return false;
     }
 }
 
 StateValue MemoryStateStore::get_value(const std::string& key) const {
+    size_t slot = find_slot(key);
+    if (slot != std::string::npos) {
+        return get_slot(slot);
+    }
+    
     auto it = state.find(key);
     if (it != state.end()) {
         return it->second;
@@ -65,10 +337,24 @@ StateValue MemoryStateStore::get_value(const std::string& key) const {
 }
 
 bool MemoryStateStore::has_key(const std::string& key) const {
+    size_t slot = find_slot(key);
+    if (slot != std::string::npos) {
+        return slot_present[slot] != 0;
+    }
     return state.find(key) != state.end();
 }
 
 bool MemoryStateStore::remove_key(const std::string& key) {
+    size_t slot = find_slot(key);
+    if (slot != std::string::npos) {
+        if (!slot_present[slot]) {
+            return false;
+        }
+        slot_values[slot] = StateValue();
+        slot_present[slot] = 0;
+        return true;
+    }
+    
     auto it = state.find(key);
     if (it != state.end()) {
         state.erase(it);
@@ -79,34 +365,52 @@ bool MemoryStateStore::remove_key(const std::string& key) {
 
 void MemoryStateStore::set_multiple(const std::map<std::string, StateValue>& values) {
     for (const auto& [key, value] : values) {
-        state[key] = value;
+        set_value(key, value);
     }
 }
 
+const StateValue* MemoryStateStore::find_value(std::string_view key) const {
+    size_t slot = find_slot(key);
+    if (slot != std::string::npos) {
+        return slot_present[slot] ? &slot_values[slot] : nullptr;
+    }
+    
+    auto it = state.find(key);
+    return it != state.end() ? &it->second : nullptr;
+}
+
+const StateValue* MemoryStateStore::find_slot_value(size_t slot) const {
+    return slot < slot_values.size() && slot_present[slot] ? &slot_values[slot] : nullptr;
+}
+
 std::map<std::string, StateValue> MemoryStateStore::get_all() const {
-    return state;
+    std::map<std::string, StateValue> result;
+    for_each([&result](const std::string& key, const StateValue& value) {
+        result[key] = value;
+    });
+    return result;
 }
 
 bool MemoryStateStore::save_to_file(const std::string& file_path) const {
     try {
-        json j;
-        for (const auto& [key, value] : state) {
+        json j = json::object();
+        for_each([&j](const std::string& key, const StateValue& value) {
             json value_json;
-            value_json["type"] = static_cast<int>(value.type);
-            value_json["value"] = value.value;
+            value_json["type"] = static_cast<int>(value.type());
+            value_json["value"] = value.to_string();
             j[key] = value_json;
-        }
+        });
         
         std::ofstream file(file_path);
         if (!file.is_open()) {
-            std::cerr << "Failed to open file for writing: " << file_path << std::endl;
+            CARDITY_LOG_ERROR("Failed to open file for writing: " << file_path);
             return false;
         }
         
         file << j.dump(2);
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error saving to file: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error saving to file: " << e.what());
         return false;
     }
 }
@@ -115,7 +419,7 @@ bool MemoryStateStore::load_from_file(const std::string& file_path) {
     try {
         std::ifstream file(file_path);
         if (!file.is_open()) {
-            std::cerr << "Failed to open file: " << file_path << std::endl;
+            CARDITY_LOG_ERROR("Failed to open file: " << file_path);
             return false;
         }
         
@@ -124,32 +428,30 @@ bool MemoryStateStore::load_from_file(const std::string& file_path) {
         
         json j = json::parse(buffer.str());
         
-        state.clear();
+        clear();
         for (const auto& [key, value_json] : j.items()) {
-            StateValue value;
-            value.type = static_cast<ValueType>(value_json["type"].get<int>());
-            value.value = value_json["value"].get<std::string>();
-            state[key] = value;
+            StateValue value(static_cast<ValueType>(value_json["type"].get<int>()),
+                             value_json["value"].get<std::string>());
+            set_value(key, value);
         }
         
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error loading from file: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error loading from file: " << e.what());
         return false;
     }
 }
 
 json MemoryStateStore::create_snapshot() const {
     json snapshot;
-    snapshot["timestamp"] = std::to_string(std::time(nullptr));
     snapshot["state"] = json::object();
     
-    for (const auto& [key, value] : state) {
+    for_each([&snapshot](const std::string& key, const StateValue& value) {
         json value_json;
-        value_json["type"] = static_cast<int>(value.type);
-        value_json["value"] = value.value;
+        value_json["type"] = static_cast<int>(value.type());
+        value_json["value"] = value.to_string();
         snapshot["state"][key] = value_json;
-    }
+    });
     
     return snapshot;
 }
@@ -157,118 +459,192 @@ json MemoryStateStore::create_snapshot() const {
 bool MemoryStateStore::restore_from_snapshot(const json& snapshot) {
     try {
         if (!snapshot.contains("state")) {
-            std::cerr << "Invalid snapshot format: missing state" << std::endl;
+            CARDITY_LOG_ERROR("Invalid snapshot format: missing state");
             return false;
         }
         
-        state.clear();
+        clear();
         const auto& state_json = snapshot["state"];
         
         for (const auto& [key, value_json] : state_json.items()) {
-            StateValue value;
-            value.type = static_cast<ValueType>(value_json["type"].get<int>());
-            value.value = value_json["value"].get<std::string>();
-            state[key] = value;
+            StateValue value(static_cast<ValueType>(value_json["type"].get<int>()),
+                             value_json["value"].get<std::string>());
+            set_value(key, value);
         }
         
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error restoring from snapshot: " << e.what() << std::endl;
+        CARDITY_LOG_ERROR("Error restoring from snapshot: " << e.what());
         return false;
     }
 }
 
 void MemoryStateStore::clear() {
     state.clear();
+    std::fill(slot_values.begin(), slot_values.end(), StateValue());
+    std::fill(slot_present.begin(), slot_present.end(), 0);
 }
 
 size_t MemoryStateStore::size() const {
-    return state.size();
+    return state.size() + std::count(slot_present.begin(), slot_present.end(), 1);
 }
 
 void MemoryStateStore::initialize_from_protocol(const std::map<std::string, std::string>& state_def) {
     for (const auto& [name, default_value] : state_def) {
-        StateValue value(ValueType::STRING, default_value);
-        state[name] = value;
+        set_value(name, StateValue(ValueType::STRING, default_value));
     }
 }
 
 // StateManager 实现
-StateManager::StateManager() : store(std::make_unique<MemoryStateStore>()) {}
+StateManager::StateManager() : store(std::make_unique<MemoryStateStore>()), dirty_all(true), write_version(0) {}
+
+StateManager::StateManager(std::unique_ptr<StateStore> state_store)
+    : store(std::move(state_store)), dirty_all(true), write_version(0) {}
+
+void StateManager::record_key(const std::string& key) {
+    dirty_keys.insert(key);
+    if (savepoints.empty()) {
+        return;
+    }
+    UndoEntry entry{false, 0, key, store->has_key(key), StateValue()};
+    if (entry.existed) {
+        entry.previous = store->get_value(key);
+    }
+    journal.push_back(std::move(entry));
+}
 
-StateManager::StateManager(std::unique_ptr<StateStore> state_store) : store(std::move(state_store)) {}
+void StateManager::end_write() {
+    ++write_version;
+    if (savepoints.empty()) {
+        store->sync_point();
+    }
+}
+
+void StateManager::record_slot(size_t slot) {
+    if (slot < dirty_slots.size()) {
+        dirty_slots[slot] = 1;
+    }
+    if (savepoints.empty()) {
+        return;
+    }
+    UndoEntry entry{true, slot, std::string(), store->has_slot(slot), StateValue()};
+    if (entry.existed) {
+        entry.previous = store->get_slot(slot);
+    }
+    journal.push_back(std::move(entry));
+}
 
 bool StateManager::set(const std::string& key, const std::string& value) {
-    return store->set_value(key, StateValue::from_string(value));
+    return set_value(key, StateValue::from_string(value));
 }
 
 bool StateManager::set_int(const std::string& key, int value) {
-    return store->set_value(key, StateValue::from_int(value));
+    return set_value(key, StateValue::from_int(value));
 }
 
 bool StateManager::set_bool(const std::string& key, bool value) {
-    return store->set_value(key, StateValue::from_bool(value));
+    return set_value(key, StateValue::from_bool(value));
 }
 
 bool StateManager::set_float(const std::string& key, double value) {
-    return store->set_value(key, StateValue::from_float(value));
+    return set_value(key, StateValue::from_float(value));
+}
+
+bool StateManager::set_value(const std::string& key, const StateValue& value) {
+    record_key(key);
+    bool ok = store->set_value(key, value);
+    end_write();
+    return ok;
 }
 
 std::string StateManager::get_string(const std::string& key, const std::string& default_value) const {
+    if (const StateValue* found = store->find_value(key)) {
+        return found->to_string();
+    }
     StateValue value = store->get_value(key);
-    if (value.value.empty() && !store->has_key(key)) {
+    if (value.is_empty() && !store->has_key(key)) {
         return default_value;
     }
     return value.to_string();
 }
 
 int StateManager::get_int(const std::string& key, int default_value) const {
+    if (const StateValue* found = store->find_value(key)) {
+        return found->to_int();
+    }
     StateValue value = store->get_value(key);
-    if (value.value.empty() && !store->has_key(key)) {
+    if (value.is_empty() && !store->has_key(key)) {
         return default_value;
     }
     return value.to_int();
 }
 
 bool StateManager::get_bool(const std::string& key, bool default_value) const {
+    if (const StateValue* found = store->find_value(key)) {
+        return found->to_bool();
+    }
     StateValue value = store->get_value(key);
-    if (value.value.empty() && !store->has_key(key)) {
+    if (value.is_empty() && !store->has_key(key)) {
         return default_value;
     }
     return value.to_bool();
 }
 
 double StateManager::get_float(const std::string& key, double default_value) const {
+    if (const StateValue* found = store->find_value(key)) {
+        return found->to_float();
+    }
     StateValue value = store->get_value(key);
-    if (value.value.empty() && !store->has_key(key)) {
+    if (value.is_empty() && !store->has_key(key)) {
         return default_value;
     }
     return value.to_float();
 }
 
+void StateManager::bind_slots(const std::vector<std::string>& names) {
+    store->bind_slots(names);
+    
+    // 槽位布局变化后无法与上一次快照对比
+    dirty_slots.assign(names.size(), 0);
+    dirty_keys.clear();
+    dirty_all = true;
+    ++write_version;
+}
+
+StateValue StateManager::get_slot(size_t slot) const {
+    return store->get_slot(slot);
+}
+
+bool StateManager::set_slot(size_t slot, const StateValue& value) {
+    record_slot(slot);
+    bool ok = store->set_slot(slot, value);
+    end_write();
+    return ok;
+}
+
+StateValue StateManager::get_value(const std::string& key) const {
+    return store->get_value(key);
+}
+
 bool StateManager::has(const std::string& key) const {
     return store->has_key(key);
 }
 
 bool StateManager::remove(const std::string& key) {
-    return store->remove_key(key);
+    record_key(key);
+    bool ok = store->remove_key(key);
+    end_write();
+    return ok;
 }
 
 void StateManager::set_multiple(const std::map<std::string, std::string>& values) {
     std::map<std::string, StateValue> state_values;
     for (const auto& [key, value] : values) {
+        record_key(key);
         state_values[key] = StateValue::from_string(value);
     }
     store->set_multiple(state_values);
-}
-
-std::map<std::string, std::string> StateManager::get_all_strings() const {
-    std::map<std::string, StateValue> all_values = store->get_all();
-    std::map<std::string, std::string> result;
-    for (const auto& [key, value] : all_values) {
-        result[key] = value.to_string();
-    }
-    return result;
+    end_write();
 }
 
 bool StateManager::save(const std::string& file_path) const {
@@ -276,7 +652,14 @@ bool StateManager::save(const std::string& file_path) const {
 }
 
 bool StateManager::load(const std::string& file_path) {
-    return store->load_from_file(file_path);
+    dirty_all = true;
+    bool ok = store->load_from_file(file_path);
+    end_write();
+    return ok;
+}
+
+bool StateManager::flush() {
+    return store->flush();
 }
 
 json StateManager::snapshot() const {
@@ -284,15 +667,91 @@ json StateManager::snapshot() const {
 }
 
 bool StateManager::restore(const json& snapshot) {
-    return store->restore_from_snapshot(snapshot);
+    dirty_all = true;
+    bool ok = store->restore_from_snapshot(snapshot);
+    end_write();
+    return ok;
 }
 
 void StateManager::clear() {
+    if (!savepoints.empty()) {
+        store->for_each([this](const std::string& key, const StateValue& value) {
+            journal.push_back(UndoEntry{false, 0, key, true, value});
+        });
+    }
     store->clear();
+    dirty_all = true;
+    end_write();
 }
 
 size_t StateManager::size() const {
     return store->size();
 }
 
+void StateManager::begin_transaction() {
+    savepoints.push_back(journal.size());
+}
+
+void StateManager::commit() {
+    if (savepoints.empty()) {
+        return;
+    }
+    savepoints.pop_back();
+    
+    // 最外层提交后丢弃撤销日志；内层提交的记录保留给外层回滚
+    if (savepoints.empty()) {
+        journal.clear();
+        store->sync_point();
+    }
+}
+
+void StateManager::rollback() {
+    if (savepoints.empty()) {
+        return;
+    }
+    size_t mark = savepoints.back();
+    savepoints.pop_back();
+    
+    // 逆序恢复旧值
+    while (journal.size() > mark) {
+        UndoEntry& entry = journal.back();
+        if (entry.is_slot) {
+            if (entry.slot < dirty_slots.size()) {
+                dirty_slots[entry.slot] = 1;
+            }
+            if (entry.existed) {
+                store->set_slot(entry.slot, entry.previous);
+            } else if (entry.slot < store->get_slot_names().size()) {
+                store->remove_key(store->get_slot_names()[entry.slot]);
+            }
+        } else if (entry.existed) {
+            dirty_keys.insert(entry.key);
+            store->set_value(entry.key, entry.previous);
+        } else {
+            dirty_keys.insert(entry.key);
+            store->remove_key(entry.key);
+        }
+        journal.pop_back();
+    }
+    
+    end_write();
+}
+
+std::vector<std::string> StateManager::get_dirty_keys() const {
+    std::set<std::string> keys = dirty_keys;
+    const auto& names = store->get_slot_names();
+    for (size_t i = 0; i < dirty_slots.size() && i < names.size(); ++i) {
+        if (dirty_slots[i]) {
+            keys.insert(names[i]);
+        }
+    }
+    return std::vector<std::string>(keys.begin(), keys.end());
+}
+
+void StateManager::clear_dirty() {
+    dirty_keys.clear();
+    std::fill(dirty_slots.begin(), dirty_slots.end(), 0);
+    dirty_all = false;
+}
+
 } // namespace cardity 
\ No newline at end of file
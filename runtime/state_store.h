@@ -1,10 +1,16 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <map>
+#include <set>
 #include <memory>
 #include <functional>
+#include <variant>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include "flat_hash_map.h"
 
 namespace cardity {
 
@@ -18,27 +24,59 @@ enum class ValueType {
     FLOAT
 };
 
-// 状态值
+// 根据协议中的类型名称获取值类型（"int"、"bool"、"float"，其余按字符串处理）
+ValueType value_type_from_name(const std::string& type_name);
+
+// 状态值：原生类型的标签联合，仅在 JSON/CLI 边界转换为字符串
 struct StateValue {
-    ValueType type;
-    std::string value;
+    // 变体下标与 ValueType 的取值一一对应
+    using Storage = std::variant<std::string, int64_t, bool, double>;
+    Storage data;
+    
+    StateValue() : data(std::string()) {}
+    StateValue(ValueType t, const std::string& v) : data(parse(v, t).data) {}
+    
+    // 值类型
+    ValueType type() const { return static_cast<ValueType>(data.index()); }
+    bool is_numeric() const;
+    bool is_empty() const;
+    
+    // 原生访问（类型不符时为空指针）
+    const std::string* as_string() const { return std::get_if<std::string>(&data); }
     
-    StateValue() : type(ValueType::STRING), value("") {}
-    StateValue(ValueType t, const std::string& v) : type(t), value(v) {}
+    // 严格数值读取：整数/布尔/浮点原生值或完整数字形式的字符串
+    bool try_int64(int64_t& out) const;
+    bool try_float(double& out) const;
     
     // 类型转换
-    std::string to_string() const { return value; }
-    int to_int() const;
+    std::string to_string() const;
+    int to_int() const { return static_cast<int>(to_int64()); }
+    int64_t to_int64() const;
     bool to_bool() const;
     double to_float() const;
     
+    // 转换为指定类型
+    StateValue coerce(ValueType target) const;
+    
     // 从字符串创建
     static StateValue from_string(const std::string& val);
-    static StateValue from_int(int val);
+    static StateValue from_int(int64_t val);
     static StateValue from_bool(bool val);
     static StateValue from_float(double val);
+    
+    // 按指定类型解析文本
+    static StateValue parse(const std::string& text, ValueType type);
+    
+    // 按字面量推断类型（整数、浮点数、true/false，其余为字符串）
+    static StateValue from_literal(const std::string& text);
+    
+    bool operator==(const StateValue& other) const { return data == other.data; }
+    bool operator!=(const StateValue& other) const { return data != other.data; }
 };
 
+// 状态遍历回调
+using StateVisitor = std::function<void(const std::string&, const StateValue&)>;
+
 // 状态存储接口
 class StateStore {
 public:
@@ -52,13 +90,21 @@ public:
     
     // 批量操作
     virtual void set_multiple(const std::map<std::string, StateValue>& values) = 0;
+    // 便捷副本：复制整个状态，只用于快照等需要独立副本的场合；只读遍历使用 for_each
     virtual std::map<std::string, StateValue> get_all() const = 0;
     
+    // 遍历所有键值，不复制整个状态（默认实现基于 get_all）
+    virtual void for_each(const StateVisitor& visitor) const;
+    
+    // 返回存储内部值的指针（下一次写入前有效）；无法提供稳定引用时返回 nullptr，调用方改用 get_value
+    virtual const StateValue* find_value(std::string_view) const { return nullptr; }
+    virtual const StateValue* find_slot_value(size_t) const { return nullptr; }
+    
     // 持久化
     virtual bool save_to_file(const std::string& file_path) const = 0;
     virtual bool load_from_file(const std::string& file_path) = 0;
     
-    // 快照
+    // 快照：只包含状态本身（不含墙钟时间），同一状态的快照相同；区块上下文由 CardityRuntime::create_snapshot 记录
     virtual json create_snapshot() const = 0;
     virtual bool restore_from_snapshot(const json& snapshot) = 0;
     
@@ -67,12 +113,35 @@ public:
     
     // 获取大小
     virtual size_t size() const = 0;
+    
+    // 槽位：加载协议时为已声明的状态变量分配的整数索引
+    // 默认实现按名称转发，存储后端可覆盖以提供连续数组访问
+    virtual void bind_slots(const std::vector<std::string>& names) { slot_names = names; }
+    virtual StateValue get_slot(size_t slot) const;
+    virtual bool set_slot(size_t slot, const StateValue& value);
+    virtual bool has_slot(size_t slot) const;
+    const std::vector<std::string>& get_slot_names() const { return slot_names; }
+    
+    // 写入单元边界：StateManager 在最外层事务结束或事务外的单次写入后调用
+    virtual void sync_point() {}
+    
+    // 将缓冲的写入持久化到存储介质
+    virtual bool flush() { return true; }
+
+protected:
+    std::vector<std::string> slot_names;
 };
 
 // 内存状态存储（默认实现）
 class MemoryStateStore : public StateStore {
 private:
-    std::map<std::string, StateValue> state;
+    FlatHashMap<StateValue> state;                  // 未分配槽位的键
+    std::vector<StateValue> slot_values;            // 已声明状态变量，按槽位连续存储
+    std::vector<char> slot_present;                 // 槽位是否有值
+    FlatHashMap<size_t> slot_index;                 // 名称到槽位的映射（仅按名称访问时使用）
+    
+    // 查找名称对应的槽位，未分配返回 npos
+    size_t find_slot(std::string_view key) const;
     
 public:
     MemoryStateStore() = default;
@@ -85,6 +154,9 @@ public:
     
     void set_multiple(const std::map<std::string, StateValue>& values) override;
     std::map<std::string, StateValue> get_all() const override;
+    void for_each(const StateVisitor& visitor) const override;
+    const StateValue* find_value(std::string_view key) const override;
+    const StateValue* find_slot_value(size_t slot) const override;
     
     bool save_to_file(const std::string& file_path) const override;
     bool load_from_file(const std::string& file_path) override;
@@ -95,14 +167,43 @@ public:
     void clear() override;
     size_t size() const override;
     
+    void bind_slots(const std::vector<std::string>& names) override;
+    StateValue get_slot(size_t slot) const override;
+    bool set_slot(size_t slot, const StateValue& value) override;
+    bool has_slot(size_t slot) const override;
+    
     // 初始化状态
     void initialize_from_protocol(const std::map<std::string, std::string>& state_def);
 };
 
-// 状态管理器
+// 状态管理器（与所属运行时实例一样不加锁，不能被多个线程同时使用）
 class StateManager {
 private:
+    // 撤销记录：写入前的旧值
+    struct UndoEntry {
+        bool is_slot;
+        size_t slot;
+        std::string key;
+        bool existed;
+        StateValue previous;
+    };
+    
     std::unique_ptr<StateStore> store;
+    std::vector<UndoEntry> journal;          // 事务期间的撤销日志
+    std::vector<size_t> savepoints;          // 每层事务开始时的日志位置
+    
+    // 变更跟踪：上一次 clear_dirty 之后写入或删除过的键（增量快照使用）
+    std::set<std::string> dirty_keys;
+    std::vector<char> dirty_slots;
+    bool dirty_all;                           // clear/load/restore 之后只能生成完整快照
+    uint64_t write_version;                   // 每次写入（含回滚、清空、加载）后递增，缓存的状态视图据此失效
+    
+    // 写入前标记变更，并在事务中记录旧值
+    void record_key(const std::string& key);
+    void record_slot(size_t slot);
+    
+    // 事务外的写入完成后通知存储
+    void end_write();
     
 public:
     StateManager();
@@ -113,22 +214,34 @@ public:
     bool set_int(const std::string& key, int value);
     bool set_bool(const std::string& key, bool value);
     bool set_float(const std::string& key, double value);
+    bool set_value(const std::string& key, const StateValue& value);
     
     std::string get_string(const std::string& key, const std::string& default_value = "") const;
     int get_int(const std::string& key, int default_value = 0) const;
     bool get_bool(const std::string& key, bool default_value = false) const;
     double get_float(const std::string& key, double default_value = 0.0) const;
+    StateValue get_value(const std::string& key) const;
     
     bool has(const std::string& key) const;
     bool remove(const std::string& key);
     
+    // 槽位访问
+    void bind_slots(const std::vector<std::string>& names);
+    StateValue get_slot(size_t slot) const;
+    bool set_slot(size_t slot, const StateValue& value);
+    
     // 批量操作
     void set_multiple(const std::map<std::string, std::string>& values);
-    std::map<std::string, std::string> get_all_strings() const;
+    
+    // 零拷贝读取：遍历全部状态，或取得存储内部值的指针（可能为 nullptr）
+    void for_each(const StateVisitor& visitor) const { store->for_each(visitor); }
+    const StateValue* find_value(std::string_view key) const { return store->find_value(key); }
+    const StateValue* find_slot_value(size_t slot) const { return store->find_slot_value(slot); }
     
     // 持久化
     bool save(const std::string& file_path) const;
     bool load(const std::string& file_path);
+    bool flush();
     
     // 快照
     json snapshot() const;
@@ -140,6 +253,21 @@ public:
     // 获取大小
     size_t size() const;
     
+    // 事务：写入时记录撤销日志，提交或回滚的代价与写入次数成正比
+    // 支持嵌套；load/restore 不参与事务
+    void begin_transaction();
+    void commit();
+    void rollback();
+    bool in_transaction() const { return !savepoints.empty(); }
+    
+    // 变更跟踪：返回自上次 clear_dirty 以来变更过的键（包括已删除的键）
+    std::vector<std::string> get_dirty_keys() const;
+    bool is_fully_dirty() const { return dirty_all; }
+    void clear_dirty();
+    
+    // 写入版本：与上次读取时相同说明状态未变（不经 StateManager 直接写底层存储的修改不计入）
+    uint64_t get_write_version() const { return write_version; }
+    
     // 获取底层存储
     StateStore* get_store() { return store.get(); }
     const StateStore* get_store() const { return store.get(); }
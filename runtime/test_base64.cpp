@@ -0,0 +1,143 @@
+#include "base64.h"
+#include "test_check.h"
+#include <algorithm>
+
+using namespace cardity;
+
+namespace {
+
+// 长度为 length 的二进制数据，包含所有字节值
+std::string binary_data(size_t length) {
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<char>((i * 37 + length) & 0xFF);
+    }
+    return data;
+}
+
+std::string decode(std::string_view input, bool& ok) {
+    std::string output = "stale";
+    ok = base64_decode(input, output);
+    return output;
+}
+
+bool rejects(std::string_view input) {
+    bool ok = true;
+    std::string output = decode(input, ok);
+    return !ok && output.empty();
+}
+
+void test_rfc4648_vectors() {
+    const std::pair<const char*, const char*> vectors[] = {
+        {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+    };
+    for (const auto& [plain, encoded] : vectors) {
+        CHECK_EQ(base64_encode(plain), std::string(encoded));
+        bool ok = false;
+        CHECK_EQ(decode(encoded, ok), std::string(plain));
+        CHECK(ok);
+    }
+}
+
+void test_round_trip() {
+    for (size_t length = 0; length < 300; ++length) {
+        std::string data = binary_data(length);
+        std::string encoded = base64_encode(data);
+        CHECK_EQ(encoded.size(), base64_encoded_size(length));
+
+        bool ok = false;
+        std::string decoded = decode(encoded, ok);
+        CHECK(ok);
+        CHECK(decoded == data);
+        CHECK(decoded.size() <= base64_decoded_max_size(encoded.size()));
+
+        // 省略填充
+        std::string unpadded = encoded.substr(0, encoded.find('='));
+        CHECK(decode(unpadded, ok) == data);
+        CHECK(ok);
+    }
+}
+
+void test_whitespace_is_ignored() {
+    std::string data = binary_data(200);
+    std::string encoded = base64_encode(data);
+
+    // 每 76 个字符换行（MIME 风格），以及在快速路径中间插入各种空白
+    std::string wrapped;
+    for (size_t i = 0; i < encoded.size(); i += 76) {
+        wrapped += encoded.substr(i, 76) + "\r\n";
+    }
+    bool ok = false;
+    CHECK(decode(wrapped, ok) == data);
+    CHECK(ok);
+
+    std::string spaced = " \t" + encoded.substr(0, 5) + " \n" + encoded.substr(5, 30) + "\f\v" + encoded.substr(35) + "\n";
+    CHECK(decode(spaced, ok) == data);
+    CHECK(ok);
+
+    CHECK(decode("Zm9v YmFy", ok) == "foobar");
+    CHECK(ok);
+    CHECK(decode("Zg = =", ok) == "f");
+    CHECK(ok);
+    CHECK(decode(" \n\t", ok).empty());
+    CHECK(ok);
+}
+
+void test_url_safe_alphabet() {
+    // 0xFB 0xFF 0xBF 编码为 "+/+/"（标准）或 "-_-_"（URL 安全）
+    std::string data("\xFB\xFF\xBF\xFB\xFF\xBF", 6);
+    CHECK_EQ(base64_encode(data), std::string("+/+/+/+/"));
+
+    bool ok = false;
+    CHECK(decode("-_-_-_-_", ok) == data);
+    CHECK(ok);
+    CHECK(decode("+/-_+/-_", ok) == data);
+    CHECK(ok);
+
+    std::string binary = binary_data(255);
+    std::string url_safe = base64_encode(binary);
+    std::replace(url_safe.begin(), url_safe.end(), '+', '-');
+    std::replace(url_safe.begin(), url_safe.end(), '/', '_');
+    CHECK(decode(url_safe, ok) == binary);
+    CHECK(ok);
+}
+
+void test_rejects_data_after_padding() {
+    CHECK(rejects("Zg==Zg=="));
+    CHECK(rejects("Zg=a"));
+    CHECK(rejects("Zm8=Zm9v"));
+    CHECK(rejects("Zg== x"));
+    CHECK(rejects("=Zm9v"));
+}
+
+void test_rejects_single_trailing_character() {
+    CHECK(rejects("Z"));
+    CHECK(rejects("Zm9vY"));
+    CHECK(rejects("Zm9vY==="));
+    CHECK(rejects("Zm9v Y\n"));
+    CHECK(rejects("Zm9vYmFyZ"));
+}
+
+void test_rejects_invalid_characters() {
+    CHECK(rejects("Zm9v!mFy"));
+    CHECK(rejects("Zm9vYmF*"));
+    CHECK(rejects(std::string("Zm9\0YmFy", 8)));
+    CHECK(rejects("Zm9vYmFy\xC3\xA9"));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing Base64..." << std::endl;
+
+    cardity_test::run("RFC 4648 vectors", test_rfc4648_vectors);
+    cardity_test::run("round-trip all lengths", test_round_trip);
+    cardity_test::run("whitespace is ignored", test_whitespace_is_ignored);
+    cardity_test::run("URL-safe alphabet", test_url_safe_alphabet);
+    cardity_test::run("data after '=' is rejected", test_rejects_data_after_padding);
+    cardity_test::run("single trailing character is rejected", test_rejects_single_trailing_character);
+    cardity_test::run("invalid characters are rejected", test_rejects_invalid_characters);
+
+    return cardity_test::finish();
+}
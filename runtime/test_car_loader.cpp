@@ -0,0 +1,210 @@
+#include "car_loader.h"
+#include "logic_engine.h"
+#include "test_check.h"
+#include <fstream>
+#include <sstream>
+
+using namespace cardity;
+
+namespace {
+
+// 两条路径使用同一个内容哈希，比较的只是解析结果
+const char* CONTENT_HASH = "parity";
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::unique_ptr<CarProtocol> load_dom(const std::string& text) {
+    try {
+        return CarLoader::load_from_parsed(json::parse(text), CONTENT_HASH);
+    } catch (const json::exception&) {
+        return nullptr;
+    }
+}
+
+std::vector<std::string> names_of(const FlatHashMap<Method>& methods) {
+    std::vector<std::string> names;
+    for (const auto& entry : methods) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+// SAX 路径（load_from_source）与 DOM 路径（load_from_parsed）得到相同的协议：
+// 导出的 JSON、ABI 文本（含成员顺序）、槽位表和每个方法的逻辑都相同
+void check_parity(const std::string& text, bool streamed) {
+    auto sax = CarLoader::load_from_source(text, CONTENT_HASH);
+    auto dom = load_dom(text);
+    CHECK(sax != nullptr);
+    CHECK(dom != nullptr);
+    if (!sax || !dom) {
+        return;
+    }
+
+    CHECK_EQ(sax->load_timings.streamed, streamed);
+    CHECK(CarLoader::export_to_json(*sax) == CarLoader::export_to_json(*dom));
+    CHECK_EQ(sax->abi_json(), dom->abi_json());
+    CHECK(sax->cpl.state_slots == dom->cpl.state_slots);
+    CHECK(names_of(sax->cpl.methods) == names_of(dom->cpl.methods));
+    CHECK_EQ(sax->hash, dom->hash);
+    CHECK_EQ(sax->content_hash, dom->content_hash);
+
+    for (const auto& [name, method] : dom->cpl.methods) {
+        auto it = sax->cpl.methods.find(name);
+        CHECK(it != sax->cpl.methods.end());
+        if (it != sax->cpl.methods.end()) {
+            CHECK_EQ(it->second.logic, method.logic);
+            CHECK_EQ(it->second.returns, method.returns);
+            CHECK(it->second.params == method.params);
+            CHECK(it->second.program != nullptr);
+            CHECK(method.program != nullptr);
+        }
+    }
+}
+
+// 两条路径都拒绝
+void check_both_reject(const std::string& text) {
+    CHECK(CarLoader::load_from_source(text, CONTENT_HASH) == nullptr);
+    CHECK(load_dom(text) == nullptr);
+}
+
+void test_example_protocol() {
+    std::string text = read_file("test_data/hello_cardinals.car");
+    CHECK(!text.empty());
+    check_parity(text, true);
+
+    auto protocol = CarLoader::load_from_source(text, CONTENT_HASH);
+    CHECK(protocol && CarLoader::validate_protocol(*protocol));
+}
+
+void test_synthetic_protocol() {
+    // 各种写法：逻辑数组、returns 对象和字符串、事件参数的对象和字符串形式、空段落
+    check_parity(R"car({
+      "p": "cardinals", "op": "deploy", "protocol": "synthetic", "version": "2.1",
+      "cpl": {
+        "owner": "doge1owner",
+        "state": {
+          "zeta": {"type": "int", "default": "7"},
+          "alpha": {"type": "bool"},
+          "mid": {}
+        },
+        "methods": {
+          "set": {"params": ["v"], "logic": ["state.zeta = params.v", "emit Set(params.v)"]},
+          "get": {"returns": {"expr": "state.zeta"}},
+          "twice": {"params": ["a"], "returns": "params.a * 2"},
+          "plain": {"logic": "state.alpha = true", "returns": {"type": "int"}},
+          "empty": {}
+        },
+        "events": {
+          "Set": {"params": [{"name": "value", "type": "int"}]},
+          "Mixed": {"params": ["first", {"name": "second"}, {"type": "int"}, 5]},
+          "Bare": {}
+        }
+      }
+    })car", true);
+
+    // 没有 cpl、各段落为空
+    check_parity(R"car({"p": "cardinals", "op": "deploy", "protocol": "bare", "version": "1"})car", true);
+    check_parity(R"car({"p": "cardinals", "cpl": {"state": {}, "methods": {}, "events": {}}})car", true);
+
+    // 非对象的方法和事件定义没有任何字段
+    check_parity(R"car({"cpl": {"methods": {"m": 5, "n": [1, 2]}, "events": {"e": "x", "f": [{"name": "y"}]}}})car", true);
+}
+
+void test_unknown_fields_are_ignored() {
+    check_parity(R"car({
+      "p": "cardinals", "op": "deploy", "protocol": "extras", "version": "1.0",
+      "comment": {"nested": [1, {"a": "b"}, [null, true]]},
+      "tags": ["x", "y"],
+      "revision": 3,
+      "cpl": {
+        "owner": "doge1owner",
+        "notes": [{"state": {"fake": {}}}],
+        "license": "MIT",
+        "state": {
+          "count": {"type": "int", "default": "1", "description": {"text": "counter"}, "bounds": [0, 10]}
+        },
+        "methods": {
+          "inc": {
+            "logic": "state.count = state.count + 1",
+            "doc": {"params": ["ignored"], "logic": "ignored"},
+            "gas": 12,
+            "returns": {"expr": "state.count", "type": "int", "meta": [1]}
+          }
+        },
+        "events": {
+          "Inc": {"indexed": true, "params": [{"name": "count", "type": "int", "extra": [1, {"name": "no"}]}]}
+        }
+      }
+    })car", true);
+}
+
+void test_duplicate_keys_use_the_last_value() {
+    // 段落内的重复键：两条路径都以最后一次为准
+    check_parity(R"car({
+      "p": "cardinals", "op": "deploy", "protocol": "first", "version": "1", "version": "2",
+      "cpl": {
+        "owner": "a", "owner": "b",
+        "state": {
+          "count": {"type": "int", "default": "1"},
+          "flag": {"type": "bool", "type": "string", "default": "x"},
+          "count": {"type": "int", "default": "2"}
+        },
+        "methods": {
+          "run": {"logic": "state.count = 1"},
+          "other": {"returns": "1"},
+          "run": {"params": ["p"], "logic": "state.count = params.p", "logic": ["state.count = 3", "state.count = 4"]}
+        },
+        "events": {
+          "E": {"params": ["a"]},
+          "E": {"params": [{"name": "b"}], "params": ["c", "d"]}
+        }
+      }
+    })car", true);
+
+    // 重复的 cpl 或段落：SAX 无法只保留最后一次，退回 DOM 路径
+    check_parity(R"car({"p": "cardinals", "cpl": {"owner": "a", "state": {"x": {}}}, "cpl": {"owner": "b", "methods": {"m": {"returns": "1"}}}})car", false);
+    check_parity(R"car({"cpl": {"state": {"x": {"type": "int"}}, "state": {"y": {"type": "bool"}}}})car", false);
+    check_parity(R"car({"cpl": {"methods": {"a": {"returns": "1"}}, "methods": {"b": {"returns": "2"}}}})car", false);
+    check_parity(R"car({"cpl": {"events": {"A": {}}, "events": {"B": {"params": ["x"]}}}})car", false);
+}
+
+void test_irregular_structures_fall_back() {
+    // DOM 路径能处理的非常规结构：走退回路径，结果仍一致
+    check_parity(R"car({"cpl": {"events": {"E": {"params": "single"}}}})car", false);
+
+    // DOM 路径拒绝的结构：两条路径都失败
+    check_both_reject(R"car({"p": "cardinals", "version": 1, "cpl": {}})car");
+    check_both_reject(R"car({"cpl": {"owner": {"name": "a"}}})car");
+    check_both_reject(R"car({"cpl": {"state": {"x": {"type": 5}}}})car");
+    check_both_reject(R"car({"cpl": {"state": {"x": 5}}})car");
+    check_both_reject(R"car({"cpl": {"methods": {"m": {"params": "p"}}}})car");
+    check_both_reject(R"car({"cpl": {"methods": {"m": {"params": [1]}}}})car");
+    check_both_reject(R"car({"cpl": {"methods": {"m": {"logic": {"text": "x"}}}}})car");
+    check_both_reject(R"car({"cpl": {"methods": {"m": {"logic": ["a", 1]}}}})car");
+    check_both_reject(R"car({"cpl": {"methods": {"m": {"returns": {"expr": 1}}}}})car");
+    check_both_reject(R"car({"cpl": {"events": {"E": {"params": [{"name": 1}]}}}})car");
+    check_both_reject(R"car({"cpl": "none"})car");
+
+    // 语法错误
+    check_both_reject(R"car({"cpl": {"state": )car");
+    check_both_reject(R"car([1, 2, 3])car");
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing CarLoader..." << std::endl;
+
+    cardity_test::run("SAX and DOM agree on the example protocol", test_example_protocol);
+    cardity_test::run("SAX and DOM agree on synthetic protocols", test_synthetic_protocol);
+    cardity_test::run("unknown fields are ignored", test_unknown_fields_are_ignored);
+    cardity_test::run("duplicate keys use the last value", test_duplicate_keys_use_the_last_value);
+    cardity_test::run("irregular structures fall back to DOM", test_irregular_structures_fall_back);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <unistd.h>
+
+// 测试用例共用的断言和临时文件工具（只用于 runtime/test_*.cpp）
+namespace cardity_test {
+
+inline int& failure_count() {
+    static int failures = 0;
+    return failures;
+}
+
+// 失败时打印位置并计数，不中止当前测试，main 最后按失败数返回
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << "❌ " << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            ++cardity_test::failure_count(); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const auto& actual_value = (actual); \
+        const auto& expected_value = (expected); \
+        if (!(actual_value == expected_value)) { \
+            std::cerr << "❌ " << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #actual ", " #expected ") failed: " \
+                      << actual_value << " != " << expected_value << std::endl; \
+            ++cardity_test::failure_count(); \
+        } \
+    } while (0)
+
+// 运行一个测试函数并打印名称
+inline void run(const char* name, void (*test)()) {
+    int before = failure_count();
+    test();
+    std::cout << (failure_count() == before ? "✅ " : "❌ ") << name << std::endl;
+}
+
+// 汇总结果，作为 main 的返回值
+inline int finish() {
+    if (failure_count() == 0) {
+        std::cout << "\n🎉 All tests passed!" << std::endl;
+        return 0;
+    }
+    std::cerr << "\n❌ " << failure_count() << " check(s) failed" << std::endl;
+    return 1;
+}
+
+// 进程独占的临时文件路径，析构时删除（连同同名前缀的附属文件，如 .compact）
+class TempPath {
+public:
+    explicit TempPath(const std::string& name)
+        : value((std::filesystem::temp_directory_path() /
+                 ("cardity_test_" + std::to_string(::getpid()) + "_" + name)).string()) {
+        remove_all();
+    }
+    ~TempPath() { remove_all(); }
+    
+    TempPath(const TempPath&) = delete;
+    TempPath& operator=(const TempPath&) = delete;
+    
+    const std::string& str() const { return value; }
+    
+private:
+    std::string value;
+    
+    void remove_all() {
+        std::error_code ignored;
+        std::filesystem::remove(value, ignored);
+        std::filesystem::remove(value + ".compact", ignored);
+    }
+};
+
+} // namespace cardity_test
@@ -0,0 +1,211 @@
+#include "flat_hash_map.h"
+#include "test_check.h"
+#include <random>
+#include <vector>
+
+using namespace cardity;
+
+namespace {
+
+// 键的数字后缀（"k17" -> 17）
+uint64_t key_number(std::string_view key) {
+    uint64_t number = 0;
+    for (char c : key.substr(1)) {
+        number = number * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return number;
+}
+
+// 只有 4 个不同的哈希值：大量键落在同一起始桶，形成长簇，标签也相同
+struct CollidingHash {
+    size_t operator()(std::string_view key) const { return static_cast<size_t>(key_number(key) % 4); }
+};
+
+// 哈希值集中在最高位附近：对任意容量起始桶都在表尾，簇必然回绕到表头
+struct WrappingHash {
+    size_t operator()(std::string_view key) const { return ~static_cast<size_t>(key_number(key) % 3); }
+};
+
+std::string key_of(int n) {
+    return "k" + std::to_string(n);
+}
+
+// 参照模型：与 FlatHashMap 相同的插入顺序语义（删除时最后一个条目移到空位）
+class Model {
+public:
+    bool insert(const std::string& key, int value) {
+        for (const auto& entry : entries) {
+            if (entry.first == key) {
+                return false;
+            }
+        }
+        entries.emplace_back(key, value);
+        return true;
+    }
+
+    bool erase(const std::string& key) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].first == key) {
+                entries[i] = entries.back();
+                entries.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::vector<std::pair<std::string, int>>& items() const { return entries; }
+
+private:
+    std::vector<std::pair<std::string, int>> entries;
+};
+
+// 遍历顺序、大小和每个键（包括已删除的键）的查找结果都与模型一致
+template <typename Map>
+void check_matches(const Map& map, const Model& model, int key_space) {
+    CHECK_EQ(map.size(), model.items().size());
+    size_t i = 0;
+    for (const auto& [key, value] : map) {
+        if (i < model.items().size()) {
+            CHECK_EQ(key, model.items()[i].first);
+            CHECK_EQ(value, model.items()[i].second);
+        }
+        ++i;
+    }
+    for (int n = 0; n < key_space; ++n) {
+        std::string key = key_of(n);
+        bool expected = false;
+        for (const auto& entry : model.items()) {
+            expected = expected || entry.first == key;
+        }
+        CHECK_EQ(map.contains(key), expected);
+        if (expected && map.contains(key)) {
+            CHECK_EQ(map.at(key), map.find(key)->second);
+        }
+    }
+}
+
+// 随机插入 / 按键删除 / 按迭代器删除，删除占多数；每一步与模型比较
+template <typename Hash>
+void run_erase_heavy(unsigned seed, int key_space, int steps) {
+    FlatHashMap<int, Hash> map;
+    Model model;
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> pick_key(0, key_space - 1);
+    std::uniform_int_distribution<int> pick_op(0, 9);
+
+    for (int step = 0; step < steps; ++step) {
+        std::string key = key_of(pick_key(random));
+        int op = pick_op(random);
+        if (op < 4) {
+            CHECK_EQ(map.try_emplace(key, step).second, model.insert(key, step));
+        } else if (op < 8) {
+            CHECK_EQ(map.erase(key) == 1, model.erase(key));
+        } else if (!map.empty()) {
+            // 按迭代器删除：返回的迭代器指向移入空位的条目
+            size_t index = static_cast<size_t>(step) % map.size();
+            auto pos = map.begin() + static_cast<std::ptrdiff_t>(index);
+            std::string erased = pos->first;
+            model.erase(erased);
+            auto next = map.erase(pos);
+            if (index < map.size()) {
+                CHECK_EQ(next->first, model.items()[index].first);
+            } else {
+                CHECK(next == map.end());
+            }
+        }
+        check_matches(map, model, key_space);
+    }
+}
+
+void test_basic_operations() {
+    FlatHashMap<int> map;
+    CHECK(map.empty());
+    map["a"] = 1;
+    map["b"] = 2;
+    CHECK(!map.try_emplace("a", 5).second);
+    CHECK_EQ(map.at("a"), 1);
+    map.insert_or_assign("a", 3);
+    CHECK_EQ(map.at("a"), 3);
+    CHECK_EQ(map.erase("missing"), size_t(0));
+    CHECK_EQ(map.erase("a"), size_t(1));
+    CHECK(!map.contains("a"));
+    CHECK_EQ(map.begin()->first, std::string("b"));
+
+    bool threw = false;
+    try {
+        map.at("a");
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void test_erase_heavy_default_hash() {
+    run_erase_heavy<std::hash<std::string_view>>(1, 200, 5000);
+}
+
+void test_erase_heavy_collisions() {
+    run_erase_heavy<CollidingHash>(2, 64, 4000);
+}
+
+void test_erase_heavy_wraparound() {
+    run_erase_heavy<WrappingHash>(3, 64, 4000);
+}
+
+void test_erase_across_wrapped_cluster() {
+    // 8 个桶的表：k0、k3、k6 的起始桶都是最后一个桶，簇为 [7, 0, 1]；k1 的起始桶是 6
+    FlatHashMap<int, WrappingHash> map;
+    map.reserve(4);
+    map["k0"] = 0;
+    map["k3"] = 3;
+    map["k6"] = 6;
+    map["k1"] = 1;
+
+    // 删除簇头之后，回绕到表头的条目必须后移到表尾仍能找到
+    CHECK_EQ(map.erase("k0"), size_t(1));
+    CHECK(map.contains("k3"));
+    CHECK(map.contains("k6"));
+    CHECK(map.contains("k1"));
+    CHECK_EQ(map.erase("k3"), size_t(1));
+    CHECK(map.contains("k6"));
+    CHECK(map.contains("k1"));
+
+    // 插入顺序：k1 移到了 k0 的位置
+    std::vector<std::string> order;
+    for (const auto& entry : map) {
+        order.push_back(entry.first);
+    }
+    CHECK(order == std::vector<std::string>({"k1", "k6"}));
+}
+
+void test_grows_after_erasures() {
+    FlatHashMap<int, CollidingHash> map;
+    for (int round = 0; round < 5; ++round) {
+        for (int n = 0; n < 100; ++n) {
+            map[key_of(n)] = n + round;
+        }
+        for (int n = 0; n < 100; n += 2) {
+            map.erase(key_of(n));
+        }
+        CHECK_EQ(map.size(), size_t(50));
+        for (int n = 1; n < 100; n += 2) {
+            CHECK_EQ(map.at(key_of(n)), n + round);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing FlatHashMap..." << std::endl;
+
+    cardity_test::run("basic operations", test_basic_operations);
+    cardity_test::run("erase-heavy sequence (default hash)", test_erase_heavy_default_hash);
+    cardity_test::run("erase-heavy sequence (colliding hash)", test_erase_heavy_collisions);
+    cardity_test::run("erase-heavy sequence (wrapping clusters)", test_erase_heavy_wraparound);
+    cardity_test::run("erase across a wrapped cluster", test_erase_across_wrapped_cluster);
+    cardity_test::run("reinsert after erasures", test_grows_after_erasures);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,260 @@
+#include "logic_engine.h"
+#include "test_check.h"
+
+using namespace cardity;
+
+namespace {
+
+// 带内存状态的引擎：状态变量 a=2、b=3、c=4、flag=true
+struct EngineFixture {
+    StateManager state;
+    LogicEngine engine;
+
+    EngineFixture() : engine(std::make_unique<StateVariableResolver>(&state)) {
+        state.set_int("a", 2);
+        state.set_int("b", 3);
+        state.set_int("c", 4);
+        state.set_value("flag", StateValue::from_bool(true));
+    }
+
+    int64_t eval(const std::string& expression) { return engine.evaluate_value(*parse(expression)).to_int64(); }
+    bool truth(const std::string& expression) { return engine.evaluate_value(*parse(expression)).to_bool(); }
+
+    ExpressionNode* parse(const std::string& expression) { return LogicEngine::parse_expression(expression, arena); }
+
+    Arena arena;
+};
+
+bool is_binary(const ExpressionNode* node, OperatorType op) {
+    return node && node->type == ExpressionType::BINARY_OP && node->op == op;
+}
+
+bool is_variable(const ExpressionNode* node, const char* name) {
+    return node && node->type == ExpressionType::VARIABLE && node->value == name;
+}
+
+bool is_literal(const ExpressionNode* node, int64_t value) {
+    return node && node->type == ExpressionType::LITERAL && node->constant.to_int64() == value;
+}
+
+void test_precedence() {
+    EngineFixture fixture;
+
+    // a + b * c 解析为 a + (b * c)
+    ExpressionNode* node = fixture.parse("a + b * c");
+    CHECK(is_binary(node, OperatorType::ADD));
+    CHECK(is_variable(node->left, "a"));
+    CHECK(is_binary(node->right, OperatorType::MUL));
+
+    // 比较低于算术，&& 低于比较，|| 最低
+    node = fixture.parse("a + b < c || a == b && flag");
+    CHECK(is_binary(node, OperatorType::OR));
+    CHECK(is_binary(node->left, OperatorType::LT));
+    CHECK(is_binary(node->left->left, OperatorType::ADD));
+    CHECK(is_binary(node->right, OperatorType::AND));
+    CHECK(is_binary(node->right->left, OperatorType::EQ));
+
+    CHECK_EQ(fixture.eval("a + b * c"), int64_t(14));
+    CHECK_EQ(fixture.eval("(a + b) * c"), int64_t(20));
+    CHECK_EQ(fixture.eval("a * b + c * a"), int64_t(14));
+    CHECK_EQ(fixture.eval("c - a * b"), int64_t(-2));
+    CHECK_EQ(fixture.eval("c % b + a"), int64_t(3));
+    CHECK_EQ(fixture.eval("-a * b"), int64_t(-6));
+    CHECK(fixture.truth("a + b == 5 && c > a"));
+    CHECK(fixture.truth("a > b || b < c && flag"));
+    CHECK(!fixture.truth("!flag || a == b"));
+    CHECK(fixture.truth("!(a == b)"));
+}
+
+void test_left_associativity() {
+    EngineFixture fixture;
+
+    // a - b - c 解析为 (a - b) - c
+    ExpressionNode* node = fixture.parse("a - b - c");
+    CHECK(is_binary(node, OperatorType::SUB));
+    CHECK(is_binary(node->left, OperatorType::SUB));
+    CHECK(is_variable(node->right, "c"));
+
+    CHECK_EQ(fixture.eval("a - b - c"), int64_t(-5));
+    CHECK_EQ(fixture.eval("c - b + a"), int64_t(3));
+    CHECK_EQ(fixture.eval("c * b / a"), int64_t(6));
+    CHECK_EQ(fixture.eval("c / a * b"), int64_t(6));
+    CHECK_EQ(fixture.eval("100 - c - b - a"), int64_t(91));
+    CHECK_EQ(fixture.eval("a - (b - c)"), int64_t(3));
+
+    node = fixture.parse("a == b == flag");
+    CHECK(is_binary(node, OperatorType::EQ));
+    CHECK(is_binary(node->left, OperatorType::EQ));
+}
+
+void test_constant_folding() {
+    EngineFixture fixture;
+
+    // 只含字面量的表达式折叠为一个字面量节点
+    CHECK(is_literal(fixture.parse("1 + 2 * 3"), 7));
+    CHECK(is_literal(fixture.parse("(1 + 2) * 3"), 9));
+    CHECK(is_literal(fixture.parse("10 - 4 - 3"), 3));
+    CHECK(is_literal(fixture.parse("-(2 * 5)"), -10));
+
+    ExpressionNode* node = fixture.parse("1 < 2 && !(3 == 4)");
+    CHECK(node->type == ExpressionType::LITERAL);
+    CHECK(node->constant.to_bool());
+
+    // 含变量时只折叠字面量子树
+    node = fixture.parse("a + 2 * 3");
+    CHECK(is_binary(node, OperatorType::ADD));
+    CHECK(is_variable(node->left, "a"));
+    CHECK(is_literal(node->right, 6));
+    CHECK_EQ(fixture.eval("a + 2 * 3"), int64_t(8));
+
+    // 左操作数为字面量且能决定结果时，&& / || 折叠掉右操作数
+    node = fixture.parse("0 && a");
+    CHECK(node->type == ExpressionType::LITERAL);
+    CHECK(!node->constant.to_bool());
+    node = fixture.parse("1 || a");
+    CHECK(node->type == ExpressionType::LITERAL);
+    CHECK(node->constant.to_bool());
+    CHECK(is_binary(fixture.parse("a && 0"), OperatorType::AND));
+}
+
+void test_literal_if_removes_dead_branch() {
+    // 假条件：整个条件语句在编译时删除
+    auto program = LogicEngine::compile_program("if (1 > 2) { state.a = 10 }; state.b = 20");
+    CHECK_EQ(program->statements.size(), size_t(1));
+    CHECK(program->statements[0].type == StatementType::ASSIGNMENT);
+    CHECK_EQ(program->statements[0].target, std::string("state.b"));
+
+    // 真条件：条件体展开到外层
+    program = LogicEngine::compile_program("if (1 == 1) { state.a = 10; state.c = 30 }");
+    CHECK_EQ(program->statements.size(), size_t(2));
+    CHECK(program->statements[0].type == StatementType::ASSIGNMENT);
+    CHECK(program->statements[1].type == StatementType::ASSIGNMENT);
+
+    // 条件依赖状态：保留条件语句
+    program = LogicEngine::compile_program("if (state.flag) { state.a = 10 }");
+    CHECK_EQ(program->statements.size(), size_t(1));
+    CHECK(program->statements[0].type == StatementType::CONDITIONAL);
+    CHECK_EQ(program->statements[0].body.size(), size_t(1));
+
+    // 执行结果与按条件解释执行一致
+    EngineFixture fixture;
+    fixture.engine.execute_program(*LogicEngine::compile_program(
+        "if (0) { state.a = 100 }; if (2 > 1) { state.b = 200 }; if (state.flag) { state.c = 300 }"));
+    CHECK_EQ(fixture.state.get_int("a"), 2);
+    CHECK_EQ(fixture.state.get_int("b"), 200);
+    CHECK_EQ(fixture.state.get_int("c"), 300);
+}
+
+// 记录 emit 的事件
+class RecordingSink : public EventSink {
+public:
+    std::vector<std::pair<std::string, std::vector<std::string>>> events;
+
+    void emit(std::string_view name, std::vector<std::string>&& values) override {
+        events.emplace_back(std::string(name), std::move(values));
+    }
+};
+
+// 同一逻辑分别预编译执行和逐条解释执行：gas、状态和事件都相同
+void check_paths_agree(const std::string& logic) {
+    EngineFixture compiled;
+    RecordingSink compiled_events;
+    compiled.engine.set_event_sink(&compiled_events);
+    compiled.engine.start_metering(0);
+    std::string compiled_result = compiled.engine.execute_program(*LogicEngine::compile_program(logic));
+
+    EngineFixture interpreted;
+    RecordingSink interpreted_events;
+    interpreted.engine.set_event_sink(&interpreted_events);
+    interpreted.engine.start_metering(0);
+    std::string interpreted_result = interpreted.engine.execute_method_logic(logic, {});
+
+    CHECK(compiled.engine.get_gas_used() > 0);
+    CHECK_EQ(interpreted.engine.get_gas_used(), compiled.engine.get_gas_used());
+    CHECK_EQ(interpreted_result, compiled_result);
+    CHECK(interpreted_events.events == compiled_events.events);
+    for (const char* key : {"a", "b", "c", "d", "flag"}) {
+        CHECK(interpreted.state.get_value(key) == compiled.state.get_value(key));
+    }
+}
+
+void test_interpreter_gas_matches_compiled() {
+    check_paths_agree("state.a = a + 1; state.b = a * b");
+    check_paths_agree("if (flag) { state.a = 10 }; a + b");
+
+    // 字面量条件：编译时被删除或展开，解释执行同样不为条件本身收费
+    check_paths_agree("if (0) { state.a = 100 }; state.b = 1");
+    check_paths_agree("if (1 + 1 == 2) { state.a = 100; state.c = a + c }");
+    check_paths_agree("if (1) { if (0) { state.a = 1 }; if (flag) { state.d = 4 } }; a");
+    check_paths_agree("if (2 > 1) { emit Touched(a, \"x\") }; if (0 || 0) { emit Skipped() }");
+}
+
+void test_interpreter_records_events() {
+    EngineFixture fixture;
+    RecordingSink sink;
+    fixture.engine.set_event_sink(&sink);
+    fixture.engine.execute_method_logic("state.a = a + 5; emit Changed(a, a * 2, \"done\"); emit Empty()", {});
+
+    CHECK_EQ(sink.events.size(), size_t(2));
+    if (sink.events.size() == 2) {
+        CHECK_EQ(sink.events[0].first, std::string("Changed"));
+        CHECK(sink.events[0].second == std::vector<std::string>({"7", "14", "done"}));
+        CHECK_EQ(sink.events[1].first, std::string("Empty"));
+        CHECK(sink.events[1].second.empty());
+    }
+
+    check_paths_agree("emit Changed(a, b + c); state.a = 1; emit Changed(a)");
+}
+
+// n 条把 s 翻倍的语句
+std::string doubling_logic(int n) {
+    std::string logic;
+    for (int i = 0; i < n; ++i) {
+        logic += (i ? "; " : "") + std::string("state.s = s + s");
+    }
+    return logic;
+}
+
+void test_string_growth_is_metered() {
+    // 每条语句 4 个节点的固定收费，另按拼接结果每 32 字节收 1：
+    // 长度 2 的字符串翻倍 10 次，结果长度 4..2048，额外收取 0+0+0+1+2+4+8+16+32+64
+    EngineFixture unlimited;
+    unlimited.state.set("s", "ab");
+    unlimited.engine.start_metering(0);
+    unlimited.engine.execute_program(*LogicEngine::compile_program(doubling_logic(10)));
+    CHECK_EQ(unlimited.state.get_string("s").size(), size_t(2048));
+    CHECK_EQ(unlimited.engine.get_gas_used(), uint64_t(40 + 127));
+
+    // 22 次翻倍会得到 8 MB 的字符串：在 gas 上限内中止，已分配的长度受上限约束
+    const uint64_t limit = 10000;
+    EngineFixture limited;
+    limited.state.set("s", "ab");
+    limited.engine.start_metering(limit);
+    bool out_of_gas = false;
+    try {
+        limited.engine.execute_program(*LogicEngine::compile_program(doubling_logic(22)));
+    } catch (const OutOfGasError&) {
+        out_of_gas = true;
+    }
+    CHECK(out_of_gas);
+    CHECK(limited.state.get_string("s").size() <= limit * LogicEngine::STRING_BYTES_PER_GAS);
+
+    // 解释执行收取同样的 gas
+    check_paths_agree("state.d = \"0123456789abcdef0123456789abcdef\"; state.d = d + d; state.d = d + d; state.d = d + a");
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing LogicEngine..." << std::endl;
+
+    cardity_test::run("operator precedence", test_precedence);
+    cardity_test::run("left associativity", test_left_associativity);
+    cardity_test::run("constant folding", test_constant_folding);
+    cardity_test::run("literal if removes the dead branch", test_literal_if_removes_dead_branch);
+    cardity_test::run("interpreted gas matches compiled programs", test_interpreter_gas_matches_compiled);
+    cardity_test::run("interpreted emit records events", test_interpreter_records_events);
+    cardity_test::run("string growth is metered", test_string_growth_is_metered);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,311 @@
+#include "mmap_state_store.h"
+#include "binary_codec.h"
+#include "wal_state_store.h"
+#include "test_check.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <vector>
+
+using namespace cardity;
+using cardity_test::TempPath;
+
+namespace {
+
+const int IMAGE_KEYS = 1000;
+
+// 混合类型的值，便于检查类型在镜像中保留
+StateValue value_for(int i) {
+    switch (i % 4) {
+        case 0: return StateValue::from_int(i * 7);
+        case 1: return StateValue::from_string("value-" + std::to_string(i));
+        case 2: return StateValue::from_bool(i % 3 == 0);
+        default: return StateValue::from_float(i + 0.25);
+    }
+}
+
+std::string key_for(int i) {
+    return "key/" + std::to_string(i);
+}
+
+void write_sample_image(const std::string& path) {
+    MemoryStateStore source;
+    for (int i = 0; i < IMAGE_KEYS; ++i) {
+        source.set_value(key_for(i), value_for(i));
+    }
+    CHECK(MmapStateStore::write_image(path, source));
+}
+
+// 读入整个镜像文件，修改后写回
+void rewrite(const std::string& path, void (*edit)(std::string&)) {
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    edit(data);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+void test_write_reopen_and_lookup() {
+    TempPath image("lookup.img");
+    write_sample_image(image.str());
+
+    MmapStateStore store;
+    CHECK(store.open(image.str()));
+    CHECK_EQ(store.get_image_entry_count(), uint64_t(IMAGE_KEYS));
+    CHECK_EQ(store.size(), size_t(IMAGE_KEYS));
+
+    // 每个键都经磁盘索引找到，类型和值保持不变
+    for (int i = 0; i < IMAGE_KEYS; ++i) {
+        CHECK(store.has_key(key_for(i)));
+        StateValue value = store.get_value(key_for(i));
+        CHECK(value == value_for(i));
+        CHECK(value.type() == value_for(i).type());
+    }
+
+    size_t visited = 0;
+    store.for_each([&visited](const std::string&, const StateValue&) { ++visited; });
+    CHECK_EQ(visited, size_t(IMAGE_KEYS));
+}
+
+void test_lookup_misses() {
+    TempPath image("miss.img");
+    write_sample_image(image.str());
+
+    MmapStateStore store;
+    CHECK(store.open(image.str()));
+    for (const std::string& missing : {std::string("key/1000"), std::string("key/"), std::string("key"),
+                                       std::string(""), std::string("key/1x"), std::string("KEY/1")}) {
+        CHECK(!store.has_key(missing));
+        CHECK(store.get_value(missing) == StateValue());
+    }
+    for (int i = IMAGE_KEYS; i < IMAGE_KEYS * 2; ++i) {
+        CHECK(!store.has_key(key_for(i)));
+    }
+}
+
+void test_empty_image() {
+    TempPath image("empty.img");
+    MemoryStateStore source;
+    CHECK(MmapStateStore::write_image(image.str(), source));
+
+    MmapStateStore store;
+    CHECK(store.open(image.str()));
+    CHECK_EQ(store.size(), size_t(0));
+    CHECK(!store.has_key("anything"));
+}
+
+void test_overlay_and_compact() {
+    TempPath image("compact.img");
+    TempPath compacted("compacted.img");
+    write_sample_image(image.str());
+
+    MmapStateStore store;
+    CHECK(store.open(image.str()));
+    store.set_value(key_for(0), StateValue::from_string("changed"));
+    store.remove_key(key_for(1));
+    store.set_value("extra", StateValue::from_int(1));
+    CHECK_EQ(store.size(), size_t(IMAGE_KEYS));
+    CHECK(!store.has_key(key_for(1)));
+
+    CHECK(store.compact(compacted.str()));
+    CHECK_EQ(store.get_overlay()->size(), size_t(0));
+    CHECK_EQ(store.get_image_entry_count(), uint64_t(IMAGE_KEYS));
+
+    MmapStateStore reopened;
+    CHECK(reopened.open(compacted.str()));
+    CHECK(reopened.get_value(key_for(0)) == StateValue::from_string("changed"));
+    CHECK(!reopened.has_key(key_for(1)));
+    CHECK(reopened.get_value("extra") == StateValue::from_int(1));
+    CHECK(reopened.get_value(key_for(2)) == value_for(2));
+
+    // clear 隐藏整个镜像
+    reopened.clear();
+    CHECK_EQ(reopened.size(), size_t(0));
+    CHECK(!reopened.has_key(key_for(2)));
+}
+
+// 以 WAL 为覆盖层打开镜像（日志重放出之前的墓碑和清空标记）
+std::unique_ptr<MmapStateStore> open_with_log(const std::string& image, const std::string& log) {
+    auto wal = std::make_unique<WalStateStore>();
+    CHECK(wal->open(log));
+    auto store = std::make_unique<MmapStateStore>(std::move(wal));
+    CHECK(store->open(image));
+    return store;
+}
+
+void test_overlay_markers_survive_reopen() {
+    TempPath image("markers.img");
+    TempPath log("markers.wal");
+    write_sample_image(image.str());
+
+    {
+        auto store = open_with_log(image.str(), log.str());
+        store->remove_key(key_for(3));
+        store->remove_key(key_for(4));
+        store->set_value(key_for(4), StateValue::from_string("back"));
+        CHECK(store->flush());
+    }
+    {
+        auto store = open_with_log(image.str(), log.str());
+        CHECK(!store->has_key(key_for(3)));
+        CHECK(store->get_value(key_for(3)) == StateValue());
+        CHECK(store->get_value(key_for(4)) == StateValue::from_string("back"));
+        CHECK(store->get_value(key_for(5)) == value_for(5));
+        CHECK_EQ(store->size(), size_t(IMAGE_KEYS - 1));
+
+        // 重新写入被删除的键后墓碑失效
+        store->set_value(key_for(3), StateValue::from_int(3));
+        store->clear();
+        store->set_value("after", StateValue::from_int(1));
+        CHECK(store->flush());
+    }
+    {
+        auto store = open_with_log(image.str(), log.str());
+        CHECK(!store->has_key(key_for(5)));
+        CHECK(!store->has_key(key_for(3)));
+        CHECK_EQ(store->size(), size_t(1));
+        CHECK(store->get_value("after") == StateValue::from_int(1));
+    }
+}
+
+void test_truncated_image_is_rejected() {
+    TempPath image("truncated.img");
+    write_sample_image(image.str());
+    uint64_t size = std::filesystem::file_size(image.str());
+
+    MmapStateStore store;
+    std::filesystem::resize_file(image.str(), size - 1);
+    CHECK(!store.open(image.str()));
+    CHECK(!store.is_open());
+
+    // 比文件头还短
+    std::filesystem::resize_file(image.str(), 20);
+    CHECK(!store.open(image.str()));
+
+    CHECK(!store.open(image.str() + ".does-not-exist"));
+}
+
+void test_corrupt_header_is_rejected() {
+    TempPath image("header.img");
+    MmapStateStore store;
+
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) { data[0] = 'X'; });
+    CHECK(!store.open(image.str()));
+
+    // 版本号
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) { data[4] = 9; });
+    CHECK(!store.open(image.str()));
+
+    // 桶数不是 2 的幂
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) { data[16] = static_cast<char>(data[16] + 1); });
+    CHECK(!store.open(image.str()));
+
+    // 记录的文件大小与实际不符
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) { data.append(16, '\0'); });
+    CHECK(!store.open(image.str()));
+}
+
+void test_corrupt_records_do_not_crash() {
+    TempPath image("records.img");
+    write_sample_image(image.str());
+
+    // 数据区的每条记录键长改为巨大值：文件头仍然有效，查找只能失败
+    rewrite(image.str(), [](std::string& data) {
+        uint64_t data_offset = 0;
+        for (int i = 0; i < 8; ++i) {
+            data_offset |= static_cast<uint64_t>(static_cast<uint8_t>(data[32 + i])) << (8 * i);
+        }
+        for (size_t pos = data_offset; pos < data.size(); ++pos) {
+            data[pos] = static_cast<char>(0xFF);
+        }
+    });
+
+    MmapStateStore store;
+    CHECK(store.open(image.str()));
+    for (int i = 0; i < 50; ++i) {
+        CHECK(!store.has_key(key_for(i)));
+        CHECK(store.get_value(key_for(i)) == StateValue());
+    }
+    size_t visited = 0;
+    store.for_each([&visited](const std::string&, const StateValue&) { ++visited; });
+    CHECK_EQ(visited, size_t(0));
+}
+
+// 索引中非空桶的偏移字段在文件中的位置
+std::vector<size_t> occupied_offset_slots(const std::string& data) {
+    std::vector<size_t> slots;
+    uint64_t buckets = get_u64(data.data() + 16);
+    uint64_t index_start = get_u64(data.data() + 24);
+    for (uint64_t bucket = 0; bucket < buckets; ++bucket) {
+        size_t slot = index_start + bucket * 16 + 8;
+        if (get_u64(data.data() + slot) != 0) {
+            slots.push_back(slot);
+        }
+    }
+    return slots;
+}
+
+void overwrite_u64(std::string& data, size_t pos, uint64_t value) {
+    std::string encoded;
+    put_u64(encoded, value);
+    data.replace(pos, encoded.size(), encoded);
+}
+
+void test_corrupt_index_offsets_are_rejected() {
+    TempPath image("index.img");
+    MmapStateStore store;
+
+    // 每个非空偏移加上 2^40：远超文件末尾（查找时的减法会下溢）
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) {
+        for (size_t slot : occupied_offset_slots(data)) {
+            overwrite_u64(data, slot, get_u64(data.data() + slot) + (uint64_t(1) << 40));
+        }
+    });
+    CHECK(!store.open(image.str()));
+    CHECK(!store.is_open());
+
+    // 偏移落在文件最后两个字节，放不下键长字段
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) {
+        overwrite_u64(data, occupied_offset_slots(data).front(), data.size() - 2);
+    });
+    CHECK(!store.open(image.str()));
+
+    // 偏移指回索引区
+    write_sample_image(image.str());
+    rewrite(image.str(), [](std::string& data) {
+        overwrite_u64(data, occupied_offset_slots(data).back(), get_u64(data.data() + 24));
+    });
+    CHECK(!store.open(image.str()));
+
+    // 未损坏的镜像仍然可以打开
+    write_sample_image(image.str());
+    CHECK(store.open(image.str()));
+    CHECK(store.get_value(key_for(7)) == value_for(7));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing MmapStateStore..." << std::endl;
+
+    cardity_test::run("write, reopen and look up through the index", test_write_reopen_and_lookup);
+    cardity_test::run("lookups that miss", test_lookup_misses);
+    cardity_test::run("empty image", test_empty_image);
+    cardity_test::run("overlay writes and compaction", test_overlay_and_compact);
+    cardity_test::run("overlay markers survive reopening the log", test_overlay_markers_survive_reopen);
+    cardity_test::run("truncated image is rejected", test_truncated_image_is_rejected);
+    cardity_test::run("corrupt header is rejected", test_corrupt_header_is_rejected);
+    cardity_test::run("corrupt records do not crash lookups", test_corrupt_records_do_not_crash);
+    cardity_test::run("corrupt index offsets are rejected", test_corrupt_index_offsets_are_rejected);
+
+    return cardity_test::finish();
+}
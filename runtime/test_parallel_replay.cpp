@@ -0,0 +1,213 @@
+#include "parallel_replay.h"
+#include "test_check.h"
+#include <set>
+
+using namespace cardity;
+
+namespace {
+
+const char* PROTOCOL_PATH = "test_data/hello_cardinals.car";
+
+// 相互冲突的调用：increment 读写 count 并读取 active，toggle 改变 active，set_msg 只写 msg
+std::vector<MethodCall> conflicting_calls() {
+    std::vector<MethodCall> calls;
+    for (int i = 0; i < 40; ++i) {
+        calls.push_back(MethodCall("increment", {}));
+        if (i % 7 == 3) {
+            calls.push_back(MethodCall("toggle", {}));
+        }
+        if (i % 5 == 0) {
+            calls.push_back(MethodCall("set_msg", {"msg-" + std::to_string(i)}));
+        }
+        if (i % 9 == 0) {
+            calls.push_back(MethodCall("get_count", {}));
+        }
+    }
+    calls.push_back(MethodCall("set_msg", {}));     // 参数数量错误，失败且不产生事件
+    return calls;
+}
+
+struct EventRecord {
+    std::string name;
+    std::vector<std::string> values;
+
+    bool operator==(const EventRecord& other) const { return name == other.name && values == other.values; }
+};
+
+std::vector<EventRecord> events_of(const CardityRuntime& runtime) {
+    std::vector<EventRecord> events;
+    runtime.for_each_event([&events](const EventInstance& event) {
+        events.push_back(EventRecord{event.name(), event.values});
+    });
+    return events;
+}
+
+// 按顺序逐个 call_method 的参照结果与并行重放的结果：状态、事件序列和每个调用的结果都相同
+void check_matches_sequential(ParallelReplay& replay, CardityRuntime& parallel, const std::vector<MethodCall>& calls) {
+    CardityRuntime sequential(parallel.get_config());
+    CHECK(sequential.load_protocol(PROTOCOL_PATH));
+    std::vector<MethodResult> expected;
+    for (const auto& call : calls) {
+        expected.push_back(sequential.call_method(call.method, call.args));
+    }
+
+    std::vector<MethodResult> results = replay.replay(calls);
+    CHECK_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size() && i < expected.size(); ++i) {
+        CHECK_EQ(results[i].success, expected[i].success);
+        CHECK_EQ(results[i].return_value, expected[i].return_value);
+        CHECK_EQ(results[i].events.size(), expected[i].events.size());
+        CHECK_EQ(results[i].gas_used, expected[i].gas_used);
+    }
+
+    CHECK(parallel.get_all_state() == sequential.get_all_state());
+    CHECK(events_of(parallel) == events_of(sequential));
+    CHECK_EQ(replay.get_stats().calls, calls.size());
+    CHECK_EQ(replay.get_stats().speculative + replay.get_stats().reexecuted, calls.size());
+}
+
+// 把指定方法的推测结果标记为读取全部状态或包含不支持的操作
+class FlaggingReplay : public ParallelReplay {
+public:
+    FlaggingReplay(CardityRuntime& runtime, RuntimeExecutor& executor, std::set<std::string> read_all,
+                   std::set<std::string> unsupported)
+        : ParallelReplay(runtime, executor), read_all_methods(std::move(read_all)),
+          unsupported_methods(std::move(unsupported)) {}
+
+protected:
+    void classify(const MethodCall& call, bool& read_all, bool& unsupported) const override {
+        read_all = read_all || read_all_methods.count(call.method) > 0;
+        unsupported = unsupported || unsupported_methods.count(call.method) > 0;
+    }
+
+private:
+    std::set<std::string> read_all_methods;
+    std::set<std::string> unsupported_methods;
+};
+
+void test_conflicting_calls_match_sequential() {
+    CardityRuntime runtime;
+    CHECK(runtime.load_protocol(PROTOCOL_PATH));
+    RuntimeExecutor executor(4);
+    ParallelReplay replay(runtime, executor);
+
+    std::vector<MethodCall> calls = conflicting_calls();
+    check_matches_sequential(replay, runtime, calls);
+
+    // increment 之间互相冲突：除第一个外都要重新执行
+    CHECK(replay.get_stats().reexecuted > 0);
+    CHECK(replay.get_stats().speculative > 0);
+}
+
+void test_replay_continues_from_committed_state() {
+    CardityRuntime runtime;
+    CHECK(runtime.load_protocol(PROTOCOL_PATH));
+    RuntimeExecutor executor(3);
+    ParallelReplay replay(runtime, executor);
+
+    // 两批重放之间主运行时的状态已改变，第二批的推测执行必须基于新状态
+    std::vector<MethodCall> first = conflicting_calls();
+    std::vector<MethodCall> second = {MethodCall("increment", {}), MethodCall("get_count", {}),
+                                      MethodCall("toggle", {}), MethodCall("increment", {})};
+    replay.replay(first);
+    std::vector<MethodResult> results = replay.replay(second);
+
+    CardityRuntime sequential;
+    CHECK(sequential.load_protocol(PROTOCOL_PATH));
+    for (const auto& call : first) {
+        sequential.call_method(call.method, call.args);
+    }
+    for (size_t i = 0; i < second.size(); ++i) {
+        MethodResult expected = sequential.call_method(second[i].method, second[i].args);
+        CHECK_EQ(results[i].return_value, expected.return_value);
+    }
+    CHECK(runtime.get_all_state() == sequential.get_all_state());
+    CHECK(events_of(runtime) == events_of(sequential));
+}
+
+void test_read_all_calls_fall_back_to_sequential() {
+    CardityRuntime runtime;
+    CHECK(runtime.load_protocol(PROTOCOL_PATH));
+    RuntimeExecutor executor(4);
+    FlaggingReplay replay(runtime, executor, {"get_count", "set_msg"}, {});
+
+    std::vector<MethodCall> calls = conflicting_calls();
+    check_matches_sequential(replay, runtime, calls);
+
+    // 读取全部状态的调用在前面有提交时不能采用推测结果
+    size_t flagged_after_first = 0;
+    for (size_t i = 1; i < calls.size(); ++i) {
+        flagged_after_first += calls[i].method == "get_count" || calls[i].method == "set_msg" ? 1 : 0;
+    }
+    CHECK(replay.get_stats().reexecuted >= flagged_after_first);
+}
+
+void test_unsupported_calls_fall_back_to_sequential() {
+    CardityRuntime runtime;
+    CHECK(runtime.load_protocol(PROTOCOL_PATH));
+    RuntimeExecutor executor(4);
+    FlaggingReplay replay(runtime, executor, {}, {"toggle"});
+
+    std::vector<MethodCall> calls = conflicting_calls();
+    check_matches_sequential(replay, runtime, calls);
+
+    // 不支持的调用直接在主运行时上执行，之后所有读过状态的推测结果都作废
+    size_t first_toggle = 0;
+    while (calls[first_toggle].method != "toggle") {
+        ++first_toggle;
+    }
+    CHECK(replay.get_stats().reexecuted >= calls.size() - first_toggle - 1);
+}
+
+void test_config_changes_reach_workers() {
+    CardityRuntime runtime;
+    CHECK(runtime.load_protocol(PROTOCOL_PATH));
+    RuntimeExecutor executor(4);
+    ParallelReplay replay(runtime, executor);
+
+    // 构造之后才设置 gas 上限并开启指标：工作实例必须使用新配置
+    RuntimeConfig config = runtime.get_config();
+    config.gas_limit = 1;
+    config.enable_metrics = true;
+    runtime.set_config(config);
+
+    std::vector<MethodCall> calls = conflicting_calls();
+    check_matches_sequential(replay, runtime, calls);
+    CHECK(replay.get_stats().speculative > 0);
+
+    std::vector<MethodResult> results = replay.replay({MethodCall("increment", {})});
+    CHECK(!results[0].success);
+    CHECK_EQ(results[0].gas_used, uint64_t(1));
+
+    // 采用推测结果的调用同样计入主运行时的指标，与顺序执行相同（延迟除外）
+    CardityRuntime sequential(config);
+    CHECK(sequential.load_protocol(PROTOCOL_PATH));
+    for (const auto& call : calls) {
+        sequential.call_method(call.method, call.args);
+    }
+    sequential.call_method("increment", {});
+
+    json actual = runtime.get_metrics()["methods"];
+    json expected = sequential.get_metrics()["methods"];
+    CHECK_EQ(actual.size(), expected.size());
+    for (const auto& [method, metrics] : expected.items()) {
+        for (const char* field : {"calls", "failures", "events", "gas", "statements", "state_reads", "state_writes"}) {
+            CHECK(actual[method][field] == metrics[field]);
+        }
+        CHECK(actual[method]["latency"]["count"] == metrics["latency"]["count"]);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing ParallelReplay..." << std::endl;
+
+    cardity_test::run("conflicting calls match sequential execution", test_conflicting_calls_match_sequential);
+    cardity_test::run("replay continues from committed state", test_replay_continues_from_committed_state);
+    cardity_test::run("read-all calls fall back to sequential", test_read_all_calls_fall_back_to_sequential);
+    cardity_test::run("unsupported calls fall back to sequential", test_unsupported_calls_fall_back_to_sequential);
+    cardity_test::run("config changes reach the workers", test_config_changes_reach_workers);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,93 @@
+#include "sha256.h"
+#include "test_check.h"
+#include <vector>
+
+using namespace cardity;
+
+namespace {
+
+// FIPS 180-2 附录 B 的测试向量
+struct Vector {
+    std::string input;
+    const char* digest;
+};
+
+std::vector<Vector> fips_vectors() {
+    return {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+}
+
+std::string hash_with(Sha256::Implementation implementation, std::string_view data) {
+    Sha256 hasher(implementation);
+    hasher.update(data);
+    return Sha256::to_hex(hasher.finish());
+}
+
+// 按 chunk 字节分段输入，覆盖缓冲中的不完整分组和跨分组边界
+std::string hash_in_chunks(Sha256::Implementation implementation, std::string_view data, size_t chunk) {
+    Sha256 hasher(implementation);
+    for (size_t offset = 0; offset < data.size(); offset += chunk) {
+        hasher.update(data.substr(offset, chunk));
+    }
+    return Sha256::to_hex(hasher.finish());
+}
+
+void check_vectors(Sha256::Implementation implementation) {
+    for (const auto& vector : fips_vectors()) {
+        CHECK_EQ(hash_with(implementation, vector.input), std::string(vector.digest));
+        for (size_t chunk : {1, 3, 55, 63, 64, 65, 1000}) {
+            CHECK_EQ(hash_in_chunks(implementation, vector.input, chunk), std::string(vector.digest));
+        }
+    }
+}
+
+void test_portable_vectors() {
+    check_vectors(Sha256::Implementation::PORTABLE);
+}
+
+void test_hardware_vectors() {
+    if (!Sha256::hardware_available()) {
+        std::cout << "   (SHA-NI not available on this CPU, hardware path falls back to portable)" << std::endl;
+    }
+    check_vectors(Sha256::Implementation::HARDWARE);
+}
+
+void test_default_matches_portable() {
+    CHECK_EQ(Sha256::hex("abc"), std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+    // 填充边界附近的每个长度：两条路径结果相同
+    std::string data;
+    for (size_t length = 0; length < 200; ++length) {
+        CHECK_EQ(hash_with(Sha256::Implementation::HARDWARE, data), hash_with(Sha256::Implementation::PORTABLE, data));
+        CHECK_EQ(Sha256::hex(data), hash_with(Sha256::Implementation::PORTABLE, data));
+        data.push_back(static_cast<char>(length * 31 + 7));
+    }
+}
+
+void test_reset_reuses_hasher() {
+    Sha256 hasher;
+    hasher.update("garbage");
+    hasher.finish();
+    hasher.reset();
+    hasher.update("abc");
+    CHECK_EQ(Sha256::to_hex(hasher.finish()),
+             std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing Sha256..." << std::endl;
+
+    cardity_test::run("FIPS 180-2 vectors (portable)", test_portable_vectors);
+    cardity_test::run("FIPS 180-2 vectors (SHA-NI)", test_hardware_vectors);
+    cardity_test::run("hardware and portable paths agree", test_default_matches_portable);
+    cardity_test::run("reset reuses the hasher", test_reset_reuses_hasher);
+
+    return cardity_test::finish();
+}
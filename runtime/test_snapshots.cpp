@@ -0,0 +1,194 @@
+#include "runtime.h"
+#include "test_check.h"
+
+using namespace cardity;
+
+namespace {
+
+const char* PROTOCOL_PATH = "test_data/hello_cardinals.car";
+
+struct SequencedEvent {
+    uint64_t sequence;
+    std::string name;
+    std::vector<std::string> values;
+
+    bool operator==(const SequencedEvent& other) const {
+        return sequence == other.sequence && name == other.name && values == other.values;
+    }
+};
+
+std::vector<SequencedEvent> events_of(const CardityRuntime& runtime) {
+    std::vector<SequencedEvent> events;
+    runtime.for_each_event_since(0, [&events](uint64_t sequence, const EventInstance& event) {
+        events.push_back(SequencedEvent{sequence, event.name(), event.values});
+    });
+    return events;
+}
+
+std::unique_ptr<CardityRuntime> make_runtime(const RuntimeConfig& config = RuntimeConfig()) {
+    auto runtime = std::make_unique<CardityRuntime>(config);
+    CHECK(runtime->load_protocol(PROTOCOL_PATH));
+    return runtime;
+}
+
+// 快照经 JSON 往返后恢复（与持久化后恢复的路径相同）
+Snapshot through_json(const Snapshot& snapshot) {
+    return CardityRuntime::snapshot_from_json(CardityRuntime::snapshot_to_json(snapshot));
+}
+
+void test_delta_contains_only_changes() {
+    auto runtime = make_runtime();
+    runtime->set_state("extra", "1");
+    runtime->set_state("doomed", "x");
+    Snapshot full = runtime->create_delta_snapshot("100");
+    CHECK(!full.is_delta);
+
+    runtime->call_method("set_msg", {"changed"});
+    runtime->get_state_manager()->remove("doomed");
+    Snapshot delta = runtime->create_delta_snapshot("101");
+
+    CHECK(delta.is_delta);
+    CHECK_EQ(delta.base_block_height, std::string("100"));
+    CHECK_EQ(delta.state.size(), size_t(1));
+    CHECK(delta.state.contains("msg"));
+    CHECK(delta.removed_keys == std::vector<std::string>({"doomed"}));
+    CHECK_EQ(delta.event_log.size(), size_t(1));
+
+    // 删除的键在副本上同样被删除
+    auto replica = make_runtime();
+    CHECK(replica->restore_from_snapshot_chain({through_json(full), through_json(delta)}));
+    CHECK(!replica->get_state_manager()->has("doomed"));
+    CHECK_EQ(replica->get_state("extra"), std::string("1"));
+    CHECK(replica->get_all_state() == runtime->get_all_state());
+}
+
+void test_full_snapshot_interval_rollover() {
+    RuntimeConfig config;
+    config.full_snapshot_interval = 2;
+    auto runtime = make_runtime(config);
+
+    // 完整、增量、增量、完整、增量
+    std::vector<bool> expected_delta = {false, true, true, false, true};
+    for (size_t i = 0; i < expected_delta.size(); ++i) {
+        runtime->call_method("increment", {});
+        Snapshot snapshot = runtime->create_delta_snapshot(std::to_string(200 + i));
+        CHECK_EQ(snapshot.is_delta, expected_delta[i]);
+    }
+
+    // 清空状态后只能生成完整快照
+    runtime->get_state_manager()->clear();
+    CHECK(!runtime->create_delta_snapshot("300").is_delta);
+
+    // 间隔为 0：总是完整快照
+    config.full_snapshot_interval = 0;
+    auto always_full = make_runtime(config);
+    always_full->create_delta_snapshot("1");
+    always_full->call_method("increment", {});
+    CHECK(!always_full->create_delta_snapshot("2").is_delta);
+}
+
+void test_event_cursor_overflow() {
+    RuntimeConfig config;
+    config.event_log_capacity = 3;
+    auto runtime = make_runtime(config);
+    runtime->call_method("increment", {});
+    Snapshot full = runtime->create_delta_snapshot("10");
+
+    // 两个快照之间的事件超过容量：增量快照只包含仍保留的事件，序号从保留的最旧事件开始
+    for (int i = 0; i < 5; ++i) {
+        runtime->call_method("increment", {});
+    }
+    Snapshot delta = runtime->create_delta_snapshot("11");
+    CHECK(delta.is_delta);
+    CHECK_EQ(delta.event_log.size(), size_t(3));
+    CHECK_EQ(delta.event_sequence, uint64_t(3));
+
+    // 副本的事件日志与原运行时相同（序号不重排），之后的事件序号连续
+    auto replica = make_runtime(config);
+    CHECK(replica->restore_from_snapshot_chain({through_json(full), through_json(delta)}));
+    CHECK(events_of(*replica) == events_of(*runtime));
+    CHECK(replica->get_all_state() == runtime->get_all_state());
+
+    runtime->call_method("increment", {});
+    replica->call_method("increment", {});
+    CHECK(events_of(*replica) == events_of(*runtime));
+}
+
+void test_mismatched_base_is_rejected() {
+    auto runtime = make_runtime();
+    Snapshot full = runtime->create_delta_snapshot("500");
+    runtime->call_method("increment", {});
+    Snapshot delta = runtime->create_delta_snapshot("501");
+    runtime->call_method("increment", {});
+    Snapshot next_delta = runtime->create_delta_snapshot("502");
+
+    // 没有基线
+    auto replica = make_runtime();
+    CHECK(!replica->restore_from_snapshot(delta));
+
+    // 跳过中间的增量快照
+    CHECK(replica->restore_from_snapshot(full));
+    CHECK(!replica->restore_from_snapshot(next_delta));
+    CHECK(!replica->restore_from_snapshot_chain({full, next_delta}));
+
+    // 链必须从完整快照开始
+    CHECK(!replica->restore_from_snapshot_chain({delta, next_delta}));
+
+    // 基线的标识不符
+    Snapshot wrong_base = delta;
+    wrong_base.base_block_height = "499";
+    CHECK(!replica->restore_from_snapshot_chain({full, wrong_base}));
+
+    CHECK(replica->restore_from_snapshot_chain({full, delta, next_delta}));
+    CHECK(replica->get_all_state() == runtime->get_all_state());
+}
+
+void test_chain_restores_live_state() {
+    auto runtime = make_runtime();
+    runtime->call_method("increment", {});
+    runtime->set_state("note", "first");
+    Snapshot full = runtime->create_delta_snapshot("1000");
+
+    runtime->call_method("set_msg", {"second"});
+    runtime->call_method("increment", {});
+    runtime->get_state_manager()->remove("note");
+    Snapshot first_delta = runtime->create_delta_snapshot("1001");
+
+    runtime->call_method("toggle", {});
+    runtime->call_method("increment", {});  // active 为 false，不改变 count
+    runtime->set_state("note", "back");
+    runtime->call_method("set_msg", {"third"});
+    Snapshot second_delta = runtime->create_delta_snapshot("1002");
+    CHECK(first_delta.is_delta && second_delta.is_delta);
+
+    // 副本已有其他状态，链的完整基线先清空它
+    auto replica = make_runtime();
+    replica->set_state("stale", "yes");
+    replica->call_method("increment", {});
+    CHECK(replica->restore_from_snapshot_chain(
+        {through_json(full), through_json(first_delta), through_json(second_delta)}));
+
+    CHECK(replica->get_all_state() == runtime->get_all_state());
+    CHECK(!replica->get_state_manager()->has("stale"));
+    CHECK(events_of(*replica) == events_of(*runtime));
+
+    // 副本可以接着生成衔接在链末尾的增量快照
+    replica->call_method("toggle", {});
+    Snapshot continued = replica->create_delta_snapshot("1003");
+    CHECK(continued.is_delta);
+    CHECK_EQ(continued.base_block_height, std::string("1002"));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing snapshots..." << std::endl;
+
+    cardity_test::run("delta contains only changes and removed keys", test_delta_contains_only_changes);
+    cardity_test::run("full snapshot interval rollover", test_full_snapshot_interval_rollover);
+    cardity_test::run("event cursor overflow", test_event_cursor_overflow);
+    cardity_test::run("mismatched base is rejected", test_mismatched_base_is_rejected);
+    cardity_test::run("full -> delta -> delta chain restores live state", test_chain_restores_live_state);
+
+    return cardity_test::finish();
+}
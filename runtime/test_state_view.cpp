@@ -0,0 +1,154 @@
+#include "runtime.h"
+#include "test_check.h"
+
+using namespace cardity;
+using cardity_test::TempPath;
+
+namespace {
+
+const char* PROTOCOL_PATH = "test_data/hello_cardinals.car";
+
+std::unique_ptr<CardityRuntime> make_runtime() {
+    auto runtime = std::make_unique<CardityRuntime>();
+    CHECK(runtime->load_protocol(PROTOCOL_PATH));
+    return runtime;
+}
+
+// 缓存的序列化视图（解析后比较）
+json view_of(const CardityRuntime& runtime) {
+    return json::parse(runtime.get_all_state_json());
+}
+
+// 视图中某个键的值，不存在时为空串（按值返回，不引用临时对象）
+std::string view_value(const CardityRuntime& runtime, const std::string& key) {
+    return view_of(runtime).value(key, "");
+}
+
+json store_contents(const CardityRuntime& runtime) {
+    json state = json::object();
+    runtime.for_each_state([&state](const std::string& key, const StateValue& value) {
+        state[key] = value.to_string();
+    });
+    return state;
+}
+
+void test_repeated_reads_reuse_the_cache() {
+    auto runtime = make_runtime();
+    const std::string& first = runtime->get_all_state_json();
+    std::string text = first;
+    const std::string& second = runtime->get_all_state_json();
+    CHECK(&first == &second);
+    CHECK_EQ(second, text);
+    CHECK(view_of(*runtime) == store_contents(*runtime));
+
+    // ABI 在协议加载后不变，每次返回同一份文本
+    const std::string& abi = runtime->get_abi_json();
+    CHECK(&abi == &runtime->get_abi_json());
+    CHECK(json::parse(abi) == runtime->get_protocol()->abi());
+}
+
+void test_writes_invalidate() {
+    auto runtime = make_runtime();
+    json before = view_of(*runtime);
+
+    runtime->set_state("msg", "changed");
+    CHECK_EQ(view_value(*runtime, "msg"), std::string("changed"));
+
+    runtime->call_method("increment", {});
+    CHECK_EQ(view_value(*runtime, "count"), std::string("1"));
+
+    runtime->get_state_manager()->remove("msg");
+    CHECK(!view_of(*runtime).contains("msg"));
+    CHECK(view_of(*runtime) == store_contents(*runtime));
+    CHECK(view_of(*runtime) != before);
+}
+
+void test_rollback_invalidates() {
+    auto runtime = make_runtime();
+    json before = view_of(*runtime);
+    StateManager* state = runtime->get_state_manager();
+
+    // 事务中读取视图，回滚后视图回到事务前
+    state->begin_transaction();
+    state->set("msg", "inside");
+    state->set("extra", "1");
+    CHECK_EQ(view_value(*runtime, "msg"), std::string("inside"));
+    state->rollback();
+    CHECK(view_of(*runtime) == before);
+
+    state->begin_transaction();
+    state->clear();
+    CHECK(view_of(*runtime).empty());
+    state->rollback();
+    CHECK(view_of(*runtime) == before);
+}
+
+void test_set_state_store_invalidates() {
+    // 新存储的写入版本从 0 开始，可能与旧缓存的版本相同
+    CardityRuntime runtime;
+    CHECK(view_of(runtime).empty());
+
+    auto store = std::make_unique<MemoryStateStore>();
+    store->set_value("seeded", StateValue::from_string("yes"));
+    runtime.set_state_store(std::move(store));
+    CHECK_EQ(view_of(runtime), json({{"seeded", "yes"}}));
+
+    auto populated = make_runtime();
+    populated->call_method("increment", {});
+    populated->get_all_state_json();
+    populated->set_state_store(std::make_unique<MemoryStateStore>());
+    CHECK_EQ(view_value(*populated, "count"), std::string("0"));
+    CHECK(view_of(*populated) == store_contents(*populated));
+}
+
+void test_load_state_from_file_invalidates() {
+    TempPath file("state_view.json");
+    auto runtime = make_runtime();
+    runtime->set_state("msg", "saved");
+    CHECK(runtime->save_state_to_file(file.str()));
+    json saved = view_of(*runtime);
+
+    runtime->set_state("msg", "unsaved");
+    runtime->call_method("increment", {});
+    CHECK_EQ(view_value(*runtime, "msg"), std::string("unsaved"));
+
+    CHECK(runtime->load_state_from_file(file.str()));
+    CHECK(view_of(*runtime) == saved);
+    CHECK(view_of(*runtime) == store_contents(*runtime));
+}
+
+void test_restore_invalidates() {
+    auto runtime = make_runtime();
+    runtime->set_state("msg", "snapshot");
+    Snapshot snapshot = runtime->create_snapshot();
+    json snapshotted = view_of(*runtime);
+
+    runtime->set_state("msg", "later");
+    runtime->call_method("increment", {});
+    CHECK(view_of(*runtime) != snapshotted);
+
+    CHECK(runtime->restore_from_snapshot(snapshot));
+    CHECK(view_of(*runtime) == snapshotted);
+
+    // 快照链从完整快照开始，先清空再恢复
+    runtime->set_state("extra", "x");
+    CHECK(view_of(*runtime).contains("extra"));
+    CHECK(runtime->restore_from_snapshot_chain({snapshot}));
+    CHECK(view_of(*runtime) == snapshotted);
+    CHECK(view_of(*runtime) == store_contents(*runtime));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing cached state view..." << std::endl;
+
+    cardity_test::run("repeated reads reuse the cache", test_repeated_reads_reuse_the_cache);
+    cardity_test::run("writes invalidate the view", test_writes_invalidate);
+    cardity_test::run("rollback invalidates the view", test_rollback_invalidates);
+    cardity_test::run("set_state_store invalidates the view", test_set_state_store_invalidates);
+    cardity_test::run("load_state_from_file invalidates the view", test_load_state_from_file_invalidates);
+    cardity_test::run("restore invalidates the view", test_restore_invalidates);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,203 @@
+#include "runtime.h"
+#include "test_check.h"
+
+using namespace cardity;
+
+namespace {
+
+// bump 在 gas 预算内；expensive 先写入并 emit，最后一条语句耗尽 gas
+const char* PROTOCOL = R"({
+  "p": "cardinals",
+  "op": "deploy",
+  "protocol": "transactions",
+  "version": "1.0",
+  "cpl": {
+    "state": {
+      "count": {"type": "int", "default": "0"},
+      "msg": {"type": "string", "default": "initial"}
+    },
+    "events": {
+      "Bumped": {"params": [{"name": "count", "type": "int"}]}
+    },
+    "methods": {
+      "bump": {
+        "logic": "state.count = state.count + 1; emit Bumped(state.count); state.msg = \"bumped\""
+      },
+      "expensive": {
+        "logic": "state.count = 100; emit Bumped(state.count); state.msg = \"partial\"; state.count = state.count + state.count + state.count + state.count + state.count"
+      }
+    },
+    "owner": "doge1test"
+  }
+})";
+
+const uint64_t GAS_LIMIT = 10;
+
+std::unique_ptr<CardityRuntime> make_runtime() {
+    RuntimeConfig config;
+    config.gas_limit = GAS_LIMIT;
+    auto runtime = std::make_unique<CardityRuntime>(config);
+    CHECK(runtime->load_protocol_from_json(PROTOCOL));
+    return runtime;
+}
+
+void test_rollback_restores_values() {
+    StateManager state;
+    state.set_int("kept", 1);
+    state.set_int("changed", 2);
+    state.set_int("removed", 3);
+
+    state.begin_transaction();
+    state.set_int("changed", 20);
+    state.remove("removed");
+    state.set_int("created", 4);
+    state.set_int("changed", 200);
+    CHECK(state.in_transaction());
+    state.rollback();
+
+    CHECK(!state.in_transaction());
+    CHECK_EQ(state.get_int("kept"), 1);
+    CHECK_EQ(state.get_int("changed"), 2);
+    CHECK_EQ(state.get_int("removed"), 3);
+    CHECK(!state.has("created"));
+    CHECK_EQ(state.size(), size_t(3));
+
+    // 提交后的写入保留；没有事务时 commit / rollback 不做任何事
+    state.begin_transaction();
+    state.set_int("changed", 5);
+    state.commit();
+    state.rollback();
+    state.commit();
+    CHECK_EQ(state.get_int("changed"), 5);
+}
+
+void test_nested_savepoints() {
+    StateManager state;
+    state.set_int("a", 1);
+    state.set_int("b", 1);
+
+    // 内层回滚只撤销内层的写入
+    state.begin_transaction();
+    state.set_int("a", 2);
+    state.begin_transaction();
+    state.set_int("b", 2);
+    state.set_int("c", 2);
+    state.rollback();
+    CHECK(state.in_transaction());
+    CHECK_EQ(state.get_int("a"), 2);
+    CHECK_EQ(state.get_int("b"), 1);
+    CHECK(!state.has("c"));
+    state.commit();
+    CHECK_EQ(state.get_int("a"), 2);
+
+    // 内层已提交的写入由外层回滚一并撤销
+    state.begin_transaction();
+    state.set_int("a", 3);
+    state.begin_transaction();
+    state.set_int("b", 3);
+    state.commit();
+    CHECK_EQ(state.get_int("b"), 3);
+    state.rollback();
+    CHECK_EQ(state.get_int("a"), 2);
+    CHECK_EQ(state.get_int("b"), 1);
+    CHECK(!state.in_transaction());
+}
+
+void test_clear_inside_transaction_rolls_back() {
+    StateManager state;
+    state.set_int("a", 1);
+    state.set("b", "text");
+
+    state.begin_transaction();
+    state.clear();
+    CHECK_EQ(state.size(), size_t(0));
+    state.set_int("new", 9);
+    state.rollback();
+
+    CHECK_EQ(state.size(), size_t(2));
+    CHECK_EQ(state.get_int("a"), 1);
+    CHECK_EQ(state.get_string("b"), std::string("text"));
+    CHECK(!state.has("new"));
+}
+
+void test_slot_writes_roll_back() {
+    StateManager state;
+    state.bind_slots({"x", "y"});
+    state.set_slot(0, StateValue::from_int(1));
+
+    state.begin_transaction();
+    state.set_slot(0, StateValue::from_int(10));
+    state.set_slot(1, StateValue::from_int(20));
+    state.rollback();
+
+    CHECK(state.get_slot(0) == StateValue::from_int(1));
+    CHECK(!state.has("y"));
+}
+
+void test_failed_call_leaves_no_change() {
+    auto runtime = make_runtime();
+    json before = runtime->get_all_state();
+
+    MethodResult result = runtime->call_method("expensive", {});
+    CHECK(!result.success);
+    CHECK_EQ(result.gas_used, GAS_LIMIT);
+    CHECK(result.events.empty());
+    CHECK(runtime->get_all_state() == before);
+    CHECK(runtime->get_event_log().empty());
+    CHECK(!runtime->get_state_manager()->in_transaction());
+
+    // 失败之后的调用正常提交
+    result = runtime->call_method("bump", {});
+    CHECK(result.success);
+    CHECK_EQ(runtime->get_state("count"), std::string("1"));
+    CHECK_EQ(runtime->get_state("msg"), std::string("bumped"));
+    CHECK_EQ(runtime->get_event_log().size(), size_t(1));
+
+    // 参数数量错误不开始事务
+    result = runtime->call_method("bump", {"extra"});
+    CHECK(!result.success);
+    CHECK(!runtime->get_state_manager()->in_transaction());
+    CHECK_EQ(runtime->get_state("count"), std::string("1"));
+}
+
+void test_simulate_never_commits() {
+    auto runtime = make_runtime();
+    runtime->call_method("bump", {});
+    json before = runtime->get_all_state();
+    size_t events_before = runtime->get_event_log().size();
+
+    // 模拟调用返回将要发出的事件，但状态和事件日志不变
+    MethodResult result = runtime->simulate_method("bump", {});
+    CHECK(result.success);
+    CHECK_EQ(result.events.size(), size_t(1));
+    if (!result.events.empty()) {
+        CHECK(result.events[0].values == std::vector<std::string>({"2"}));
+    }
+    CHECK(runtime->get_all_state() == before);
+    CHECK_EQ(runtime->get_event_log().size(), events_before);
+    CHECK(!runtime->get_state_manager()->in_transaction());
+
+    result = runtime->simulate_method("expensive", {});
+    CHECK(!result.success);
+    CHECK(runtime->get_all_state() == before);
+
+    // 模拟之后的真实调用看到的是未改变的状态
+    result = runtime->call_method("bump", {});
+    CHECK(result.success);
+    CHECK_EQ(runtime->get_state("count"), std::string("2"));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing transactions..." << std::endl;
+
+    cardity_test::run("rollback restores values", test_rollback_restores_values);
+    cardity_test::run("nested savepoints", test_nested_savepoints);
+    cardity_test::run("clear inside a transaction rolls back", test_clear_inside_transaction_rolls_back);
+    cardity_test::run("slot writes roll back", test_slot_writes_roll_back);
+    cardity_test::run("failed call leaves no state change", test_failed_call_leaves_no_change);
+    cardity_test::run("simulate never commits", test_simulate_never_commits);
+
+    return cardity_test::finish();
+}
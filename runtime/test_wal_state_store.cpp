@@ -0,0 +1,289 @@
+#include "wal_state_store.h"
+#include "mmap_state_store.h"
+#include "test_check.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace cardity;
+using cardity_test::TempPath;
+
+namespace {
+
+// 压缩阈值设为最大，只在测试显式调用 compact 时压缩
+WalOptions manual_compaction() {
+    WalOptions options;
+    options.compact_min_bytes = static_cast<size_t>(-1);
+    return options;
+}
+
+uint64_t file_size(const std::string& path) {
+    return std::filesystem::file_size(path);
+}
+
+void flip_byte(const std::string& path, uint64_t offset) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    char byte = 0;
+    file.read(&byte, 1);
+    byte = static_cast<char>(byte ^ 0x5A);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(&byte, 1);
+}
+
+// 写入两个帧（a=1，b=2），返回第一帧结束时的日志大小
+uint64_t write_two_frames(const std::string& path) {
+    WalStateStore store(manual_compaction());
+    CHECK(store.open(path));
+    store.set_value("a", StateValue::from_int(1));
+    store.sync_point();
+    uint64_t first_frame_end = store.get_log_size();
+    store.set_value("b", StateValue::from_int(2));
+    store.sync_point();
+    CHECK(store.flush());
+    store.close();
+    CHECK(file_size(path) > first_frame_end);
+    return first_frame_end;
+}
+
+void test_replay() {
+    TempPath log("replay.wal");
+    {
+        WalStateStore store;
+        CHECK(store.open(log.str()));
+        store.set_value("msg", StateValue::from_string("gm"));
+        store.sync_point();
+        store.set_value("count", StateValue::from_int(7));
+        store.set_value("flag", StateValue::from_bool(true));
+        store.sync_point();
+        store.remove_key("msg");
+        store.sync_point();
+    }
+
+    WalStateStore reopened;
+    CHECK(reopened.open(log.str()));
+    CHECK(!reopened.has_key("msg"));
+    CHECK(reopened.get_value("count") == StateValue::from_int(7));
+    CHECK(reopened.get_value("flag") == StateValue::from_bool(true));
+    CHECK_EQ(reopened.size(), size_t(2));
+    CHECK_EQ(reopened.get_log_size(), file_size(log.str()));
+}
+
+void test_torn_tail_is_truncated() {
+    TempPath log("torn.wal");
+    uint64_t first_frame_end = write_two_frames(log.str());
+
+    // 模拟崩溃：最后一帧只写了一部分
+    std::filesystem::resize_file(log.str(), file_size(log.str()) - 3);
+
+    {
+        WalStateStore store;
+        CHECK(store.open(log.str()));
+        CHECK(store.get_value("a") == StateValue::from_int(1));
+        CHECK(!store.has_key("b"));
+        CHECK_EQ(file_size(log.str()), first_frame_end);
+
+        // 截断后继续追加的帧可以正常重放
+        store.set_value("c", StateValue::from_int(3));
+        store.sync_point();
+    }
+
+    WalStateStore reopened;
+    CHECK(reopened.open(log.str()));
+    CHECK(reopened.get_value("a") == StateValue::from_int(1));
+    CHECK(reopened.get_value("c") == StateValue::from_int(3));
+    CHECK(!reopened.has_key("b"));
+}
+
+void test_bad_crc_is_truncated() {
+    TempPath log("crc.wal");
+    uint64_t first_frame_end = write_two_frames(log.str());
+
+    // 最后一帧负载的最后一个字节损坏
+    flip_byte(log.str(), file_size(log.str()) - 1);
+
+    WalStateStore store;
+    CHECK(store.open(log.str()));
+    CHECK(store.get_value("a") == StateValue::from_int(1));
+    CHECK(!store.has_key("b"));
+    CHECK_EQ(file_size(log.str()), first_frame_end);
+    CHECK_EQ(store.get_log_size(), first_frame_end);
+}
+
+void test_corrupt_middle_frame_discards_rest() {
+    TempPath log("middle.wal");
+    uint64_t first_frame_end = write_two_frames(log.str());
+
+    // 第一帧损坏：之后的帧无法确认顺序，全部丢弃，只保留文件头
+    flip_byte(log.str(), first_frame_end - 1);
+
+    WalStateStore store;
+    CHECK(store.open(log.str()));
+    CHECK_EQ(store.size(), size_t(0));
+    CHECK_EQ(file_size(log.str()), uint64_t(8));
+}
+
+void test_rejects_foreign_file() {
+    TempPath log("foreign.wal");
+    {
+        std::ofstream file(log.str(), std::ios::binary);
+        file << "not a state log at all";
+    }
+    WalStateStore store;
+    CHECK(!store.open(log.str()));
+}
+
+void test_compaction_round_trip() {
+    TempPath log("compact.wal");
+    std::map<std::string, StateValue> expected;
+    uint64_t before = 0;
+    {
+        WalStateStore store(manual_compaction());
+        CHECK(store.open(log.str()));
+        for (int round = 0; round < 50; ++round) {
+            for (int key = 0; key < 10; ++key) {
+                std::string name = "k" + std::to_string(key);
+                store.set_value(name, StateValue::from_int(round * 10 + key));
+                expected[name] = StateValue::from_int(round * 10 + key);
+            }
+            store.sync_point();
+        }
+        store.remove_key("k3");
+        expected.erase("k3");
+        store.set_value("text", StateValue::from_string("hello"));
+        expected["text"] = StateValue::from_string("hello");
+        store.sync_point();
+
+        before = store.get_log_size();
+        CHECK(store.compact());
+        CHECK(store.get_log_size() < before);
+        CHECK_EQ(store.get_log_size(), file_size(log.str()));
+        CHECK(!std::filesystem::exists(log.str() + ".compact"));
+
+        // 压缩后的描述符继续追加到替换后的文件
+        store.set_value("after", StateValue::from_float(1.5));
+        expected["after"] = StateValue::from_float(1.5);
+        store.sync_point();
+        CHECK(store.flush());
+        CHECK(!store.has_write_error());
+    }
+
+    WalStateStore reopened;
+    CHECK(reopened.open(log.str()));
+    CHECK_EQ(reopened.size(), expected.size());
+    for (const auto& [key, value] : expected) {
+        CHECK(reopened.get_value(key) == value);
+    }
+    CHECK(file_size(log.str()) < before);
+}
+
+void test_automatic_compaction_bounds_log() {
+    TempPath log("auto.wal");
+    WalOptions options;
+    options.compact_min_bytes = 256;
+    options.compact_ratio = 2;
+    {
+        WalStateStore store(options);
+        CHECK(store.open(log.str()));
+        for (int i = 0; i < 1000; ++i) {
+            store.set_value("counter", StateValue::from_int(i));
+            store.sync_point();
+        }
+        CHECK(store.get_log_size() < 1024);
+    }
+
+    WalStateStore reopened;
+    CHECK(reopened.open(log.str()));
+    CHECK(reopened.get_value("counter") == StateValue::from_int(999));
+}
+
+void test_transaction_is_one_frame() {
+    TempPath log("txn.wal");
+    {
+        StateManager manager(std::make_unique<WalStateStore>(manual_compaction()));
+        CHECK(static_cast<WalStateStore*>(manager.get_store())->open(log.str()));
+        manager.set_int("balance", 10);
+
+        // 回滚的事务在日志中留下恢复旧值的帧，重放结果与回滚后一致
+        manager.begin_transaction();
+        manager.set_int("balance", 99);
+        manager.set("memo", "pending");
+        manager.rollback();
+
+        manager.begin_transaction();
+        manager.set_int("balance", 11);
+        manager.commit();
+        CHECK(manager.flush());
+    }
+
+    WalStateStore reopened;
+    CHECK(reopened.open(log.str()));
+    CHECK(reopened.get_value("balance") == StateValue::from_int(11));
+    CHECK(!reopened.has_key("memo"));
+}
+
+void test_image_with_wal_overlay() {
+    TempPath image("overlay.img");
+    TempPath log("overlay.wal");
+
+    MemoryStateStore source;
+    source.set_value("name", StateValue::from_string("cardinals"));
+    source.set_value("supply", StateValue::from_int(21000000));
+    source.set_value("paused", StateValue::from_bool(false));
+    CHECK(MmapStateStore::write_image(image.str(), source));
+
+    {
+        auto wal = std::make_unique<WalStateStore>(manual_compaction());
+        CHECK(wal->open(log.str()));
+        MmapStateStore store(std::move(wal));
+        CHECK(store.open(image.str()));
+
+        store.set_value("supply", StateValue::from_int(20999999));
+        store.remove_key("paused");
+        store.set_value("holder", StateValue::from_string("alice"));
+        store.sync_point();
+
+        CHECK(store.get_value("supply") == StateValue::from_int(20999999));
+        CHECK(!store.has_key("paused"));
+        CHECK_EQ(store.size(), size_t(3));
+        CHECK(store.flush());
+    }
+
+    // 镜像未被修改，写入只存在于日志中；重新打开后合并视图不变
+    MmapStateStore untouched;
+    CHECK(untouched.open(image.str()));
+    CHECK(untouched.get_value("supply") == StateValue::from_int(21000000));
+    CHECK(untouched.has_key("paused"));
+
+    auto wal = std::make_unique<WalStateStore>();
+    CHECK(wal->open(log.str()));
+    MmapStateStore reopened(std::move(wal));
+    CHECK(reopened.open(image.str()));
+    CHECK(reopened.get_value("name") == StateValue::from_string("cardinals"));
+    CHECK(reopened.get_value("supply") == StateValue::from_int(20999999));
+    CHECK(reopened.get_value("holder") == StateValue::from_string("alice"));
+    CHECK(!reopened.has_key("paused"));
+
+    std::map<std::string, StateValue> merged;
+    reopened.for_each([&merged](const std::string& key, const StateValue& value) { merged[key] = value; });
+    CHECK_EQ(merged.size(), size_t(3));
+    CHECK(merged.count("paused") == 0);
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🧪 Testing WalStateStore..." << std::endl;
+
+    cardity_test::run("replay restores state", test_replay);
+    cardity_test::run("torn tail frame is truncated", test_torn_tail_is_truncated);
+    cardity_test::run("bad CRC frame is truncated", test_bad_crc_is_truncated);
+    cardity_test::run("corrupt middle frame discards the rest", test_corrupt_middle_frame_discards_rest);
+    cardity_test::run("foreign file is rejected", test_rejects_foreign_file);
+    cardity_test::run("compaction round-trip", test_compaction_round_trip);
+    cardity_test::run("automatic compaction bounds the log", test_automatic_compaction_bounds_log);
+    cardity_test::run("transactions replay as committed", test_transaction_is_one_frame);
+    cardity_test::run("image with WAL overlay", test_image_with_wal_overlay);
+
+    return cardity_test::finish();
+}
@@ -0,0 +1,402 @@
+#include "wal_state_store.h"
+#include "binary_codec.h"
+#include "log.h"
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstdio>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace cardity {
+
+namespace {
+
+const char WAL_MAGIC[4] = {'C', 'W', 'A', 'L'};
+const uint32_t WAL_VERSION = 1;
+const size_t WAL_HEADER_SIZE = 8;
+const size_t FRAME_HEADER_SIZE = 8;
+
+enum class WalOp : uint8_t {
+    SET = 1,
+    REMOVE = 2,
+    CLEAR = 3
+};
+
+// CRC32（IEEE 802.3，反射多项式 0xEDB88320）
+uint32_t crc32(const char* data, size_t length) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// 从负载中读取带长度前缀的字符串
+bool read_string(const std::string& payload, size_t& pos, std::string& out) {
+    if (payload.size() - pos < 4) {
+        return false;
+    }
+    uint32_t length = get_u32(payload.data() + pos);
+    pos += 4;
+    if (payload.size() - pos < length) {
+        return false;
+    }
+    out.assign(payload, pos, length);
+    pos += length;
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::string wal_header() {
+    std::string header(WAL_MAGIC, sizeof(WAL_MAGIC));
+    put_u32(header, WAL_VERSION);
+    return header;
+}
+
+// fsync 文件所在目录，使创建或重命名的目录项在崩溃后仍然存在
+bool sync_parent_directory(const std::string& file_path) {
+    size_t slash = file_path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : file_path.substr(0, slash);
+    int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0) {
+        return false;
+    }
+    bool synced = ::fsync(dir_fd) == 0;
+    ::close(dir_fd);
+    return synced;
+}
+
+// 为负载加上帧头
+std::string make_frame(const std::string& payload) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + payload.size());
+    put_u32(frame, static_cast<uint32_t>(payload.size()));
+    put_u32(frame, crc32(payload.data(), payload.size()));
+    frame.append(payload);
+    return frame;
+}
+
+} // namespace
+
+WalStateStore::WalStateStore(const WalOptions& opts)
+    : fd(-1), options(opts), unsynced_frames(0), log_bytes(0), compacted_bytes(0), replaying(false),
+      write_failed(false) {}
+
+WalStateStore::~WalStateStore() {
+    close();
+}
+
+bool WalStateStore::open(const std::string& log_path) {
+    close();
+    path = log_path;
+
+    // 读取已有日志
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (file.is_open()) {
+            std::ostringstream buffer;
+            buffer << file.rdbuf();
+            data = buffer.str();
+        }
+    }
+
+    size_t valid_end = 0;
+    if (data.size() >= WAL_HEADER_SIZE) {
+        if (std::memcmp(data.data(), WAL_MAGIC, sizeof(WAL_MAGIC)) != 0 ||
+            get_u32(data.data() + sizeof(WAL_MAGIC)) != WAL_VERSION) {
+            CARDITY_LOG_ERROR("Not a Cardity state log: " << path);
+            return false;
+        }
+        valid_end = WAL_HEADER_SIZE;
+
+        // 重放完整且校验通过的帧
+        MemoryStateStore::clear();
+        replaying = true;
+        while (data.size() - valid_end >= FRAME_HEADER_SIZE) {
+            uint32_t length = get_u32(data.data() + valid_end);
+            uint32_t checksum = get_u32(data.data() + valid_end + 4);
+            if (data.size() - valid_end - FRAME_HEADER_SIZE < length) {
+                break;
+            }
+            std::string payload = data.substr(valid_end + FRAME_HEADER_SIZE, length);
+            if (crc32(payload.data(), payload.size()) != checksum || !apply_payload(payload)) {
+                break;
+            }
+            valid_end += FRAME_HEADER_SIZE + length;
+        }
+        replaying = false;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        CARDITY_LOG_ERROR("Failed to open state log: " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    if (valid_end == 0) {
+        // 新文件或不完整的文件头：重新写入文件头
+        std::string header = wal_header();
+        if (::ftruncate(fd, 0) != 0 || !write_all(fd, header.data(), header.size()) || ::fsync(fd) != 0) {
+            CARDITY_LOG_ERROR("Failed to initialize state log: " << path);
+            close();
+            return false;
+        }
+        valid_end = header.size();
+    } else if (valid_end < data.size()) {
+        // 丢弃崩溃时写了一半的尾部
+        CARDITY_LOG_WARN("Truncating " << (data.size() - valid_end) << " bytes of incomplete records in " << path);
+        if (::ftruncate(fd, static_cast<off_t>(valid_end)) != 0 || ::fsync(fd) != 0) {
+            CARDITY_LOG_ERROR("Failed to truncate state log: " << path);
+            close();
+            return false;
+        }
+    }
+
+    if (::lseek(fd, 0, SEEK_END) < 0) {
+        close();
+        return false;
+    }
+
+    log_bytes = valid_end;
+    compacted_bytes = valid_end;
+    unsynced_frames = 0;
+    write_failed = false;
+    pending.clear();
+    CARDITY_LOG_DEBUG("Opened state log " << path << " (" << log_bytes << " bytes, " << size() << " keys)");
+    return true;
+}
+
+void WalStateStore::close() {
+    if (fd < 0) {
+        return;
+    }
+    sync_point();
+    if (unsynced_frames > 0) {
+        ::fsync(fd);
+    }
+    ::close(fd);
+    fd = -1;
+    unsynced_frames = 0;
+}
+
+void WalStateStore::append_set(const std::string& key, const StateValue& value) {
+    if (replaying || fd < 0) {
+        return;
+    }
+    pending.push_back(static_cast<char>(WalOp::SET));
+    put_string(pending, key);
+    pending.push_back(static_cast<char>(value.type()));
+    put_string(pending, value.to_string());
+}
+
+void WalStateStore::append_remove(const std::string& key) {
+    if (replaying || fd < 0) {
+        return;
+    }
+    pending.push_back(static_cast<char>(WalOp::REMOVE));
+    put_string(pending, key);
+}
+
+void WalStateStore::append_clear() {
+    if (replaying || fd < 0) {
+        return;
+    }
+    // 清空之前的记录已无意义
+    pending.clear();
+    pending.push_back(static_cast<char>(WalOp::CLEAR));
+}
+
+bool WalStateStore::apply_payload(const std::string& payload) {
+    size_t pos = 0;
+    std::string key;
+    std::string text;
+
+    while (pos < payload.size()) {
+        WalOp op = static_cast<WalOp>(payload[pos++]);
+        switch (op) {
+            case WalOp::SET: {
+                if (!read_string(payload, pos, key) || pos >= payload.size()) {
+                    return false;
+                }
+                uint8_t type = static_cast<uint8_t>(payload[pos++]);
+                if (type > static_cast<uint8_t>(ValueType::FLOAT) || !read_string(payload, pos, text)) {
+                    return false;
+                }
+                MemoryStateStore::set_value(key, StateValue(static_cast<ValueType>(type), text));
+                break;
+            }
+            case WalOp::REMOVE:
+                if (!read_string(payload, pos, key)) {
+                    return false;
+                }
+                MemoryStateStore::remove_key(key);
+                break;
+            case WalOp::CLEAR:
+                MemoryStateStore::clear();
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+bool WalStateStore::set_value(const std::string& key, const StateValue& value) {
+    append_set(key, value);
+    return MemoryStateStore::set_value(key, value);
+}
+
+bool WalStateStore::remove_key(const std::string& key) {
+    bool removed = MemoryStateStore::remove_key(key);
+    if (removed) {
+        append_remove(key);
+    }
+    return removed;
+}
+
+bool WalStateStore::set_slot(size_t slot, const StateValue& value) {
+    if (slot < slot_names.size()) {
+        append_set(slot_names[slot], value);
+    }
+    return MemoryStateStore::set_slot(slot, value);
+}
+
+void WalStateStore::clear() {
+    append_clear();
+    MemoryStateStore::clear();
+}
+
+void WalStateStore::sync_point() {
+    if (fd < 0 || pending.empty()) {
+        return;
+    }
+
+    std::string payload;
+    payload.swap(pending);
+    if (!write_frame(payload)) {
+        return;
+    }
+
+    if (log_bytes >= options.compact_min_bytes &&
+        log_bytes > compacted_bytes * options.compact_ratio) {
+        compact();
+    }
+}
+
+bool WalStateStore::write_frame(const std::string& payload) {
+    std::string frame = make_frame(payload);
+    if (!write_all(fd, frame.data(), frame.size())) {
+        CARDITY_LOG_ERROR("Failed to append to state log: " << path << ": " << std::strerror(errno));
+        write_failed = true;
+        return false;
+    }
+    log_bytes += frame.size();
+
+    // 批量 fsync：崩溃时最多丢失最近 sync_every 帧，但不会留下半个写入单元
+    ++unsynced_frames;
+    if (options.sync_every > 0 && unsynced_frames >= options.sync_every) {
+        if (::fsync(fd) != 0) {
+            CARDITY_LOG_ERROR("Failed to sync state log: " << path);
+            write_failed = true;
+            return false;
+        }
+        unsynced_frames = 0;
+    }
+    return true;
+}
+
+bool WalStateStore::flush() {
+    if (fd < 0) {
+        return true;
+    }
+    sync_point();
+    if (::fsync(fd) != 0) {
+        CARDITY_LOG_ERROR("Failed to sync state log: " << path);
+        return false;
+    }
+    unsynced_frames = 0;
+    return !write_failed;
+}
+
+bool WalStateStore::compact() {
+    if (fd < 0) {
+        return false;
+    }
+
+    // 当前状态写成单个帧（包含尚未落盘的记录）
+    pending.clear();
+    std::string payload;
+    for_each([&payload](const std::string& key, const StateValue& value) {
+        payload.push_back(static_cast<char>(WalOp::SET));
+        put_string(payload, key);
+        payload.push_back(static_cast<char>(value.type()));
+        put_string(payload, value.to_string());
+    });
+    std::string contents = wal_header();
+    if (!payload.empty()) {
+        contents.append(make_frame(payload));
+    }
+
+    // 写入临时文件后原子替换；临时文件以追加方式打开，替换后直接作为日志的描述符，不需要重新打开
+    std::string temp_path = path + ".compact";
+    int temp_fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (temp_fd < 0) {
+        CARDITY_LOG_ERROR("Failed to create compacted state log: " << temp_path);
+        return false;
+    }
+    bool written = write_all(temp_fd, contents.data(), contents.size()) && ::fsync(temp_fd) == 0;
+    if (!written || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        // 原日志未被替换，继续使用原描述符
+        CARDITY_LOG_ERROR("Failed to replace state log with compacted copy: " << path);
+        ::close(temp_fd);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    ::close(fd);
+    fd = temp_fd;
+    log_bytes = contents.size();
+    compacted_bytes = contents.size();
+    unsynced_frames = 0;
+
+    // 目录项落盘后替换才能在崩溃后保留
+    if (!sync_parent_directory(path)) {
+        CARDITY_LOG_ERROR("Failed to sync directory of state log: " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    CARDITY_LOG_DEBUG("Compacted state log " << path << " to " << contents.size() << " bytes");
+    return true;
+}
+
+} // namespace cardity
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "state_store.h"
+
+namespace cardity {
+
+// 预写日志配置
+struct WalOptions {
+    size_t sync_every;          // 每写入多少帧执行一次 fsync（0 表示只在 flush 时 fsync）
+    size_t compact_min_bytes;   // 日志小于该大小时不压缩
+    size_t compact_ratio;       // 日志大小超过上次压缩结果的倍数时触发压缩
+
+    WalOptions() : sync_every(16), compact_min_bytes(1 << 20), compact_ratio(4) {}
+};
+
+// 预写日志状态存储
+// 内存中保存完整状态，每个写入单元（最外层事务或事务外的单次写入）追加为一个带 CRC 的二进制帧：
+//   文件头: "CWAL" + u32 版本
+//   帧:     u32 负载长度 + u32 CRC32 + 负载（若干 set/remove/clear 记录）
+// 启动时重放日志恢复状态，末尾不完整或校验失败的帧被截断；
+// fsync 按帧数批量执行，日志增长到一定倍数后写入临时文件并原子替换完成压缩；
+// 写入失败的帧不会静默丢弃：记录错误，flush 返回 false
+class WalStateStore : public MemoryStateStore {
+private:
+    std::string path;
+    int fd;
+    WalOptions options;
+
+    std::string pending;            // 当前写入单元尚未落盘的记录
+    size_t unsynced_frames;
+    uint64_t log_bytes;
+    uint64_t compacted_bytes;       // 上次压缩后的日志大小
+    bool replaying;
+    bool write_failed;              // 有写入单元未能写入日志（flush 返回 false，直到重新 open）
+
+    // 编码记录
+    void append_set(const std::string& key, const StateValue& value);
+    void append_remove(const std::string& key);
+    void append_clear();
+
+    // 写入一个完整帧并按配置 fsync
+    bool write_frame(const std::string& payload);
+
+    // 解码并应用一个帧的负载，格式错误返回 false
+    bool apply_payload(const std::string& payload);
+
+public:
+    explicit WalStateStore(const WalOptions& opts = WalOptions());
+    ~WalStateStore() override;
+
+    WalStateStore(const WalStateStore&) = delete;
+    WalStateStore& operator=(const WalStateStore&) = delete;
+
+    // 打开日志：重放已有记录并截断损坏的尾部，文件不存在时创建
+    bool open(const std::string& log_path);
+    void close();
+    bool is_open() const { return fd >= 0; }
+
+    // 写入操作追加日志记录
+    bool set_value(const std::string& key, const StateValue& value) override;
+    bool remove_key(const std::string& key) override;
+    bool set_slot(size_t slot, const StateValue& value) override;
+    void clear() override;
+
+    // 写入单元结束：将累积的记录作为一帧写入日志
+    void sync_point() override;
+
+    // 写出未落盘的记录并 fsync；此前有写入单元未能写入日志时返回 false
+    bool flush() override;
+
+    // 用当前状态重写日志；应在事务之外调用
+    // 写入临时文件、fsync 后替换原日志并 fsync 所在目录；替换之前失败时原日志和描述符保持不变
+    bool compact();
+
+    // 打开后是否有写入单元未能写入日志（这些修改只存在于内存中）
+    bool has_write_error() const { return write_failed; }
+
+    // 当前日志文件大小（字节）
+    uint64_t get_log_size() const { return log_bytes; }
+    const std::string& get_path() const { return path; }
+};
+
+} // namespace cardity